@@ -5,51 +5,28 @@ in vec4 world_space_normal;
 
 out vec4 fragColor;
 
-// ShaderLight struct that contains all data for a given light
-struct ShaderLight{
-  vec3 lightPos;
-  vec3 lightDir;
-  vec3 lightColor;
-  vec3 function; // for attenuation
-
-  float penumbra;      // Only applicable to spot lights, in RADIANS
-  float angle;         // Only applicable to spot lights, in RADIANS
-
-  int lightType; // 0: directional 1: spot 2: point
-};
-
-// coefficients uniforms
+// coefficients uniforms, kd and ks are used by lighting.frag
 uniform float ka;
-uniform float kd;
-uniform float ks;
 
-// shape material coeff
-uniform float shininess;
-uniform vec4 shape_a;
-uniform vec4 shape_d;
-uniform vec4 shape_s;
+// shape material coeff, from default.vert
+flat in float shininess;
+flat in vec4 shape_a;
+flat in vec4 shape_d;
+flat in vec4 shape_s;
 
-// lights array
-uniform ShaderLight lightVector[8];
-uniform int numLights;
+// lights that reach everywhere light every fragment, the rest are binned into a cluster grid of screen tiles x depth slices, see LightGrid
+uniform usamplerBuffer light_clusters;  // (offset into light_indices, light count) per cluster
+uniform usamplerBuffer light_indices;
+uniform ivec3 cluster_dims;
+uniform vec2 cluster_tile_size;         // in pixels
+uniform vec2 cluster_slice_params;      // slice = log(view depth)*x + y
 
+uniform mat4 m_view;
 uniform vec4 world_camera_pos;
 
-/**
- * @brief Falloff function for SPOT lighting
- * @param float x
- * @param float theta_inner
- * @param float theta_outer
- */
-float falloff(float x, float theta_inner, float theta_outer){
-    float x_term = ((x-theta_inner)/(theta_outer-theta_inner));
-    // clamp pow
-    if (x_term <= 0){
-        return 0;
-    } else {
-        return (-2.0*pow(x_term, 3) + 3.0*pow(x_term,2));
-    }
-}
+// defined in lighting.frag
+vec4 shadeGlobalLights(vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess);
+vec4 shadeClusteredLight(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess);
 
 void main() {
 
@@ -60,101 +37,19 @@ void main() {
 
     // ambient term same for all lights
     vec4 ambient_term = ka*shape_a;
-    vec4 diffuse_term = vec4(0.f, 0.f, 0.f, 1.0);
-    vec4 specular_term = vec4(0.f, 0.f, 0.f, 1.0);
-
-    float f_att;
-    float fatt_dist;
-    float spotIntensity = 1.f; // only relevant for SPOT light
-
-    //initialization
-    vec4 lightDir;
-    vec4 lightPos;
-    vec4 lightColor;
-    vec4 surface_to_light;
-    vec4 light_to_intersection; // for position
-    vec4 R;
-
-    float normal_dot_prod;
-    float dot_prod;
-    float theta_outer, theta_inner;
-    float x;
-
-    for (int i=0; i<numLights; i++){
-        lightDir = normalize(vec4(lightVector[i].lightDir, 0.0f)); // only if light is DIRECTIONL
-        surface_to_light = (-lightDir);
-
-        light_to_intersection = normalize(vec4(lightVector[i].lightPos, 1.f) - world_space_pos);
-
-        lightColor = vec4(lightVector[i].lightColor, 1.0);
-
-        fatt_dist = distance(vec4(lightVector[i].lightPos, 0.f), world_space_pos);
-        f_att = min(1.0, 1.f/(lightVector[i].function[0] + fatt_dist*lightVector[i].function[1] + pow(fatt_dist, 2)*lightVector[i].function[2]));
-
-        switch (lightVector[i].lightType){
-            case 0: // DIRECTIONAL
-                f_att = 1.f;
-
-                normal_dot_prod = dot(n, surface_to_light);
-                if (normal_dot_prod < 0.f){
-                    normal_dot_prod = 0.f;
-                }
-
-                R = -surface_to_light - 2.0*(-normal_dot_prod)*n;
-                break;
-            case 1: // SPOT LIGHT
-                theta_outer = lightVector[i].angle;
-                theta_inner = theta_outer - lightVector[i].penumbra;
-
-                /// IMPORTANT TO KEEP NEG light_to_intersection for spot light to work!!!
-                dot_prod = dot(lightDir, -light_to_intersection);
-                x = acos(dot_prod);
-
-                if (x <= theta_inner){
-                    spotIntensity = 1.f;
-                } else if (theta_inner < x && x <= theta_outer) {
-                    spotIntensity = 1.0f-falloff(x, theta_inner, theta_outer);
-                } else {
-                    spotIntensity = 0.f;
-                }
-
-                //DIFFUSE
-                normal_dot_prod = dot(n, light_to_intersection);
-                if (normal_dot_prod < 0.f){
-                    normal_dot_prod = 0.f;
-                }
-
-                R = -light_to_intersection - 2.0*(-normal_dot_prod)*n;
-                break;
-            case 2: // POINT LIGHT
-                normal_dot_prod = dot(n, light_to_intersection);
-                if (normal_dot_prod < 0.f){
-                    normal_dot_prod = 0.f;
-                }
-
-                R = -light_to_intersection - 2.0*(-normal_dot_prod)*n;
-                break;
-        }
-
-        vec4 diffuse_color = kd*shape_d;
-        diffuse_term += spotIntensity*f_att*lightColor*(diffuse_color*normal_dot_prod);
-
-        // SPECULAR TERM
-        float RV = dot((R), dirToCamera);
-        if (RV < 0.f){
-            RV = 0.f;
-        }
-
-        // clamp pow
-        if (shininess <= 0){
-            RV = 1.f;
-        } else {
-            RV = pow(RV, shininess);
-        }
-
-        specular_term += spotIntensity*f_att*lightColor*(ks*shape_s*RV);
+    vec4 light_term = shadeGlobalLights(world_space_pos, n, dirToCamera, shape_d, shape_s, shininess);
+
+    // find this fragment's cluster
+    float viewDepth = -(m_view*world_space_pos).z;
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / cluster_tile_size), cluster_dims.xy - 1);
+    int slice = clamp(int(log(viewDepth)*cluster_slice_params.x + cluster_slice_params.y), 0, cluster_dims.z - 1);
+    int cluster = (slice*cluster_dims.y + tile.y)*cluster_dims.x + tile.x;
+
+    uvec2 range = texelFetch(light_clusters, cluster).xy;
+    for (uint j=0u; j<range.y; j++){
+        int i = int(texelFetch(light_indices, int(range.x + j)).x);
+        light_term += shadeClusteredLight(i, world_space_pos, n, dirToCamera, shape_d, shape_s, shininess);
     }
 
-    fragColor = vec4(vec3(ambient_term + diffuse_term + specular_term), 1.0);
+    fragColor = vec4(vec3(ambient_term + light_term), 1.0);
 }
-
@@ -4,10 +4,19 @@
 layout(location = 0) in vec3 obj_space_pos;
 layout(location = 1) in vec3 obj_space_normal;
 
+// matches depth.vert's depth exactly, for the depth pre-pass
+invariant gl_Position;
+
 // out variables to be passed into frag shader
 out vec4 world_space_pos;
 out vec4 world_space_normal;
 
+// the shape's material, fetched per vertex rather than per fragment
+flat out vec4 shape_a;
+flat out vec4 shape_d;
+flat out vec4 shape_s;
+flat out float shininess;
+
 // uniforms mat4s to store matrices
 uniform mat4 m_model; // ctm
 uniform mat4 m_view;
@@ -15,13 +24,40 @@ uniform mat4 m_proj;
 
 uniform mat3 inverse_transpose_ctm;
 
+// cached meshes store positions quantized within their bounds and octahedral encoded normals,
+// primitives store plain floats and keep the defaults
+uniform vec3 pos_offset = vec3(0.0);
+uniform vec3 pos_scale = vec3(1.0);
+uniform bool oct_normals = false;
+
+// the scene's materials, 4 texels each: ambient, diffuse, specular, (shininess, 0, 0, 0). See MaterialBuffer
+uniform samplerBuffer material_data;
+uniform int material_index;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n;
+}
+
 void main() {
 
     // get world space position and normal
-    world_space_pos = (m_model)*(vec4(obj_space_pos, 1.0));
+    vec3 position = pos_offset + pos_scale * obj_space_pos;
+    vec3 normal = oct_normals ? octDecode(obj_space_normal.xy) : obj_space_normal;
+
+    world_space_pos = (m_model)*(vec4(position, 1.0));
 
-    world_space_normal = vec4((inverse_transpose_ctm)*(normalize(obj_space_normal)), 0.0);
+    world_space_normal = vec4((inverse_transpose_ctm)*(normalize(normal)), 0.0);
 
     // set gl_position to clip_space position
     gl_Position = (m_proj)*(m_view)*(world_space_pos);
+
+    int material = 4*material_index;
+    shape_a = texelFetch(material_data, material);
+    shape_d = texelFetch(material_data, material + 1);
+    shape_s = texelFetch(material_data, material + 2);
+    shininess = texelFetch(material_data, material + 3).x;
 }
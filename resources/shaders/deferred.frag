@@ -0,0 +1,42 @@
+#version 330 core
+
+// deferred shading light passes, added onto the geometry pass's ambient colour
+
+flat in int light_index;
+
+out vec4 fragColor;
+
+// G-buffer written by gbuffer.frag
+uniform sampler2D g_position;
+uniform sampler2D g_normal;
+uniform sampler2D g_diffuse;
+uniform sampler2D g_specular;
+
+uniform vec4 world_camera_pos;
+
+// defined in lighting.frag
+vec4 shadeGlobalLights(vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess);
+vec4 shadeClusteredLight(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess);
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 position = texelFetch(g_position, pixel, 0);
+    if (position.w == 0.0){
+        discard;
+    }
+
+    vec4 normal_shininess = texelFetch(g_normal, pixel, 0);
+    vec4 n = vec4(normalize(normal_shininess.xyz), 0.0);
+    vec4 diffuse = texelFetch(g_diffuse, pixel, 0);
+    vec4 specular = texelFetch(g_specular, pixel, 0);
+    vec4 dirToCamera = normalize(world_camera_pos-position);
+
+    vec4 light_term;
+    if (light_index < 0){
+        light_term = shadeGlobalLights(position, n, dirToCamera, diffuse, specular, normal_shininess.w);
+    } else {
+        light_term = shadeClusteredLight(light_index, position, n, dirToCamera, diffuse, specular, normal_shininess.w);
+    }
+
+    fragColor = vec4(vec3(light_term), 0.0);
+}
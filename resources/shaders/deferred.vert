@@ -0,0 +1,31 @@
+#version 330 core
+
+// deferred shading light passes: a fullscreen quad for lights that reach everywhere,
+// or one instanced sphere per light that lights only the pixels inside it
+layout(location = 0) in vec3 position;
+
+uniform bool light_volumes;
+uniform int first_light;            // light of instance 0
+uniform float volume_scale;         // grows the unit sphere mesh until it contains the whole sphere
+
+uniform samplerBuffer light_data;
+uniform mat4 m_view;
+uniform mat4 m_proj;
+
+flat out int light_index;           // -1 for the fullscreen pass
+
+void main() {
+    if (!light_volumes){
+        light_index = -1;
+        gl_Position = vec4(position, 1.0);
+        return;
+    }
+
+    light_index = first_light + gl_InstanceID;
+    vec3 center = texelFetch(light_data, light_index*4).xyz;
+    float radius = texelFetch(light_data, light_index*4 + 3).w;
+
+    // the sphere primitive has radius 0.5
+    vec3 world_space_pos = center + position*(2.0*radius*volume_scale);
+    gl_Position = (m_proj)*(m_view)*(vec4(world_space_pos, 1.0));
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+// depth pre-pass: must transform positions exactly like default.vert, so the shading pass's GL_EQUAL test passes
+layout(location = 0) in vec3 obj_space_pos;
+
+invariant gl_Position;
+
+uniform mat4 m_model;
+uniform mat4 m_view;
+uniform mat4 m_proj;
+
+uniform vec3 pos_offset = vec3(0.0);
+uniform vec3 pos_scale = vec3(1.0);
+
+void main() {
+    vec3 position = pos_offset + pos_scale * obj_space_pos;
+    vec4 world_space_pos = (m_model)*(vec4(position, 1.0));
+
+    gl_Position = (m_proj)*(m_view)*(world_space_pos);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// shades shapes while their real program is still compiling: diffuse colour lit from the camera
+
+in vec4 world_space_pos;
+in vec4 world_space_normal;
+
+out vec4 fragColor;
+
+flat in vec4 shape_d;
+uniform vec4 world_camera_pos;
+
+void main() {
+    vec4 n = normalize(world_space_normal);
+    vec4 dirToCamera = normalize(world_camera_pos-world_space_pos);
+    fragColor = vec4(shape_d.rgb*(0.2 + 0.8*max(dot(n, dirToCamera), 0.0)), 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+// deferred shading geometry pass: stores what lighting needs per pixel, see Filter::initiateGBuffer
+
+in vec4 world_space_pos;
+in vec4 world_space_normal;
+
+// lit colour, which starts out as the ambient term and gets the deferred light passes added to it
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec4 g_position;   // world space, w = 1 where there is geometry
+layout(location = 2) out vec4 g_normal;     // world space normal, w = shininess
+layout(location = 3) out vec4 g_diffuse;
+layout(location = 4) out vec4 g_specular;
+
+uniform float ka;
+
+// shape material coeff, from default.vert
+flat in float shininess;
+flat in vec4 shape_a;
+flat in vec4 shape_d;
+flat in vec4 shape_s;
+
+void main() {
+    fragColor = vec4(vec3(ka*shape_a), 1.0);
+
+    g_position = vec4(world_space_pos.xyz, 1.0);
+    g_normal = vec4(normalize(world_space_normal.xyz), shininess);
+    g_diffuse = shape_d;
+    g_specular = shape_s;
+}
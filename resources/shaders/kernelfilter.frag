@@ -5,8 +5,11 @@ in vec2 uv_coord;
 
 // add a sampler2D uniform
 uniform sampler2D m_texture;
-uniform bool postProcessOn;
-uniform bool isSharpen;
+
+// built as a ShaderVariants permutation: 0 passes the image through, 1 blurs it, 2 sharpens it
+#ifndef FILTER_MODE
+#define FILTER_MODE 0
+#endif
 
 uniform int image_width;
 uniform int image_height;
@@ -28,8 +31,8 @@ void main()
         float total_b = 0.f;
         float multiple;
 
-        if (postProcessOn){
-            if (isSharpen){ // SHARPENING
+#if FILTER_MODE == 2 // SHARPENING
+            {
                 float initial_height = uv_coord[0] + height_offset;
 
                 for (int i=0; i < 3; i++){ // row
@@ -65,7 +68,9 @@ void main()
 
                 fragColor = vec4(total_r, total_g, total_b, 1.0);
 
-            } else { // BLURRING
+            }
+#elif FILTER_MODE == 1 // BLURRING
+            {
 
                 float initial_height = uv_coord[0] + 2.f*height_offset;
 
@@ -96,6 +101,6 @@ void main()
 
                 fragColor = vec4(total_r, total_g, total_b, 1.0);
             }
-        }
+#endif
 }
 
@@ -0,0 +1,148 @@
+#version 330 core
+
+// Phong lighting shared by default.frag (forward) and deferred.frag, linked into both programs.
+// Built as a ShaderVariants permutation for the scene's lights (see Lights::getShaderDefines), so the
+// light type of every loop is known at compile time:
+//   NUM_GLOBAL_DIRECTIONAL, NUM_GLOBAL_SPOT, NUM_GLOBAL_POINT   lights that reach everywhere, in this order
+//   CLUSTERED_SPOT, CLUSTERED_POINT                             whether the remaining lights include the type
+
+uniform float kd;
+uniform float ks;
+
+// lights, 4 texels each: (pos, type) (dir, angle) (color, penumbra) (function, radius)
+// type 0: directional 1: spot 2: point, angles in RADIANS, radius 0 for lights that reach everywhere
+uniform samplerBuffer light_data;
+
+/**
+ * @brief Falloff function for SPOT lighting
+ * @param float x
+ * @param float theta_inner
+ * @param float theta_outer
+ */
+float falloff(float x, float theta_inner, float theta_outer){
+    float x_term = ((x-theta_inner)/(theta_outer-theta_inner));
+    // clamp pow
+    if (x_term <= 0){
+        return 0;
+    } else {
+        return (-2.0*pow(x_term, 3) + 3.0*pow(x_term,2));
+    }
+}
+
+/**
+ * @brief Diffuse and specular terms of a light of the given color and intensity arriving from surface_to_light
+ */
+vec4 phong(vec4 surface_to_light, vec4 n, vec4 dirToCamera, vec4 lightColor, float intensity,
+           vec4 diffuse, vec4 specular, float shininess){
+    float normal_dot_prod = max(dot(n, surface_to_light), 0.f);
+    vec4 R = -surface_to_light - 2.0*(-normal_dot_prod)*n;
+
+    vec4 diffuse_term = kd*diffuse*normal_dot_prod;
+
+    // SPECULAR TERM
+    float RV = max(dot((R), dirToCamera), 0.f);
+
+    // clamp pow
+    if (shininess <= 0){
+        RV = 1.f;
+    } else {
+        RV = pow(RV, shininess);
+    }
+
+    vec4 specular_term = ks*specular*RV;
+    return intensity*lightColor*(diffuse_term + specular_term);
+}
+
+/**
+ * @brief Attenuation at dist from a light with the given attenuation function
+ */
+float attenuation(vec3 function, float dist){
+    return min(1.0, 1.f/(function[0] + dist*function[1] + pow(dist, 2)*function[2]));
+}
+
+vec4 shadeDirectional(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess){
+    vec4 dirAngle = texelFetch(light_data, i*4 + 1);
+    vec4 lightColor = vec4(texelFetch(light_data, i*4 + 2).rgb, 1.0);
+
+    vec4 surface_to_light = -normalize(vec4(dirAngle.xyz, 0.0f));
+    return phong(surface_to_light, n, dirToCamera, lightColor, 1.f, diffuse, specular, shininess);
+}
+
+vec4 shadeSpot(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess){
+    vec4 posType = texelFetch(light_data, i*4);
+    vec4 dirAngle = texelFetch(light_data, i*4 + 1);
+    vec4 colorPenumbra = texelFetch(light_data, i*4 + 2);
+    vec3 function = texelFetch(light_data, i*4 + 3).xyz;
+
+    vec4 lightDir = normalize(vec4(dirAngle.xyz, 0.0f));
+    vec4 light_to_intersection = normalize(vec4(posType.xyz, 1.f) - position);
+
+    float theta_outer = dirAngle.w;
+    float theta_inner = theta_outer - colorPenumbra.w;
+
+    /// IMPORTANT TO KEEP NEG light_to_intersection for spot light to work!!!
+    float x = acos(dot(lightDir, -light_to_intersection));
+
+    float spotIntensity;
+    if (x <= theta_inner){
+        spotIntensity = 1.f;
+    } else if (theta_inner < x && x <= theta_outer) {
+        spotIntensity = 1.0f-falloff(x, theta_inner, theta_outer);
+    } else {
+        spotIntensity = 0.f;
+    }
+
+    float f_att = attenuation(function, distance(vec4(posType.xyz, 0.f), position));
+    return phong(light_to_intersection, n, dirToCamera, vec4(colorPenumbra.rgb, 1.0), spotIntensity*f_att,
+                 diffuse, specular, shininess);
+}
+
+vec4 shadePoint(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess){
+    vec4 posType = texelFetch(light_data, i*4);
+    vec4 lightColor = vec4(texelFetch(light_data, i*4 + 2).rgb, 1.0);
+    vec3 function = texelFetch(light_data, i*4 + 3).xyz;
+
+    vec4 light_to_intersection = normalize(vec4(posType.xyz, 1.f) - position);
+
+    float f_att = attenuation(function, distance(vec4(posType.xyz, 0.f), position));
+    return phong(light_to_intersection, n, dirToCamera, lightColor, f_att, diffuse, specular, shininess);
+}
+
+/**
+ * @brief Diffuse and specular contribution of every light that reaches everywhere
+ */
+vec4 shadeGlobalLights(vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess){
+    const int firstSpot = NUM_GLOBAL_DIRECTIONAL;
+    const int firstPoint = firstSpot + NUM_GLOBAL_SPOT;
+    const int end = firstPoint + NUM_GLOBAL_POINT;
+
+    vec4 light_term = vec4(0.f);
+    for (int i=0; i<firstSpot; i++){
+        light_term += shadeDirectional(i, position, n, dirToCamera, diffuse, specular, shininess);
+    }
+    for (int i=firstSpot; i<firstPoint; i++){
+        light_term += shadeSpot(i, position, n, dirToCamera, diffuse, specular, shininess);
+    }
+    for (int i=firstPoint; i<end; i++){
+        light_term += shadePoint(i, position, n, dirToCamera, diffuse, specular, shininess);
+    }
+    return light_term;
+}
+
+/**
+ * @brief Diffuse and specular contribution of light i, one of the lights with a finite radius
+ */
+vec4 shadeClusteredLight(int i, vec4 position, vec4 n, vec4 dirToCamera, vec4 diffuse, vec4 specular, float shininess){
+#if CLUSTERED_SPOT && CLUSTERED_POINT
+    if (int(texelFetch(light_data, i*4).w) == 1){
+        return shadeSpot(i, position, n, dirToCamera, diffuse, specular, shininess);
+    }
+    return shadePoint(i, position, n, dirToCamera, diffuse, specular, shininess);
+#elif CLUSTERED_SPOT
+    return shadeSpot(i, position, n, dirToCamera, diffuse, specular, shininess);
+#elif CLUSTERED_POINT
+    return shadePoint(i, position, n, dirToCamera, diffuse, specular, shininess);
+#else
+    return vec4(0.f);
+#endif
+}
@@ -5,8 +5,11 @@ in vec2 uv_coord;
 
 // Task 8: Add a sampler2D uniform
 uniform sampler2D m_texture;
-uniform bool postProcessOn;
-uniform bool isGrayScale;
+
+// built as a ShaderVariants permutation: 0 passes the image through, 1 inverts it, 2 turns it grayscale
+#ifndef FILTER_MODE
+#define FILTER_MODE 0
+#endif
 
 out vec4 fragColor;
 
@@ -15,16 +18,13 @@ void main()
         // set fragColor using the sampler2D at the UV coordinate
         fragColor = texture(m_texture, uv_coord);
 
-        // invert fragColor's r, g, and b color channels if your bool is true
-        if (postProcessOn){
-            if (isGrayScale){ // GRAYSCALE
-                float grayPixel = (.299*fragColor[0]) + (.587*fragColor[1]) + (.114*fragColor[2]);
-                fragColor = vec4(grayPixel, grayPixel, grayPixel, 1.0);
-            } else { // INVERT
-                float r = 1.f-fragColor[0];
-                float g = 1.f-fragColor[1];
-                float b = 1.f-fragColor[2];
-                fragColor = vec4(r,g,b, 1.f);
-            }
-        }
+#if FILTER_MODE == 2 // GRAYSCALE
+        float grayPixel = (.299*fragColor[0]) + (.587*fragColor[1]) + (.114*fragColor[2]);
+        fragColor = vec4(grayPixel, grayPixel, grayPixel, 1.0);
+#elif FILTER_MODE == 1 // INVERT
+        float r = 1.f-fragColor[0];
+        float g = 1.f-fragColor[1];
+        float b = 1.f-fragColor[2];
+        fragColor = vec4(r,g,b, 1.f);
+#endif
 }
@@ -17,6 +17,9 @@
  */
 void Camera::setRenderData(RenderData &renderDataParam){
     renderData = renderDataParam;
+
+    // height angle may have changed
+    projectionDirty = true;
 }
 
 /**
@@ -58,17 +61,24 @@ void Camera::initializeStandardRotateMatrix(){
 /**
  * @brief Calculates view matrix using the look, up, and pos vectors of Camera
  *        Stores glm::mat4 viewMatrix = rotationMatrix * translationMatrix
+ *        The view matrix is a rigid transform, so its inverse is translate(pos) * transpose(rotation)
  */
 void Camera::calculateViewMatrix(){
-    // make translation matrix (updated based on camera translation)
-    glm::mat4 transl_matrix = getTranslationMatrix(-pos[0], -pos[1], -pos[2]);
+    // render position lies between the last two simulated ticks
+    glm::vec4 renderPos = glm::mix(prevPos, pos, interpolationAlpha);
 
     // make rotate matrix (updated based on camera rotation)
     initializeStandardRotateMatrix();
 
     // stores variables inside camera
-    viewMatrix = rotationMatrix*transl_matrix;
-    inverseViewMatrix = glm::inverse(viewMatrix);
+    // rotationMatrix * translationMatrix(-pos) only changes the last column to -R*pos
+    viewMatrix = rotationMatrix;
+    viewMatrix[3] = glm::vec4(-glm::vec3(rotationMatrix*glm::vec4(glm::vec3(renderPos), 0.f)), 1.f);
+
+    inverseViewMatrix = glm::transpose(rotationMatrix);
+    inverseViewMatrix[3] = glm::vec4(glm::vec3(renderPos), 1.f);
+
+    viewDirty = false;
 }
 
 /**
@@ -91,6 +101,10 @@ glm::mat4 Camera::getInverseViewMatrix() const {
  * @brief Gets aspect ratio (W/H)
  */
 void Camera::setSceneDimensions(int width, int height){
+    if (width != scene_width || height != scene_height){
+        projectionDirty = true;
+    }
+
     scene_width = width;
     scene_height = height;
 }
@@ -173,6 +187,10 @@ glm::mat4 Camera::calculateRemapMatrix(){
  */
 void Camera::calculateFinalPerspectiveMatrix(float near, float far){
     perspectiveMatrix = calculateRemapMatrix()*calculateParallelPlaneMatrix(near, far)*calculateScalingMatrix(near, far);
+
+    nearPlane = near;
+    farPlane = far;
+    projectionDirty = false;
 }
 
 /**
@@ -192,6 +210,8 @@ void Camera::initializeCamera(RenderData &renderData){
     look = renderData.cameraData.look;
     pos = renderData.cameraData.pos;
     up = renderData.cameraData.up;
+    prevPos = pos;
+    viewDirty = true;
 
     // set renderData
     setRenderData(renderData);
@@ -199,17 +219,25 @@ void Camera::initializeCamera(RenderData &renderData){
 
 
 /**
- * @brief CALLED ONCE. Updates camera variables each time scene or settings are changed
+ * @brief Updates camera variables each time scene, settings or camera pose are changed.
+ *        Only the matrices whose inputs changed since the last call are recalculated
  */
 void Camera::updateCamera(float near, float far, int width, int height, RenderData &renderData){
     //set member vars
     setSceneDimensions(width, height);
+    if (near != nearPlane || far != farPlane){
+        projectionDirty = true;
+    }
 
     //m_view
-    calculateViewMatrix();
+    if (viewDirty){
+        calculateViewMatrix();
+    }
 
     // m_proj
-    calculateFinalPerspectiveMatrix(near, far);
+    if (projectionDirty){
+        calculateFinalPerspectiveMatrix(near, far);
+    }
 }
 
 /**
@@ -217,7 +245,8 @@ void Camera::updateCamera(float near, float far, int width, int height, RenderDa
  * @return glm::mat4 world_space_camera_pos
  */
 glm::vec4 Camera::getWorldSpaceCameraPos(){
-    return getInverseViewMatrix()*glm::vec4(0.f, 0.f, 0.f, 1.f);
+    // inverse view applied to the origin is just its translation column
+    return inverseViewMatrix[3];
 }
 
 /**
@@ -225,6 +254,7 @@ glm::vec4 Camera::getWorldSpaceCameraPos(){
  */
 void Camera::translateW(float deltaTime){
     pos += deltaTime*look;
+    viewDirty = true;
 }
 
 /**
@@ -232,6 +262,7 @@ void Camera::translateW(float deltaTime){
  */
 void Camera::translateS(float deltaTime){
     pos += (-deltaTime)*look;
+    viewDirty = true;
 }
 
 /**
@@ -251,6 +282,7 @@ void Camera::translateAD(float deltaTime, bool isLeft){
     } else {
         pos += (deltaTime)*perp;
     }
+    viewDirty = true;
 }
 
 
@@ -259,6 +291,7 @@ void Camera::translateAD(float deltaTime, bool isLeft){
  */
 void Camera::translateSpace(float deltaTime){
     pos += (deltaTime)*glm::vec4(0.f, 1.f, 0.f, 0.f);
+    viewDirty = true;
 }
 
 /**
@@ -266,6 +299,7 @@ void Camera::translateSpace(float deltaTime){
  */
 void Camera::translateCtrl(float deltaTime){
     pos += (deltaTime)*glm::vec4(0.f, -1.f, 0.f, 0.f);
+    viewDirty = true;
 }
 
 /**
@@ -274,6 +308,22 @@ void Camera::translateCtrl(float deltaTime){
 void Camera::resetCameraPos(){
     pos = renderData.cameraData.pos;
     look = renderData.cameraData.look;
+
+    // jump straight to the reset position instead of interpolating towards it
+    prevPos = pos;
+    viewDirty = true;
+}
+
+/**
+ * @brief Sets how far rendering is between the previous and the latest tick's position
+ * @param float alpha -- 0 is the previous tick, 1 is the latest tick
+ */
+void Camera::setInterpolationAlpha(float alpha){
+    // only moves the rendered position while the last tick actually moved the camera
+    if (alpha != interpolationAlpha && prevPos != pos){
+        viewDirty = true;
+    }
+    interpolationAlpha = alpha;
 }
 
 /**
@@ -327,14 +377,22 @@ void Camera::rotateCamera(float deltaX, float deltaY){
 
     // sets look member variable to new, transformed look value
     look = x_rotate*y_rotate*look;
+    viewDirty = true;
 }
 
 /**
- * @brief Linearly translates camera based on a keypress and the deltaTime of each translation
+ * @brief Linearly translates camera based on a keypress and the deltaTime of each translation.
+ *        Called once per fixed simulation tick
  * @param std::unordered_map<Qt::Key, bool> &m_keyMap -- detects if a key is pressed or not
  * @param float deltaTime -- 5 world space units/sec
  */
 void Camera::translateCamera(std::unordered_map<Qt::Key, bool> &m_keyMap, float deltaTime){
+    // the last tick moved the camera, so dropping its start position moves the rendered position too
+    if (prevPos != pos){
+        viewDirty = true;
+    }
+    prevPos = pos;
+
     if (m_keyMap[Qt::Key_W]){
         translateW(deltaTime);
     }
@@ -15,6 +15,7 @@ public:
     void updateCamera(float near, float far, int width, int height, RenderData &renderData);
     void translateCamera(std::unordered_map<Qt::Key, bool> &m_keyMap, float deltaTime);
     void rotateCamera(float deltaX, float deltaY);
+    void setInterpolationAlpha(float alpha);
 
     glm::mat4 getViewMatrix() const;
     glm::mat4 getInverseViewMatrix() const;
@@ -68,4 +69,14 @@ private:
     glm::vec4 look;
     glm::vec4 up;
     glm::vec4 pos;
+
+    // pos before the latest fixed tick, rendering blends prevPos -> pos by interpolationAlpha
+    glm::vec4 prevPos;
+    float interpolationAlpha = 1.f;
+
+    // cached matrices are only recalculated when what they depend on changes
+    bool viewDirty = true;       // pos, prevPos, look, up or interpolationAlpha changed
+    bool projectionDirty = true; // near, far, aspect ratio or height angle changed
+    float nearPlane = 0.f;
+    float farPlane = 0.f;
 };
@@ -7,6 +7,28 @@ Filter::Filter()
 
 }
 
+/**
+ * @brief Generates an empty texture to render into, set its min/mag filter interpolation, then unbinds it
+ * @param GLuint &texture
+ * @param GLint internalFormat
+ * @param GLenum type -- component type of the (empty) initial data
+ * @param GLint filter -- min and mag filter
+ * @param int m_fbo_width
+ * @param int m_fbo_height
+ */
+void Filter::makeFBOTexture(GLuint &texture, GLint internalFormat, GLenum type, GLint filter,
+                            int m_fbo_width, int m_fbo_height){
+    glGenTextures(1, &texture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_fbo_width, m_fbo_height, 0, GL_RGBA, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 /**
  * @brief Makes an FBO and default FBO.
  * @param GLuint &m_fbo_texture
@@ -22,17 +44,7 @@ void Filter::makeFBO(GLuint &m_fbo_texture,
                      GLuint &m_defaultFBO,
                      int m_fbo_width, int m_fbo_height){
 
-    // Generate and bind an empty texture, set its min/mag filter interpolation, then unbind
-    glGenTextures(1, &m_fbo_texture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_fbo_texture);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    // Set min and mag filters' interpolation mode to linear
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
+    makeFBOTexture(m_fbo_texture, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, m_fbo_width, m_fbo_height);
 
     // Generate and bind a renderbuffer of the right size, set its format, then unbind
     glGenRenderbuffers(1, &m_fbo_renderbuffer);
@@ -145,26 +157,15 @@ void Filter::updateFBOSettings(GLuint &m_fbo_texture,
 /**
  * @brief Activates the per-pixel shader, which handles grayscale and invert filtering
  * @param GLuint &texture
- * @param GLuint &m_invert_shader
+ * @param GLuint m_invert_shader -- the permutation of the filter to apply, see Realtime::paintTexture
  * @param GLuint &m_fullscreen_vao
- * @param bool perpixelOn
- * @param bool isGrayScale
  */
 void Filter::activatePerPixelFilter(GLuint &texture,
-                                    GLuint &m_invert_shader,
-                                    GLuint &m_fullscreen_vao,
-                                    bool perpixelOn,
-                                    bool isGrayScale){
+                                    GLuint m_invert_shader,
+                                    GLuint &m_fullscreen_vao){
     // activate shader program
     glUseProgram(m_invert_shader);
 
-    // bind bool uniforms
-    GLint invertOn_loc = glGetUniformLocation(m_invert_shader, "postProcessOn");
-    glUniform1i(invertOn_loc, perpixelOn);
-
-    GLint grayscale_loc = glGetUniformLocation(m_invert_shader, "isGrayScale");
-    glUniform1i(grayscale_loc, isGrayScale);
-
     // bind empty "texture" to slot 0
     glBindVertexArray(m_fullscreen_vao);
     glActiveTexture(GL_TEXTURE0);
@@ -179,28 +180,17 @@ void Filter::activatePerPixelFilter(GLuint &texture,
 /**
  * @brief Activates the kernel-based shader, which handles blur and sharpen filtering
  * @param GLuint &texture
- * @param GLuint &m_kernel_shader
+ * @param GLuint m_kernel_shader -- the permutation of the filter to apply, see Realtime::paintTexture
  * @param GLuint &m_fullscreen_vao
- * @param bool kernelFilterOn
- * @param bool isSharpen
  * @param int width -- width of image window
  * @param int height -- height of image window
  */
 void Filter::activateKernelFilter(GLuint &texture,
-                                  GLuint &m_kernel_shader,
+                                  GLuint m_kernel_shader,
                                   GLuint &m_fullscreen_vao,
-                                  bool kernelFilterOn,
-                                  bool isSharpen,
                                   int width, int height){
     glUseProgram(m_kernel_shader);
 
-    // set bool uniforms
-    GLint blurOn_loc = glGetUniformLocation(m_kernel_shader, "postProcessOn");
-    glUniform1i(blurOn_loc, kernelFilterOn);
-
-    GLint sharpen_loc = glGetUniformLocation(m_kernel_shader, "isSharpen");
-    glUniform1i(sharpen_loc, isSharpen);
-
     // set width and height uniforms
     glUniform1i(glGetUniformLocation(m_kernel_shader, "image_width"), width);
     glUniform1i(glGetUniformLocation(m_kernel_shader, "image_height"), height);
@@ -214,3 +204,86 @@ void Filter::activateKernelFilter(GLuint &texture,
     glBindVertexArray(0);
     glUseProgram(0);
 }
+
+/**
+ * @brief Makes the deferred shading G-buffer FBO. It shares the filter FBO's colour texture, which
+ *          receives the lit image, and its depth renderbuffer, so the light passes can run against
+ *          the geometry pass's depth and the filters read the result as before.
+ *          Position needs full float precision far from the origin; the rest fit in half floats.
+ * @param GLuint &m_fbo_texture -- made by makeFBO
+ * @param GLuint &m_fbo_renderbuffer -- made by makeFBO
+ * @param GLuint &m_gbuffer_fbo
+ * @param GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS]
+ * @param GLuint &m_defaultFBO
+ * @param int m_fbo_width
+ * @param int m_fbo_height
+ */
+void Filter::makeGBuffer(GLuint &m_fbo_texture,
+                         GLuint &m_fbo_renderbuffer,
+                         GLuint &m_gbuffer_fbo,
+                         GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                         GLuint &m_defaultFBO,
+                         int m_fbo_width, int m_fbo_height){
+    // the shaders fetch exact texels, so no filtering
+    makeFBOTexture(m_gbuffer_textures[0], GL_RGBA32F, GL_FLOAT, GL_NEAREST, m_fbo_width, m_fbo_height);
+    for (int i = 1; i < GBUFFER_TARGETS; i++){
+        makeFBOTexture(m_gbuffer_textures[i], GL_RGBA16F, GL_FLOAT, GL_NEAREST, m_fbo_width, m_fbo_height);
+    }
+
+    glGenFramebuffers(1, &m_gbuffer_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gbuffer_fbo);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_fbo_texture, 0);
+    std::vector<GLenum> drawBuffers = {GL_COLOR_ATTACHMENT0};
+    for (int i = 0; i < GBUFFER_TARGETS; i++){
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1 + i, GL_TEXTURE_2D, m_gbuffer_textures[i], 0);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT1 + i);
+    }
+    glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_fbo_renderbuffer);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_defaultFBO);
+}
+
+/**
+ * @brief Initiates the deferred shading G-buffer, after initiateFBO
+ * @param GLuint &m_fbo_texture
+ * @param GLuint &m_fbo_renderbuffer
+ * @param GLuint &m_gbuffer_fbo
+ * @param GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS]
+ * @param GLuint &m_defaultFBO
+ * @param int m_fbo_width
+ * @param int m_fbo_height
+ */
+void Filter::initiateGBuffer(GLuint &m_fbo_texture,
+                             GLuint &m_fbo_renderbuffer,
+                             GLuint &m_gbuffer_fbo,
+                             GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                             GLuint &m_defaultFBO,
+                             int m_fbo_width,
+                             int m_fbo_height){
+    makeGBuffer(m_fbo_texture, m_fbo_renderbuffer, m_gbuffer_fbo, m_gbuffer_textures, m_defaultFBO, m_fbo_width, m_fbo_height);
+}
+
+/**
+ * @brief Deletes the existing G-buffer and makes a new one according to new dimensions, after updateFBOSettings
+ * @param GLuint &m_fbo_texture
+ * @param GLuint &m_fbo_renderbuffer
+ * @param GLuint &m_gbuffer_fbo
+ * @param GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS]
+ * @param GLuint &m_defaultFBO
+ * @param int m_fbo_width
+ * @param int m_fbo_height
+ */
+void Filter::updateGBufferSettings(GLuint &m_fbo_texture,
+                                   GLuint &m_fbo_renderbuffer,
+                                   GLuint &m_gbuffer_fbo,
+                                   GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                                   GLuint &m_defaultFBO,
+                                   int m_fbo_width,
+                                   int m_fbo_height){
+    glDeleteTextures(GBUFFER_TARGETS, m_gbuffer_textures);
+    glDeleteFramebuffers(1, &m_gbuffer_fbo);
+
+    makeGBuffer(m_fbo_texture, m_fbo_renderbuffer, m_gbuffer_fbo, m_gbuffer_textures, m_defaultFBO, m_fbo_width, m_fbo_height);
+}
@@ -23,23 +23,45 @@ public:
                                    int m_fbo_width,
                                    int m_fbo_height);
     void activatePerPixelFilter(GLuint &texture,
-                                GLuint &m_invert_shader,
-                                GLuint &m_fullscreen_vao,
-                                bool perpixelOn,
-                                bool isGrayScale);
+                                GLuint m_invert_shader,
+                                GLuint &m_fullscreen_vao);
     void activateKernelFilter(GLuint &texture,
-                                      GLuint &m_kernel_shader,
+                                      GLuint m_kernel_shader,
                                       GLuint &m_fullscreen_vao,
-                                      bool kernelFilterOn,
-                                      bool isSharpen,
                                       int width, int height);
 
+    // Deferred shading G-buffer targets after the lit colour: position, normal + shininess, diffuse, specular
+    static constexpr int GBUFFER_TARGETS = 4;
+
+    void initiateGBuffer(GLuint &m_fbo_texture,
+                         GLuint &m_fbo_renderbuffer,
+                         GLuint &m_gbuffer_fbo,
+                         GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                         GLuint &m_defaultFBO,
+                         int m_fbo_width,
+                         int m_fbo_height);
+    void updateGBufferSettings(GLuint &m_fbo_texture,
+                               GLuint &m_fbo_renderbuffer,
+                               GLuint &m_gbuffer_fbo,
+                               GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                               GLuint &m_defaultFBO,
+                               int m_fbo_width,
+                               int m_fbo_height);
+
 private:
     void makeFBO(GLuint &m_fbo_texture,
                  GLuint &m_fbo_renderbuffer,
                  GLuint &m_fbo, GLuint
                  &m_defaultFBO,
                  int m_fbo_width, int m_fbo_height);
+    void makeFBOTexture(GLuint &texture, GLint internalFormat, GLenum type, GLint filter,
+                        int m_fbo_width, int m_fbo_height);
+    void makeGBuffer(GLuint &m_fbo_texture,
+                     GLuint &m_fbo_renderbuffer,
+                     GLuint &m_gbuffer_fbo,
+                     GLuint (&m_gbuffer_textures)[GBUFFER_TARGETS],
+                     GLuint &m_defaultFBO,
+                     int m_fbo_width, int m_fbo_height);
     void generateFullQuadData(GLuint &m_fullscreen_vbo, GLuint &m_fullscreen_vao);
 
 };
@@ -0,0 +1,91 @@
+#include "framescheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/**
+ * @param float tickRate -- simulation ticks per second
+ * @param int maxTicksPerFrame -- clamps catch-up after a stall, the rest are counted as missed
+ */
+FrameScheduler::FrameScheduler(float tickRate, int maxTicksPerFrame)
+    : m_tickDelta(1.f/tickRate), m_maxTicksPerFrame(maxTicksPerFrame)
+{
+
+}
+
+/**
+ * @brief Drops accumulated time, to be called whenever the frame loop (re)starts after idling
+ */
+void FrameScheduler::reset(){
+    m_accumulator = 0.f;
+}
+
+/**
+ * @brief Accumulates the time since the last frame and returns how many fixed ticks to simulate
+ * @param float frameSeconds -- wall time since the previous frame
+ * @return int number of ticks of getTickDelta() seconds to run before rendering
+ */
+int FrameScheduler::advance(float frameSeconds){
+    // frame interval statistics
+    m_frames++;
+    double delta = frameSeconds - m_intervalMean;
+    m_intervalMean += delta/m_frames;
+    m_intervalM2 += delta*(frameSeconds - m_intervalMean);
+    m_intervalMax = std::max(m_intervalMax, static_cast<double>(frameSeconds));
+
+    m_accumulator += frameSeconds;
+    int ticks = static_cast<int>(m_accumulator/m_tickDelta);
+    m_accumulator -= ticks*m_tickDelta;
+
+    // too far behind, so skip ahead instead of spiraling
+    if (ticks > m_maxTicksPerFrame){
+        m_missedTicks += ticks - m_maxTicksPerFrame;
+        ticks = m_maxTicksPerFrame;
+    }
+
+    m_ticks += ticks;
+    return ticks;
+}
+
+/**
+ * @brief Gets the fixed simulation step in seconds
+ */
+float FrameScheduler::getTickDelta() const {
+    return m_tickDelta;
+}
+
+/**
+ * @brief Gets how far (0-1) the current frame is between the previous and current tick
+ */
+float FrameScheduler::getAlpha() const {
+    return m_accumulator/m_tickDelta;
+}
+
+/**
+ * @brief Prints ticks, missed ticks and frame interval jitter since the last resetStats()
+ */
+void FrameScheduler::printStats() const {
+    if (m_frames == 0){
+        return;
+    }
+
+    double jitter = m_frames > 1 ? std::sqrt(m_intervalM2/(m_frames - 1)) : 0.0;
+
+    std::cout << "Frames: " << m_frames
+              << ", ticks: " << m_ticks
+              << ", missed ticks: " << m_missedTicks
+              << ", frame interval: " << m_intervalMean*1000.0 << "ms"
+              << " (jitter " << jitter*1000.0 << "ms, max " << m_intervalMax*1000.0 << "ms)" << std::endl;
+}
+
+/**
+ * @brief Clears frame and tick statistics
+ */
+void FrameScheduler::resetStats(){
+    m_frames = 0;
+    m_ticks = 0;
+    m_missedTicks = 0;
+    m_intervalMean = 0.0;
+    m_intervalM2 = 0.0;
+    m_intervalMax = 0.0;
+}
@@ -0,0 +1,36 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+
+// Fixed-timestep scheduler. Simulation (camera movement) advances in constant ticks,
+// independent of how often frames are painted. Leftover time is exposed as an
+// interpolation factor so rendering can blend between the last two simulated states.
+class FrameScheduler
+{
+public:
+    FrameScheduler(float tickRate = 120.f, int maxTicksPerFrame = 8);
+
+    void reset();
+    int advance(float frameSeconds);
+
+    float getTickDelta() const;
+    float getAlpha() const;
+
+    void printStats() const;
+    void resetStats();
+
+private:
+    float m_tickDelta;
+    int m_maxTicksPerFrame;
+    float m_accumulator = 0.f;
+
+    // stats, frame interval mean/variance are tracked with Welford's algorithm
+    long m_frames = 0;
+    long m_ticks = 0;
+    long m_missedTicks = 0;
+    double m_intervalMean = 0.0;
+    double m_intervalM2 = 0.0;
+    double m_intervalMax = 0.0;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -0,0 +1,136 @@
+#include "lightgrid.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Squared distance from p to the box [lower, upper]
+inline float distanceSquared(glm::vec3 p, glm::vec3 lower, glm::vec3 upper) {
+    glm::vec3 d = glm::max(glm::max(lower - p, p - upper), glm::vec3(0.f));
+    return glm::dot(d, d);
+}
+
+}
+
+/**
+ * @brief Finds the screen tiles a view space sphere covers, from the projected corners of its bounding box.
+ *        A sphere reaching behind the near plane may cover any tile
+ */
+void LightGrid::getTileRange(ViewLight &light, float xScale, float yScale, float near){
+    light.tileMin[0] = light.tileMin[1] = 0;
+    light.tileMax[0] = TILES_X - 1;
+    light.tileMax[1] = TILES_Y - 1;
+
+    float closest = -(light.center.z + light.radius);
+    if (closest <= near){
+        return;
+    }
+
+    glm::vec2 lower(1.f), upper(-1.f);
+    for (int corner = 0; corner < 8; corner++){
+        glm::vec3 p = light.center + light.radius*glm::vec3(corner & 1 ? 1.f : -1.f, corner & 2 ? 1.f : -1.f, corner & 4 ? 1.f : -1.f);
+        glm::vec2 ndc(xScale*p.x / -p.z, yScale*p.y / -p.z);
+        lower = glm::min(lower, ndc);
+        upper = glm::max(upper, ndc);
+    }
+
+    int tiles[2] = {TILES_X, TILES_Y};
+    for (int axis = 0; axis < 2; axis++){
+        float from = (lower[axis]*0.5f + 0.5f)*tiles[axis];
+        float to = (upper[axis]*0.5f + 0.5f)*tiles[axis];
+        light.tileMin[axis] = std::clamp(int(std::floor(from)), 0, tiles[axis]);
+        light.tileMax[axis] = std::clamp(int(std::floor(to)), -1, tiles[axis] - 1);
+    }
+}
+
+/**
+ * @brief View depth of a slice's near boundary, slice SLICES being the far plane
+ */
+float LightGrid::getSliceDepth(int slice) const {
+    return m_near * std::pow(m_far/m_near, float(slice)/SLICES);
+}
+
+void LightGrid::build(const std::vector<LightBounds> &lights, uint32_t firstLight,
+                      const glm::mat4 &view, const glm::mat4 &proj, float near, float far){
+    m_near = near;
+    m_far = std::max(far, near*1.001f);
+
+    // ndc = scale * view position / view depth
+    float xScale = proj[0][0] / -proj[2][3];
+    float yScale = proj[1][1] / -proj[2][3];
+
+    m_viewLights.resize(lights.size());
+    Parallel::forEach((int(lights.size()) + 1023)/1024, [&](int block){
+        size_t end = std::min(lights.size(), size_t(block + 1)*1024);
+        for (size_t i = size_t(block)*1024; i < end; i++){
+            ViewLight &light = m_viewLights[i];
+            light.center = glm::vec3(view*glm::vec4(lights[i].center, 1.f));
+            light.radius = lights[i].radius;
+            getTileRange(light, xScale, yScale, near);
+        }
+    });
+
+    // each slice owns its clusters, so slices are binned in parallel without locking
+    m_clusterLights.resize(CLUSTER_COUNT);
+    Parallel::forEach(SLICES, [&](int slice){
+        float sliceNear = getSliceDepth(slice);
+        float sliceFar = getSliceDepth(slice + 1);
+        std::vector<uint32_t> *clusters = &m_clusterLights[slice*TILES_X*TILES_Y];
+        for (int tile = 0; tile < TILES_X*TILES_Y; tile++){
+            clusters[tile].clear();
+        }
+
+        for (size_t i = 0; i < m_viewLights.size(); i++){
+            const ViewLight &light = m_viewLights[i];
+            float depth = -light.center.z;
+            if (depth + light.radius < sliceNear || depth - light.radius > sliceFar){
+                continue;
+            }
+
+            float radiusSquared = light.radius*light.radius;
+            for (int y = light.tileMin[1]; y <= light.tileMax[1]; y++){
+                // a tile's box in this slice spans its frustum corners at both slice depths
+                float yLow = (2.f*y/TILES_Y - 1.f)/yScale;
+                float yHigh = (2.f*(y + 1)/TILES_Y - 1.f)/yScale;
+                for (int x = light.tileMin[0]; x <= light.tileMax[0]; x++){
+                    float xLow = (2.f*x/TILES_X - 1.f)/xScale;
+                    float xHigh = (2.f*(x + 1)/TILES_X - 1.f)/xScale;
+                    glm::vec3 lower(std::min(xLow*sliceNear, xLow*sliceFar), std::min(yLow*sliceNear, yLow*sliceFar), -sliceFar);
+                    glm::vec3 upper(std::max(xHigh*sliceNear, xHigh*sliceFar), std::max(yHigh*sliceNear, yHigh*sliceFar), -sliceNear);
+                    if (distanceSquared(light.center, lower, upper) <= radiusSquared){
+                        clusters[y*TILES_X + x].push_back(firstLight + uint32_t(i));
+                    }
+                }
+            }
+        }
+    });
+
+    m_clusters.resize(CLUSTER_COUNT*2);
+    size_t total = 0;
+    for (int c = 0; c < CLUSTER_COUNT; c++){
+        m_clusters[c*2] = uint32_t(total);
+        m_clusters[c*2 + 1] = uint32_t(m_clusterLights[c].size());
+        total += m_clusterLights[c].size();
+    }
+    m_lightIndices.resize(total);
+    Parallel::forEach(SLICES, [&](int slice){
+        for (int c = slice*TILES_X*TILES_Y; c < (slice + 1)*TILES_X*TILES_Y; c++){
+            std::copy(m_clusterLights[c].begin(), m_clusterLights[c].end(), m_lightIndices.begin() + m_clusters[c*2]);
+        }
+    });
+}
+
+const std::vector<uint32_t> &LightGrid::getClusters() const {
+    return m_clusters;
+}
+
+const std::vector<uint32_t> &LightGrid::getLightIndices() const {
+    return m_lightIndices;
+}
+
+glm::vec2 LightGrid::getSliceParams() const {
+    float scale = SLICES / std::log(m_far/m_near);
+    return glm::vec2(scale, -std::log(m_near)*scale);
+}
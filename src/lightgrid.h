@@ -0,0 +1,58 @@
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Sphere a point or spot light reaches, in world space
+struct LightBounds {
+    glm::vec3 center;
+    float radius;
+};
+
+// Clustered light culling. The view frustum is split into TILES_X x TILES_Y screen tiles and SLICES
+// depth slices, spaced exponentially between the near and far planes, and every light is binned into
+// the clusters its bounding sphere touches. Fragments then only loop over their cluster's lights.
+class LightGrid
+{
+public:
+    static constexpr int TILES_X = 16;
+    static constexpr int TILES_Y = 9;
+    static constexpr int SLICES = 24;
+    static constexpr int CLUSTER_COUNT = TILES_X*TILES_Y*SLICES;
+
+    // Bins lights on the thread pool. Light i's index in the lists is firstLight + i.
+    // @param proj    A symmetric perspective projection, as Camera builds it.
+    void build(const std::vector<LightBounds> &lights, uint32_t firstLight,
+               const glm::mat4 &view, const glm::mat4 &proj, float near, float far);
+
+    // offset into getLightIndices() and light count of each cluster, x fastest then y then slice
+    const std::vector<uint32_t> &getClusters() const;
+    const std::vector<uint32_t> &getLightIndices() const;
+
+    // slice = log(view depth)*scale + bias
+    glm::vec2 getSliceParams() const;
+
+private:
+    // light in view space, and the tiles its sphere covers on screen
+    struct ViewLight {
+        glm::vec3 center;
+        float radius;
+        int tileMin[2];
+        int tileMax[2];
+    };
+
+    static void getTileRange(ViewLight &light, float xScale, float yScale, float near);
+    float getSliceDepth(int slice) const;
+
+    float m_near = 1.f;
+    float m_far = 1.f;
+
+    std::vector<ViewLight> m_viewLights;
+    std::vector<std::vector<uint32_t>> m_clusterLights;     // per cluster, reused between builds
+    std::vector<uint32_t> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+};
+
+#endif // LIGHTGRID_H
@@ -1,11 +1,77 @@
 #include "lights.h"
 #include "utils/scenedata.h"
 #include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// point and spot lights are culled where they fall below 1/256 of full brightness
+constexpr float LIGHT_CUTOFF = 1.f/256.f;
+
+// texture units of the light buffers in default.frag and deferred.frag
+constexpr int LIGHT_DATA_UNIT = 1;
+constexpr int LIGHT_CLUSTERS_UNIT = 2;
+constexpr int LIGHT_INDICES_UNIT = 3;
+
+}
 
 Lights::Lights()
 {
 }
 
+/**
+ * @brief Creates the light texture buffers, to be called once the GL context exists
+ */
+void Lights::initialize(){
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxTexels);
+
+    createTextureBuffer(m_lightBuffer, m_lightTexture, GL_RGBA32F);
+    createTextureBuffer(m_clusterBuffer, m_clusterTexture, GL_RG32UI);
+    createTextureBuffer(m_indexBuffer, m_indexTexture, GL_R32UI);
+
+    m_lightsDirty = true;
+    m_gridDirty = true;
+}
+
+void Lights::destroy(){
+    glDeleteTextures(1, &m_lightTexture);
+    glDeleteTextures(1, &m_clusterTexture);
+    glDeleteTextures(1, &m_indexTexture);
+    glDeleteBuffers(1, &m_lightBuffer);
+    glDeleteBuffers(1, &m_clusterBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+/**
+ * @brief Creates a buffer and a buffer texture reading it as format
+ */
+void Lights::createTextureBuffer(GLuint &buffer, GLuint &texture, GLenum format){
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_DYNAMIC_DRAW);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ * @brief Replaces a texture buffer's contents. Empty buffers keep one texel, as zero sized storage isn't allowed
+ */
+void Lights::uploadTextureBuffer(GLuint &buffer, const void *data, GLsizeiptr size){
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (size > 0){
+        glBufferData(GL_TEXTURE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    } else {
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
 /**
  * @brief Binds scene's lighting coefficients to shader
  */
@@ -17,8 +83,8 @@ void Lights::setSceneLightingCoeff(GLuint &m_shader, float ka, float kd, float k
 }
 
 /**
- * @brief Initializes and fills a ShaderLight struct item, to be passed into an array<ShaderLight>
- * @param GLuint &m_shader -- default rendering shader
+ * @brief Appends a light's 4 texels to the light data read by lighting.frag
+ * @param std::vector<glm::vec4> &data -- light data to append to
  * @param glm::vec3 pos
  * @param glm::vec3 dir
  * @param glm::vec3 color
@@ -26,97 +92,198 @@ void Lights::setSceneLightingCoeff(GLuint &m_shader, float ka, float kd, float k
  * @param float penumbra
  * @param float angle
  * @param int lightType -- 0: directional 1: spot 2: point
- * @param int j -- index to add ShaderLight item into array
+ * @param float radius -- see getLightRadius(), 0 for lights that light everything
  */
-void Lights::fillLightStruct(GLuint &m_shader,
+void Lights::fillLightStruct(std::vector<glm::vec4> &data,
                                glm::vec3 pos,
                                glm::vec3 dir,
                                glm::vec3 color,
                                glm::vec3 function,
-                               float penumbra, float angle, int lightType, int j){
-
-    //position (not applicable for directional
-    GLint pos_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].lightPos").c_str());
-    glUniform3f(pos_loc, pos[0], pos[1], pos[2]);
-
-    // direction (not applicable for point
-    GLint dir_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].lightDir").c_str());
-    glUniform3f(dir_loc, dir[0], dir[1], dir[2]);
-
-    //color
-    GLint color_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].lightColor").c_str());
-    glUniform3f(color_loc, color[0], color[1], color[2]);
-    //function
-    GLint func_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].function").c_str());
-    glUniform3f(func_loc, function[0], function[1], function[2]);
-    //penumbra
-    GLint pen_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].penumbra").c_str());
-    glUniform1f(pen_loc, penumbra);
-    //angle
-    GLint angle_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].angle").c_str());
-    glUniform1f(angle_loc, angle);
-    //type
-    GLint type_loc = glGetUniformLocation(m_shader, ("lightVector[" + std::to_string(j) + "].lightType").c_str());
-    glUniform1i(type_loc, lightType);
+                               float penumbra, float angle, int lightType,
+                               float radius){
+    data.push_back(glm::vec4(pos, float(lightType)));
+    data.push_back(glm::vec4(dir, angle));
+    data.push_back(glm::vec4(color, penumbra));
+    data.push_back(glm::vec4(function, radius));
 }
 
 /**
- * @brief Loops through lights in scene to create a ShaderLight struct and add to array<ShaderLight>
- *        inside fragment shader.
- * @param std::vector<SceneLightData> &lights -- light data from renderData
- * @param GLuint &m_shader -- main rendering shader
+ * @brief Distance past which a light's attenuation keeps it below LIGHT_CUTOFF,
+ *        or infinity if it never gets that dim
  */
-void Lights::addLightsToShader(std::vector<SceneLightData> &lights, GLuint &m_shader){
+float Lights::getLightRadius(const SceneLightData &light){
+    // solves c0 + c1*d + c2*d^2 = brightness/cutoff for d
+    float brightness = std::max({light.color.r, light.color.g, light.color.b, 0.f});
+    float c0 = light.function[0], c1 = light.function[1], c2 = light.function[2];
+    float target = brightness/LIGHT_CUTOFF - c0;
+    if (target <= 0.f){
+        return 0.f;
+    }
+    if (c2 > 0.f){
+        return (-c1 + std::sqrt(c1*c1 + 4.f*c2*target)) / (2.f*c2);
+    }
+    if (c1 > 0.f){
+        return target/c1;
+    }
+    return INFINITY;
+}
 
-    // counter for lightPositions and lightColors
-    // keeps track of where things are in the light arrays
-    int j = 0;
+/**
+ * @brief Packs the scene's lights, to be called whenever the scene changes. Directional lights and lights
+ *        too bright to ever fade out go first, sorted by type, and light everything. The rest are clustered
+ * @param std::vector<SceneLightData> &lights -- light data from renderData
+ */
+void Lights::updateLights(const std::vector<SceneLightData> &lights){
+    m_lightData.clear();
+    m_bounds.clear();
+    glm::vec3 dummyPos(0.f);
+    glm::vec3 dummyDir(0.f);
 
+    // global lights by lighting.frag's type number, so its loops over them know the type
+    std::vector<const SceneLightData *> global[3];
+    std::vector<const SceneLightData *> clustered;
     for (const SceneLightData &light : lights){
-
-        // only implementing directional lights for now
-        GLint posLoc;
-        GLint colorLoc;
-        glm::vec3 dummyPos(0.f);
-        glm::vec3 dummyDir(0.f);
-
         switch (light.type){
             case LightType::LIGHT_DIRECTIONAL:
-                // make light struct inside shader
-                fillLightStruct(m_shader, dummyPos, light.dir, light.color,
-                                light.function, 0, 0, 0, j);
+                global[0].push_back(&light);
                 break;
             case LightType::LIGHT_SPOT:
-                fillLightStruct(m_shader, light.pos, light.dir, light.color,
-                                light.function, light.penumbra, light.angle, 1, j);
-                break;
             case LightType::LIGHT_POINT:
-                fillLightStruct(m_shader, light.pos, dummyDir, light.color,
-                                light.function, 0, 0, 2, j);
+                if (std::isinf(getLightRadius(light))){
+                    global[light.type == LightType::LIGHT_SPOT ? 1 : 2].push_back(&light);
+                } else {
+                    clustered.push_back(&light);
+                }
                 break;
             default:
             break;
         }
+    }
+
+    for (const SceneLightData *light : global[0]){
+        fillLightStruct(m_lightData, dummyPos, light->dir, light->color, light->function, 0, 0, 0, 0);
+    }
+    for (const SceneLightData *light : global[1]){
+        fillLightStruct(m_lightData, light->pos, light->dir, light->color, light->function, light->penumbra, light->angle, 1, 0);
+    }
+    for (const SceneLightData *light : global[2]){
+        fillLightStruct(m_lightData, light->pos, dummyDir, light->color, light->function, 0, 0, 2, 0);
+    }
+    for (int type = 0; type < 3; type++){
+        m_globalTypeCounts[type] = global[type].size();
+    }
+    m_globalLightCount = m_lightData.size()/4;
+
+    m_clusteredSpot = m_clusteredPoint = false;
+    for (const SceneLightData *light : clustered){
+        float radius = getLightRadius(*light);
+        if (light->type == LightType::LIGHT_SPOT){
+            fillLightStruct(m_lightData, light->pos, light->dir, light->color, light->function, light->penumbra, light->angle, 1, radius);
+            m_clusteredSpot = true;
+        } else {
+            fillLightStruct(m_lightData, light->pos, dummyDir, light->color, light->function, 0, 0, 2, radius);
+            m_clusteredPoint = true;
+        }
+        m_bounds.push_back({glm::vec3(light->pos), radius});
+    }
+
+    m_lightsDirty = true;
+    m_gridDirty = true;
+}
 
-        //increment j to indicate next light index
-        j++;
+/**
+ * @brief Defines for the lighting.frag permutation matching the current lights. Only light types the
+ *        scene has are compiled in, so the scene's shaders don't branch on light types they never see
+ */
+ShaderDefines Lights::getShaderDefines() const {
+    return {
+        {"NUM_GLOBAL_DIRECTIONAL", m_globalTypeCounts[0]},
+        {"NUM_GLOBAL_SPOT", m_globalTypeCounts[1]},
+        {"NUM_GLOBAL_POINT", m_globalTypeCounts[2]},
+        {"CLUSTERED_SPOT", m_clusteredSpot},
+        {"CLUSTERED_POINT", m_clusteredPoint},
+    };
+}
+
+/**
+ * @brief Uploads the light data if the lights changed since the last upload. cullLights() does this too,
+ *        deferred shading only needs the light data and not the clusters
+ */
+void Lights::uploadLights(){
+    if (m_lightsDirty){
+        uploadTextureBuffer(m_lightBuffer, m_lightData.data(), m_lightData.size()*sizeof(glm::vec4));
+        m_lightsDirty = false;
     }
+}
+
+/**
+ * @brief Bins the clustered lights for the current camera and uploads the cluster lists.
+ *        Called every frame, but only does work when the camera or the lights changed
+ */
+void Lights::cullLights(const glm::mat4 &view, const glm::mat4 &proj, float near, float far){
+    uploadLights();
+
+    if (!m_gridDirty && view == m_gridView && proj == m_gridProj && near == m_gridNear && far == m_gridFar){
+        return;
+    }
+    m_gridView = view;
+    m_gridProj = proj;
+    m_gridNear = near;
+    m_gridFar = far;
+    m_gridDirty = false;
+
+    m_grid.build(m_bounds, m_globalLightCount, view, proj, near, far);
+
+    // clusters past the largest buffer texture the driver supports drop their lights
+    std::vector<uint32_t> clusters = m_grid.getClusters();
+    const std::vector<uint32_t> &indices = m_grid.getLightIndices();
+    if (indices.size() > size_t(m_maxTexels)){
+        for (size_t c = 0; c < clusters.size(); c += 2){
+            clusters[c + 1] = std::min(clusters[c + 1], uint32_t(std::max<int64_t>(int64_t(m_maxTexels) - clusters[c], 0)));
+        }
+    }
+
+    uploadTextureBuffer(m_clusterBuffer, clusters.data(), clusters.size()*sizeof(uint32_t));
+    uploadTextureBuffer(m_indexBuffer, indices.data(), std::min<size_t>(indices.size(), m_maxTexels)*sizeof(uint32_t));
+}
+
+/**
+ * @brief Binds the light buffers and the cluster grid's layout to the shader
+ * @param GLuint &m_shader -- main rendering shader
+ * @param int screenWidth, screenHeight -- size of the framebuffer being drawn, in pixels
+ */
+void Lights::addLightsToShader(GLuint &m_shader, int screenWidth, int screenHeight){
+    glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_CLUSTERS_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_INDICES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(m_shader, "light_data"), LIGHT_DATA_UNIT);
+    glUniform1i(glGetUniformLocation(m_shader, "light_clusters"), LIGHT_CLUSTERS_UNIT);
+    glUniform1i(glGetUniformLocation(m_shader, "light_indices"), LIGHT_INDICES_UNIT);
 
-    // pass in j, or the number of lights that were added
-    glUniform1i(glGetUniformLocation(m_shader, "numLights"),j);
+    glm::vec2 tileSize(float(screenWidth)/LightGrid::TILES_X, float(screenHeight)/LightGrid::TILES_Y);
+    glm::vec2 sliceParams = m_grid.getSliceParams();
+    glUniform3i(glGetUniformLocation(m_shader, "cluster_dims"), LightGrid::TILES_X, LightGrid::TILES_Y, LightGrid::SLICES);
+    glUniform2f(glGetUniformLocation(m_shader, "cluster_tile_size"), tileSize[0], tileSize[1]);
+    glUniform2f(glGetUniformLocation(m_shader, "cluster_slice_params"), sliceParams[0], sliceParams[1]);
 }
 
 /**
- * @brief Sets up light data that is passed into shader. Called in Realtime.
+ * @brief Sets up light data that is passed into shader. Called in Realtime, after cullLights().
  * @param GLuint &m_shader
- * @param std::vector<SceneLightData> &lights
+ * @param int screenWidth, screenHeight -- size of the framebuffer being drawn, in pixels
  * @param float ka, kd, ks -- entire scene lighting coefficients. Passed in once into shader.
  */
 void Lights::setupLightData(GLuint &m_shader,
-                            std::vector<SceneLightData> &lights,
+                            int screenWidth,
+                            int screenHeight,
                             float ka,
                             float kd,
                             float ks){
     setSceneLightingCoeff(m_shader, ka, kd, ks);
-    addLightsToShader(lights, m_shader);
+    addLightsToShader(m_shader, screenWidth, screenHeight);
 }
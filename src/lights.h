@@ -1,29 +1,73 @@
 #ifndef LIGHTS_H
 #define LIGHTS_H
+#include "lightgrid.h"
 #include "utils/scenedata.h"
+#include "utils/shadervariants.h"
 #include <GL/glew.h>
 #include <vector>
 
 
+// Scene lights for lighting.frag. Light data lives in texture buffers, so scenes may have any number of
+// lights. Point and spot lights are clustered by LightGrid, so each fragment only shades the lights near it
 class Lights
 {
 public:
     Lights();
-    void setupLightData(GLuint &m_shader, std::vector<SceneLightData> &lights,
+    void initialize();
+    void destroy();
+
+    void updateLights(const std::vector<SceneLightData> &lights);
+    void uploadLights();
+    void cullLights(const glm::mat4 &view, const glm::mat4 &proj, float near, float far);
+    void setupLightData(GLuint &m_shader, int screenWidth, int screenHeight,
                                 float ka, float kd, float ks);
+    void setSceneLightingCoeff(GLuint &m_shader, float ka, float kd, float ks);
+
+    // Lights [0, getGlobalLightCount()) light everything, the rest have a finite radius
+    int getGlobalLightCount() const { return m_globalLightCount; }
+    int getLightCount() const { return m_lightData.size()/4; }
 
+    // Light types and global light counts lighting.frag is specialized for
+    ShaderDefines getShaderDefines() const;
 
 private:
-    void setSceneLightingCoeff(GLuint &m_shader, float ka, float kd, float ks);
-    void addLightsToShader(std::vector<SceneLightData> &lights, GLuint &m_shader);
-    void fillLightStruct(GLuint &m_shader,
+    void addLightsToShader(GLuint &m_shader, int screenWidth, int screenHeight);
+    void fillLightStruct(std::vector<glm::vec4> &data,
                                    glm::vec3 pos,
                                    glm::vec3 dir,
                                    glm::vec3 color,
                                    glm::vec3 function,
-                                   float penumbra, float angle, int lightType, int j);
+                                   float penumbra, float angle, int lightType,
+                                   float radius);
+    static float getLightRadius(const SceneLightData &light);
+
+    void createTextureBuffer(GLuint &buffer, GLuint &texture, GLenum format);
+    void uploadTextureBuffer(GLuint &buffer, const void *data, GLsizeiptr size);
+
+    // scene lights, directional then unbounded spot then unbounded point lights first
+    std::vector<glm::vec4> m_lightData;                 // 4 texels per light, as read by lighting.frag
+    std::vector<LightBounds> m_bounds;                  // of the clustered lights after the global ones
+    int m_globalLightCount = 0;
+    int m_globalTypeCounts[3] = {};                     // global lights per type: directional, spot, point
+    bool m_clusteredSpot = false;                       // whether any clustered light is a spot light
+    bool m_clusteredPoint = false;
+    bool m_lightsDirty = true;                          // whether m_lightData still has to be uploaded
 
+    // binning is redone only when the camera or the lights change
+    LightGrid m_grid;
+    bool m_gridDirty = true;
+    glm::mat4 m_gridView = glm::mat4(1.f);
+    glm::mat4 m_gridProj = glm::mat4(1.f);
+    float m_gridNear = 0.f;
+    float m_gridFar = 0.f;
+    GLint m_maxTexels = 65536;                          // GL_MAX_TEXTURE_BUFFER_SIZE
 
+    GLuint m_lightBuffer = 0;
+    GLuint m_lightTexture = 0;
+    GLuint m_clusterBuffer = 0;
+    GLuint m_clusterTexture = 0;
+    GLuint m_indexBuffer = 0;
+    GLuint m_indexTexture = 0;
 };
 
 #endif // LIGHTS_H
@@ -32,6 +32,9 @@ void MainWindow::initialize() {
     QLabel *filters_label = new QLabel(); // Filters label
     filters_label->setText("Filters");
     filters_label->setFont(font);
+    QLabel *rendering_label = new QLabel(); // Rendering label
+    rendering_label->setText("Rendering");
+    rendering_label->setFont(font);
     QLabel *ec_label = new QLabel(); // Extra Credit label
     ec_label->setText("Extra Credit");
     ec_label->setFont(font);
@@ -43,6 +46,10 @@ void MainWindow::initialize() {
     near_label->setText("Near Plane:");
     QLabel *far_label = new QLabel(); // Far plane label
     far_label->setText("Far Plane:");
+    QLabel *fps_label = new QLabel(); // Frame rate cap label
+    fps_label->setText("Max FPS (0 = display refresh):");
+    QLabel *benchmark_lights_label = new QLabel(); // Benchmark light count label
+    benchmark_lights_label->setText("Benchmark Lights:");
 
 
 
@@ -56,10 +63,75 @@ void MainWindow::initialize() {
     filter2->setText(QStringLiteral("Kernel-Based Filter"));
     filter2->setChecked(false);
 
+    // Create checkbox for continuous (benchmark) rendering, otherwise frames are drawn on demand
+    continuousRender = new QCheckBox();
+    continuousRender->setText(QStringLiteral("Continuous Rendering"));
+    continuousRender->setChecked(false);
+
+    // Create number box for the frame rate cap while moving
+    maxFrameRateBox = new QSpinBox();
+    maxFrameRateBox->setMinimum(0);
+    maxFrameRateBox->setMaximum(240);
+    maxFrameRateBox->setSingleStep(1);
+    maxFrameRateBox->setValue(settings.maxFrameRate);
+
+    // Create checkbox for the packed primitive vertex format
+    packedVertices = new QCheckBox();
+    packedVertices->setText(QStringLiteral("Packed Vertices"));
+    packedVertices->setChecked(false);
+
+    // Create checkbox for the depth pre-pass
+    depthPrepass = new QCheckBox();
+    depthPrepass->setText(QStringLiteral("Depth Pre-Pass"));
+    depthPrepass->setChecked(false);
+
+    // Create checkbox for deferred shading
+    deferredShading = new QCheckBox();
+    deferredShading->setText(QStringLiteral("Deferred Shading"));
+    deferredShading->setChecked(false);
+
+    // Create checkbox for reloading shaders as they are edited
+    shaderHotReload = new QCheckBox();
+    shaderHotReload->setText(QStringLiteral("Shader Hot Reload"));
+    shaderHotReload->setChecked(false);
+
+    // Create number box for the random lights added to the scene
+    benchmarkLightsBox = new QSpinBox();
+    benchmarkLightsBox->setMinimum(0);
+    benchmarkLightsBox->setMaximum(10000);
+    benchmarkLightsBox->setSingleStep(100);
+    benchmarkLightsBox->setValue(settings.benchmarkLights);
+
+    // Create checkbox for the CPU benchmarks, run when it is checked
+    cpuBenchmarks = new QCheckBox();
+    cpuBenchmarks->setText(QStringLiteral("CPU Benchmarks"));
+    cpuBenchmarks->setChecked(false);
+
     // Create file uploader for scene file
     uploadFile = new QPushButton();
     uploadFile->setText(QStringLiteral("Upload Scene File"));
 
+    // Create progress bar for the scene being loaded, only shown while it loads
+    sceneLoadProgress = new QProgressBar();
+    sceneLoadProgress->setRange(0, 100);
+    sceneLoadProgress->setFormat(QStringLiteral("Loading scene %p%"));
+    sceneLoadProgress->setVisible(false);
+    realtime->setSceneLoadProgressHandler([this](float progress){
+        sceneLoadProgress->setValue(int(progress * 100.f));
+        sceneLoadProgress->setVisible(progress < 1.f);
+    });
+
+    // Create label for the shape the last click picked in the scene
+    pickedShape = new QLabel();
+    pickedShape->setText(QStringLiteral("Click a shape to pick it"));
+    realtime->setPickHandler([this](const ShapeBVH::Hit &hit){
+        if (hit.shape >= 0){
+            pickedShape->setText(QStringLiteral("Picked shape %1 at distance %2").arg(hit.shape).arg(hit.t, 0, 'f', 2));
+        } else {
+            pickedShape->setText(QStringLiteral("Picked nothing"));
+        }
+    });
+
     // Creates the boxes containing the parameter sliders and number boxes
     QGroupBox *p1Layout = new QGroupBox(); // horizonal slider 1 alignment
     QHBoxLayout *l1 = new QHBoxLayout();
@@ -158,6 +230,8 @@ void MainWindow::initialize() {
     ec4->setChecked(false);
 
     vLayout->addWidget(uploadFile);
+    vLayout->addWidget(sceneLoadProgress);
+    vLayout->addWidget(pickedShape);
     vLayout->addWidget(tesselation_label);
     vLayout->addWidget(param1_label);
     vLayout->addWidget(p1Layout);
@@ -171,6 +245,17 @@ void MainWindow::initialize() {
     vLayout->addWidget(filters_label);
     vLayout->addWidget(filter1);
     vLayout->addWidget(filter2);
+    vLayout->addWidget(rendering_label);
+    vLayout->addWidget(continuousRender);
+    vLayout->addWidget(fps_label);
+    vLayout->addWidget(maxFrameRateBox);
+    vLayout->addWidget(packedVertices);
+    vLayout->addWidget(depthPrepass);
+    vLayout->addWidget(deferredShading);
+    vLayout->addWidget(benchmark_lights_label);
+    vLayout->addWidget(benchmarkLightsBox);
+    vLayout->addWidget(cpuBenchmarks);
+    vLayout->addWidget(shaderHotReload);
     // Extra Credit:
     vLayout->addWidget(ec_label);
     vLayout->addWidget(ec1);
@@ -203,6 +288,14 @@ void MainWindow::connectUIElements() {
     connectNear();
     connectFar();
     connectExtraCredit();
+    connectContinuousRender();
+    connectMaxFrameRate();
+    connectPackedVertices();
+    connectDepthPrepass();
+    connectDeferredShading();
+    connectBenchmarkLights();
+    connectShaderHotReload();
+    connectCpuBenchmarks();
 }
 
 void MainWindow::connectPerPixelFilter() {
@@ -248,6 +341,40 @@ void MainWindow::connectExtraCredit() {
     connect(ec4, &QCheckBox::clicked, this, &MainWindow::onExtraCredit4);
 }
 
+void MainWindow::connectContinuousRender() {
+    connect(continuousRender, &QCheckBox::clicked, this, &MainWindow::onContinuousRender);
+}
+
+void MainWindow::connectMaxFrameRate() {
+    connect(maxFrameRateBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeMaxFrameRate);
+}
+
+void MainWindow::connectPackedVertices() {
+    connect(packedVertices, &QCheckBox::clicked, this, &MainWindow::onPackedVertices);
+}
+
+void MainWindow::connectDepthPrepass() {
+    connect(depthPrepass, &QCheckBox::clicked, this, &MainWindow::onDepthPrepass);
+}
+
+void MainWindow::connectDeferredShading() {
+    connect(deferredShading, &QCheckBox::clicked, this, &MainWindow::onDeferredShading);
+}
+
+void MainWindow::connectShaderHotReload() {
+    connect(shaderHotReload, &QCheckBox::clicked, this, &MainWindow::onShaderHotReload);
+}
+
+void MainWindow::connectCpuBenchmarks() {
+    connect(cpuBenchmarks, &QCheckBox::clicked, this, &MainWindow::onCpuBenchmarks);
+}
+
+void MainWindow::connectBenchmarkLights() {
+    connect(benchmarkLightsBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeBenchmarkLights);
+}
+
 void MainWindow::onPerPixelFilter() {
     settings.perPixelFilter = !settings.perPixelFilter;
     realtime->settingsChanged();
@@ -268,8 +395,9 @@ void MainWindow::onUploadFile() {
 
     settings.sceneFilePath = configFilePath.toStdString();
 
-    std::cout << "Loaded scenefile: \"" << configFilePath.toStdString() << "\"." << std::endl;
+    std::cout << "Loading scenefile: \"" << configFilePath.toStdString() << "\"." << std::endl;
 
+    // a scene still loading is cancelled in favour of the new one
     realtime->sceneChanged();
 }
 
@@ -316,6 +444,46 @@ void MainWindow::onValChangeFarBox(double newValue) {
     realtime->settingsChanged();
 }
 
+void MainWindow::onContinuousRender() {
+    settings.continuousRender = !settings.continuousRender;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeMaxFrameRate(int newValue) {
+    settings.maxFrameRate = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onPackedVertices() {
+    settings.packedVertices = !settings.packedVertices;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDepthPrepass() {
+    settings.depthPrepass = !settings.depthPrepass;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDeferredShading() {
+    settings.deferredShading = !settings.deferredShading;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onShaderHotReload() {
+    settings.shaderHotReload = !settings.shaderHotReload;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeBenchmarkLights(int newValue) {
+    settings.benchmarkLights = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onCpuBenchmarks() {
+    settings.cpuBenchmarks = !settings.cpuBenchmarks;
+    realtime->settingsChanged();
+}
+
 // Extra Credit:
 
 void MainWindow::onExtraCredit1() {
@@ -6,6 +6,8 @@
 #include <QSpinBox>
 #include <QDoubleSpinBox>
 #include <QPushButton>
+#include <QProgressBar>
+#include <QLabel>
 #include "realtime.h"
 
 class MainWindow : public QWidget
@@ -26,11 +28,21 @@ private:
     void connectKernelBasedFilter();
     void connectUploadFile();
     void connectExtraCredit();
+    void connectContinuousRender();
+    void connectMaxFrameRate();
+    void connectPackedVertices();
+    void connectDepthPrepass();
+    void connectDeferredShading();
+    void connectShaderHotReload();
+    void connectBenchmarkLights();
+    void connectCpuBenchmarks();
 
     Realtime *realtime;
     QCheckBox *filter1;
     QCheckBox *filter2;
     QPushButton *uploadFile;
+    QProgressBar *sceneLoadProgress;
+    QLabel *pickedShape;
     QSlider *p1Slider;
     QSlider *p2Slider;
     QSpinBox *p1Box;
@@ -39,6 +51,14 @@ private:
     QSlider *farSlider;
     QDoubleSpinBox *nearBox;
     QDoubleSpinBox *farBox;
+    QCheckBox *continuousRender;
+    QSpinBox *maxFrameRateBox;
+    QCheckBox *packedVertices;
+    QCheckBox *depthPrepass;
+    QCheckBox *deferredShading;
+    QCheckBox *shaderHotReload;
+    QSpinBox *benchmarkLightsBox;
+    QCheckBox *cpuBenchmarks;
 
     // Extra Credit:
     QCheckBox *ec1;
@@ -56,6 +76,14 @@ private slots:
     void onValChangeFarSlider(int newValue);
     void onValChangeNearBox(double newValue);
     void onValChangeFarBox(double newValue);
+    void onContinuousRender();
+    void onValChangeMaxFrameRate(int newValue);
+    void onPackedVertices();
+    void onDepthPrepass();
+    void onDeferredShading();
+    void onShaderHotReload();
+    void onValChangeBenchmarkLights(int newValue);
+    void onCpuBenchmarks();
 
     // Extra Credit:
     void onExtraCredit1();
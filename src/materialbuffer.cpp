@@ -0,0 +1,76 @@
+#include "materialbuffer.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace {
+
+// texture unit of material_data, after the light buffers and the G-buffer
+constexpr int MATERIAL_DATA_UNIT = 8;
+
+constexpr int TEXELS_PER_MATERIAL = 4;
+
+}
+
+/**
+ * @brief Creates the buffer and its buffer texture, to be called once the GL context exists
+ */
+void MaterialBuffer::initialize(){
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, TEXELS_PER_MATERIAL*sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+    m_capacity = 1;
+    m_uploaded = 0;
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void MaterialBuffer::destroy(){
+    glDeleteTextures(1, &m_texture);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+/**
+ * @brief Appends the new materials with glBufferSubData. The buffer doubles when it runs out of room,
+ *        re-uploading everything once, so streaming a scene in costs linear time overall
+ */
+void MaterialBuffer::update(const std::vector<ShapeMaterial> &materials){
+    if (materials.size() < m_uploaded){
+        m_uploaded = 0;
+    }
+    if (materials.size() == m_uploaded){
+        return;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    if (materials.size() > m_capacity){
+        m_capacity = std::max(materials.size(), 2*m_capacity);
+        glBufferData(GL_TEXTURE_BUFFER, m_capacity*TEXELS_PER_MATERIAL*sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+        m_uploaded = 0;
+    }
+
+    std::vector<glm::vec4> texels;
+    texels.reserve((materials.size() - m_uploaded)*TEXELS_PER_MATERIAL);
+    for (size_t i = m_uploaded; i < materials.size(); i++){
+        texels.push_back(materials[i].ambient);
+        texels.push_back(materials[i].diffuse);
+        texels.push_back(materials[i].specular);
+        texels.push_back(glm::vec4(materials[i].shininess, 0.f, 0.f, 0.f));
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, m_uploaded*TEXELS_PER_MATERIAL*sizeof(glm::vec4),
+                    texels.size()*sizeof(glm::vec4), texels.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    m_uploaded = materials.size();
+}
+
+void MaterialBuffer::bind(GLuint shader){
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(shader, "material_data"), MATERIAL_DATA_UNIT);
+}
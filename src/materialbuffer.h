@@ -0,0 +1,34 @@
+#ifndef MATERIALBUFFER_H
+#define MATERIALBUFFER_H
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include "utils/scenestore.h"
+#include <vector>
+
+
+// The scene's materials for default.vert, in a texture buffer uploaded once per scene, so a draw only sets
+// material_index instead of a material's uniforms. 4 texels per material: ambient, diffuse, specular and
+// (shininess, 0, 0, 0). Materials are only ever added while a scene loads, and only added ones are uploaded
+class MaterialBuffer
+{
+public:
+    void initialize();
+    void destroy();
+
+    // Uploads the materials added since the last call, or all of them if there are fewer than before
+    void update(const std::vector<ShapeMaterial> &materials);
+
+    // Binds the buffer to shader's material_data, shader must be in use
+    void bind(GLuint shader);
+
+private:
+    GLuint m_buffer = 0;
+    GLuint m_texture = 0;
+    size_t m_uploaded = 0;      // materials in the buffer
+    size_t m_capacity = 0;      // materials the buffer has room for
+};
+
+#endif // MATERIALBUFFER_H
@@ -0,0 +1,85 @@
+#include "overdrawcounter.h"
+#include <iostream>
+
+/**
+ * @brief Creates the queries, to be called once the GL context exists
+ */
+void OverdrawCounter::initialize(){
+    glGenQueries(PassCount, m_queries);
+}
+
+void OverdrawCounter::destroy(){
+    glDeleteQueries(PassCount, m_queries);
+}
+
+/**
+ * @brief Reads the last counted frame's results if the GPU has finished them, and counts this frame if so
+ */
+void OverdrawCounter::beginFrame(){
+    if (m_pending){
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_queries[ShadingPass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_TRUE){
+            GLuint64 samples[PassCount] = {};
+            for (int pass = 0; pass < PassCount; pass++){
+                if (m_used[pass]){
+                    glGetQueryObjectui64v(m_queries[pass], GL_QUERY_RESULT, &samples[pass]);
+                }
+            }
+
+            if (m_used[DepthPass]){
+                m_prepassFrames++;
+                m_depthFragments += samples[DepthPass];
+                m_visiblePixels += samples[ShadingPass];
+            } else {
+                m_forwardFrames++;
+                m_forwardFragments += samples[ShadingPass];
+            }
+            m_pending = false;
+        }
+    }
+
+    m_counting = !m_pending;
+    m_used[DepthPass] = m_used[ShadingPass] = false;
+}
+
+void OverdrawCounter::beginPass(Pass pass){
+    if (m_counting){
+        glBeginQuery(GL_SAMPLES_PASSED, m_queries[pass]);
+        m_used[pass] = true;
+    }
+}
+
+void OverdrawCounter::endPass(){
+    if (m_counting){
+        glEndQuery(GL_SAMPLES_PASSED);
+    }
+}
+
+void OverdrawCounter::endFrame(){
+    m_pending = m_counting && m_used[ShadingPass];
+    m_counting = false;
+}
+
+void OverdrawCounter::printStats() const {
+    if (m_forwardFrames > 0){
+        std::cout << "Shaded fragments per frame without depth pre-pass: " << m_forwardFragments/m_forwardFrames << std::endl;
+    }
+
+    if (m_prepassFrames > 0){
+        double ratio = m_visiblePixels > 0.0 ? m_depthFragments/m_visiblePixels : 0.0;
+        std::cout << "Shaded fragments per frame with depth pre-pass: " << m_visiblePixels/m_prepassFrames
+                  << ", overdraw ratio " << ratio << " (each visible pixel shaded once instead of " << ratio << " times)" << std::endl;
+    }
+}
+
+/**
+ * @brief Clears fragment statistics
+ */
+void OverdrawCounter::resetStats(){
+    m_forwardFrames = 0;
+    m_prepassFrames = 0;
+    m_forwardFragments = 0.0;
+    m_depthFragments = 0.0;
+    m_visiblePixels = 0.0;
+}
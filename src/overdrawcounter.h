@@ -0,0 +1,44 @@
+#ifndef OVERDRAWCOUNTER_H
+#define OVERDRAWCOUNTER_H
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+
+// Counts the fragments each pass of a frame writes with GL_SAMPLES_PASSED queries. Results are read
+// frames later, once the GPU has them, so counting never stalls the pipeline and only some frames are counted.
+// With a depth pre-pass, the pre-pass writes every fragment the shading pass would otherwise shade and the
+// GL_EQUAL shading pass writes each visible pixel once, which gives the overdraw ratio.
+class OverdrawCounter
+{
+public:
+    enum Pass { DepthPass, ShadingPass, PassCount };
+
+    void initialize();
+    void destroy();
+
+    void beginFrame();
+    void beginPass(Pass pass);
+    void endPass();
+    void endFrame();
+
+    void printStats() const;
+    void resetStats();
+
+private:
+    GLuint m_queries[PassCount] = {};
+    bool m_used[PassCount] = {};
+    bool m_counting = false;                            // whether this frame's passes are queried
+    bool m_pending = false;                             // whether queried results have not been read yet
+
+    // stats
+    long m_forwardFrames = 0;
+    long m_prepassFrames = 0;
+    double m_forwardFragments = 0.0;                    // fragments shaded without a pre-pass
+    double m_depthFragments = 0.0;                      // fragments written by pre-passes
+    double m_visiblePixels = 0.0;                       // fragments shaded after pre-passes
+};
+
+#endif // OVERDRAWCOUNTER_H
@@ -0,0 +1,123 @@
+#include "raytracer.h"
+#include "utils/meshloader.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QThreadPool>
+#include <iostream>
+#include <unordered_set>
+
+namespace {
+
+/**
+ * @brief Loads every mesh file the scene's shapes reference and measures its bounds, which the ray
+ *        tracer tests meshes against. printStats prints each file's load throughput
+ */
+std::unordered_map<std::string, MeshBounds> loadMeshBounds(const RenderData &renderData, bool printStats) {
+    std::unordered_set<std::string> meshfiles;
+    for (const RenderShapeData &shape : renderData.shapes){
+        if (shape.type == PrimitiveType::PRIMITIVE_MESH){
+            meshfiles.insert(shape.meshfile);
+        }
+    }
+
+    std::unordered_map<std::string, MeshBounds> meshBounds;
+    for (const std::string &meshfile : meshfiles){
+        MeshData mesh;
+        MeshLoadStats stats;
+        if (!MeshLoader::load(meshfile, mesh, &stats) || mesh.vertices.empty()){
+            std::cerr << "Failed to load mesh, leaving it out: " << meshfile << std::endl;
+            continue;
+        }
+        if (printStats){
+            MeshLoader::printStats(meshfile, stats);
+        }
+
+        MeshBounds bounds{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+        for (size_t i = 0; i + 2 < mesh.vertices.size(); i += 6){
+            glm::vec3 position(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+            bounds.min = glm::min(bounds.min, position);
+            bounds.max = glm::max(bounds.max, position);
+        }
+        meshBounds[meshfile] = bounds;
+    }
+    return meshBounds;
+}
+
+}
+
+/**
+ * @brief Renders a scene file to an image without a GPU or display:
+ *        raytracer [options] <scene> <output.png>
+ */
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("raytracer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders a scene file with the CPU ray tracer");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scene", "Scene file to render");
+    parser.addPositionalArgument("output", "Image to write, its format picked by the extension");
+    RayTracer::Config config;
+    QCommandLineOption widthOption("width", "Image width in pixels", "pixels", QString::number(config.width));
+    QCommandLineOption heightOption("height", "Image height in pixels", "pixels", QString::number(config.height));
+    QCommandLineOption depthOption("depth", "Reflection and refraction bounces", "count", QString::number(config.maxDepth));
+    QCommandLineOption tileOption("tile", "Tile size in pixels", "pixels", QString::number(config.tileSize));
+    QCommandLineOption threadsOption("threads", "Worker threads, 0 for one per core", "count", "0");
+    QCommandLineOption noShadowsOption("no-shadows", "Light every surface facing a light");
+    QCommandLineOption noPacketsOption("no-packets", "Trace primary rays one at a time instead of in SIMD packets");
+    QCommandLineOption benchmarkOption("benchmark", "Also print mesh load throughput and time primary ray traversal one ray at a time against packets");
+    parser.addOptions({widthOption, heightOption, depthOption, tileOption, threadsOption, noShadowsOption,
+                       noPacketsOption, benchmarkOption});
+    parser.process(a);
+
+    QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2){
+        parser.showHelp(1);
+    }
+
+    config.width = std::max(1, parser.value(widthOption).toInt());
+    config.height = std::max(1, parser.value(heightOption).toInt());
+    config.maxDepth = std::max(0, parser.value(depthOption).toInt());
+    config.tileSize = std::max(1, parser.value(tileOption).toInt());
+    config.threads = std::max(0, parser.value(threadsOption).toInt());
+    config.shadows = !parser.isSet(noShadowsOption);
+    config.packets = !parser.isSet(noPacketsOption);
+    if (config.threads > QThreadPool::globalInstance()->maxThreadCount()){
+        QThreadPool::globalInstance()->setMaxThreadCount(config.threads);
+    }
+
+    std::string scenefile = arguments[0].toStdString();
+    RenderData renderData;
+    if (!SceneParser::parse(scenefile, renderData)){
+        std::cerr << "Failed to load scene: " << scenefile << std::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    RayTracer tracer(renderData, loadMeshBounds(renderData, parser.isSet(benchmarkOption)));
+    std::cout << "Built BVH over " << renderData.shapes.size() << " shapes in " << timer.elapsed() << " ms" << std::endl;
+
+    if (parser.isSet(benchmarkOption)){
+        tracer.benchmarkTraversal(config);
+    }
+
+    std::vector<RGBA> image;
+    RayTracer::Stats stats = tracer.render(config, image);
+    std::cout << "Rendered " << config.width << "x" << config.height << " on " << stats.threads << " threads in "
+              << stats.seconds * 1000.0 << " ms: " << stats.getRays() << " rays (" << stats.primaryRays << " primary, "
+              << stats.secondaryRays << " secondary, " << stats.shadowRays << " shadow), "
+              << stats.getRays() / stats.seconds * 1e-6 << " Mrays/s, " << stats.tilesStolen << " tiles stolen" << std::endl;
+
+    QImage output(reinterpret_cast<const uchar *>(image.data()), config.width, config.height, QImage::Format_RGBA8888);
+    QString outputPath = arguments[1];
+    if (!output.save(outputPath)){
+        std::cerr << "Failed to write image: " << outputPath.toStdString() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "raytracer.h"
+#include "tilescheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QElapsedTimer>
+#include <iostream>
+
+namespace {
+
+// Secondary and shadow rays start this far off the surface so they don't hit it again
+constexpr float SURFACE_OFFSET = 1e-4f;
+
+/**
+ * @brief Falloff function for SPOT lighting, as in lighting.frag
+ */
+float falloff(float x, float thetaInner, float thetaOuter) {
+    float t = (x - thetaInner) / (thetaOuter - thetaInner);
+    if (t <= 0.f){
+        return 0.f;
+    }
+    return -2.f*t*t*t + 3.f*t*t;
+}
+
+float attenuation(const glm::vec3 &function, float dist) {
+    return std::min(1.f, 1.f / (function[0] + dist*function[1] + dist*dist*function[2]));
+}
+
+bool isBlack(const SceneColor &color) {
+    return color.r <= 0.f && color.g <= 0.f && color.b <= 0.f;
+}
+
+uint8_t toByte(float value) {
+    return uint8_t(std::round(std::clamp(value, 0.f, 1.f) * 255.f));
+}
+
+}
+
+RayTracer::RayTracer(const RenderData &renderData, const std::unordered_map<std::string, MeshBounds> &meshBounds)
+    : m_renderData(renderData) {
+    m_bvh.build(renderData.shapes, meshBounds);
+}
+
+/**
+ * @brief Splits the image into tiles that TileScheduler hands to the threads, each thread counting its
+ *        own rays so no counter is shared
+ */
+RayTracer::Stats RayTracer::render(const Config &config, std::vector<RGBA> &image) const {
+    image.assign(size_t(config.width) * config.height, RGBA{0, 0, 0});
+    Camera camera = getCamera(config);
+
+    int tilesX = (config.width + config.tileSize - 1) / config.tileSize;
+    int tilesY = (config.height + config.tileSize - 1) / config.tileSize;
+    int threads = config.threads > 0 ? config.threads : QThreadPool::globalInstance()->maxThreadCount();
+    threads = std::min(threads, QThreadPool::globalInstance()->maxThreadCount());
+    std::vector<Stats> workerStats(std::max(1, threads));
+
+    QElapsedTimer timer;
+    timer.start();
+    int stolen = TileScheduler::run(tilesX * tilesY, threads, [&](int tile, int worker){
+        Stats &stats = workerStats[worker];
+        int x0 = (tile % tilesX) * config.tileSize;
+        int y0 = (tile / tilesX) * config.tileSize;
+        int x1 = std::min(config.width, x0 + config.tileSize);
+        int y1 = std::min(config.height, y0 + config.tileSize);
+
+        std::vector<Ray> rays;
+        std::vector<int> pixelX, pixelY;
+        getTileRays(camera, config, x0, y0, x1, y1, rays, pixelX, pixelY);
+
+        ShapeBVH::Hit hits[ShapeBVH::PACKET_SIZE];
+        for (size_t first = 0; first < rays.size(); first += ShapeBVH::PACKET_SIZE){
+            int count = std::min<int>(ShapeBVH::PACKET_SIZE, rays.size() - first);
+            if (config.packets){
+                m_bvh.intersectPacket(&rays[first], count, hits);
+            } else {
+                for (int i = 0; i < count; i++){
+                    m_bvh.intersect(rays[first + i], hits[i]);
+                }
+            }
+
+            for (int i = 0; i < count; i++){
+                stats.primaryRays++;
+                glm::vec4 color = shadeHit(rays[first + i], hits[i], 0, config, stats);
+                image[size_t(pixelY[first + i]) * config.width + pixelX[first + i]] = RGBA{toByte(color.r), toByte(color.g), toByte(color.b)};
+            }
+        }
+    });
+
+    Stats total;
+    total.seconds = timer.nsecsElapsed() * 1e-9;
+    total.threads = threads;
+    total.tilesStolen = stolen;
+    for (const Stats &stats : workerStats){
+        total.primaryRays += stats.primaryRays;
+        total.secondaryRays += stats.secondaryRays;
+        total.shadowRays += stats.shadowRays;
+    }
+    return total;
+}
+
+/**
+ * @brief Times primary visibility alone, one intersect() per ray against intersectPacket() per block
+ */
+void RayTracer::benchmarkTraversal(const Config &config) const {
+    Camera camera = getCamera(config);
+    std::vector<Ray> rays;
+    std::vector<int> pixelX, pixelY;
+    getTileRays(camera, config, 0, 0, config.width, config.height, rays, pixelX, pixelY);
+
+    std::vector<ShapeBVH::Hit> scalarHits(rays.size()), packetHits(rays.size());
+    QElapsedTimer timer;
+    timer.start();
+    for (size_t i = 0; i < rays.size(); i++){
+        m_bvh.intersect(rays[i], scalarHits[i]);
+    }
+    double scalarSeconds = std::max<qint64>(1, timer.nsecsElapsed()) * 1e-9;
+
+    timer.start();
+    for (size_t first = 0; first < rays.size(); first += ShapeBVH::PACKET_SIZE){
+        int count = std::min<int>(ShapeBVH::PACKET_SIZE, rays.size() - first);
+        m_bvh.intersectPacket(&rays[first], count, &packetHits[first]);
+    }
+    double packetSeconds = std::max<qint64>(1, timer.nsecsElapsed()) * 1e-9;
+
+    // grazing rays may round differently in the two
+    size_t differing = 0;
+    for (size_t i = 0; i < rays.size(); i++){
+        differing += scalarHits[i].shape != packetHits[i].shape;
+    }
+
+    std::cout << "Primary ray traversal over " << m_bvh.size() << " shapes: "
+              << rays.size() / scalarSeconds * 1e-6 << " Mrays/s one ray at a time, "
+              << rays.size() / packetSeconds * 1e-6 << " Mrays/s in packets of " << ShapeBVH::PACKET_SIZE
+              << (ShapeBVH::hasPacketSIMD() ? " (AVX2)" : " (no AVX2, one ray at a time)")
+              << ", " << differing << " of " << rays.size() << " rays hit a different shape" << std::endl;
+}
+
+/**
+ * @brief Basis of the scene's camera from its look and up, with the view plane at distance 1
+ */
+RayTracer::Camera RayTracer::getCamera(const Config &config) const {
+    const SceneCameraData &data = m_renderData.cameraData;
+    Camera camera;
+    camera.w = -glm::normalize(glm::vec3(data.look));
+    camera.v = glm::normalize(glm::vec3(data.up) - glm::dot(glm::vec3(data.up), camera.w) * camera.w);
+    camera.u = glm::cross(camera.v, camera.w);
+    camera.eye = glm::vec3(data.pos);
+    camera.viewHeight = 2.f * std::tan(data.heightAngle / 2.f);
+    camera.viewWidth = camera.viewHeight * config.width / config.height;
+    return camera;
+}
+
+Ray RayTracer::getPrimaryRay(const Camera &camera, const Config &config, int x, int y) const {
+    float viewX = ((x + 0.5f) / config.width - 0.5f) * camera.viewWidth;
+    float viewY = (0.5f - (y + 0.5f) / config.height) * camera.viewHeight;
+    return {camera.eye, glm::normalize(viewX*camera.u + viewY*camera.v - camera.w)};
+}
+
+void RayTracer::getTileRays(const Camera &camera, const Config &config, int x0, int y0, int x1, int y1,
+                            std::vector<Ray> &rays, std::vector<int> &x, std::vector<int> &y) const {
+    rays.clear();
+    x.clear();
+    y.clear();
+    for (int blockY = y0; blockY < y1; blockY += PACKET_HEIGHT){
+        for (int blockX = x0; blockX < x1; blockX += PACKET_WIDTH){
+            for (int pixelY = blockY; pixelY < std::min(y1, blockY + PACKET_HEIGHT); pixelY++){
+                for (int pixelX = blockX; pixelX < std::min(x1, blockX + PACKET_WIDTH); pixelX++){
+                    rays.push_back(getPrimaryRay(camera, config, pixelX, pixelY));
+                    x.push_back(pixelX);
+                    y.push_back(pixelY);
+                }
+            }
+        }
+    }
+}
+
+glm::vec4 RayTracer::traceRay(const Ray &ray, int depth, const Config &config, Stats &stats) const {
+    ShapeBVH::Hit hit;
+    m_bvh.intersect(ray, hit);
+    return shadeHit(ray, hit, depth, config, stats);
+}
+
+/**
+ * @brief Shades the nearest hit along ray: ambient and lights as in default.frag, then the reflected and
+ *        refracted rays weighted by the material's cReflective and cTransparent
+ */
+glm::vec4 RayTracer::shadeHit(const Ray &ray, const ShapeBVH::Hit &hit, int depth, const Config &config, Stats &stats) const {
+    if (hit.shape < 0){
+        return glm::vec4(0.f);
+    }
+
+    const RenderShapeData &shape = m_renderData.shapes[hit.shape];
+    const SceneMaterial &material = m_renderData.materials[shape.materialIndex];
+    const SceneGlobalData &global = m_renderData.globalData;
+
+    // shading faces the normal towards the ray, refraction needs to know which side it came from
+    glm::vec3 direction = glm::normalize(ray.direction);
+    glm::vec3 position = ray.origin + hit.t * ray.direction;
+    bool entering = glm::dot(hit.normal, direction) < 0.f;
+    glm::vec3 normal = entering ? hit.normal : -hit.normal;
+
+    glm::vec4 color = global.ka * material.cAmbient;
+    color += shadeLights(position, normal, -direction, material, config, stats);
+
+    if (depth >= config.maxDepth){
+        return color;
+    }
+
+    if (!isBlack(material.cReflective)){
+        Ray reflected{position + SURFACE_OFFSET * normal, glm::reflect(direction, normal)};
+        stats.secondaryRays++;
+        color += global.ks * material.cReflective * traceRay(reflected, depth + 1, config, stats);
+    }
+
+    if (!isBlack(material.cTransparent)){
+        // leaving the shape swaps the indices of refraction, total internal reflection refracts nothing
+        float ior = material.ior > 0.f ? material.ior : 1.f;
+        glm::vec3 refracted = glm::refract(direction, normal, entering ? 1.f / ior : ior);
+        if (glm::dot(refracted, refracted) > 0.f){
+            Ray transmitted{position - SURFACE_OFFSET * normal, refracted};
+            stats.secondaryRays++;
+            color += global.kt * material.cTransparent * traceRay(transmitted, depth + 1, config, stats);
+        }
+    }
+    return color;
+}
+
+/**
+ * @brief Diffuse and specular terms of every light that reaches position unblocked, as in lighting.frag
+ */
+glm::vec4 RayTracer::shadeLights(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &dirToCamera,
+                                 const SceneMaterial &material, const Config &config, Stats &stats) const {
+    const SceneGlobalData &global = m_renderData.globalData;
+    glm::vec4 color(0.f);
+
+    for (const SceneLightData &light : m_renderData.lights){
+        glm::vec3 toLight;
+        float distance = INFINITY;
+        float intensity = 1.f;
+
+        switch (light.type){
+        case LightType::LIGHT_DIRECTIONAL:
+            toLight = -glm::normalize(glm::vec3(light.dir));
+            break;
+        case LightType::LIGHT_POINT:
+        case LightType::LIGHT_SPOT:
+            toLight = glm::vec3(light.pos) - position;
+            distance = glm::length(toLight);
+            toLight /= distance;
+            intensity = attenuation(light.function, distance);
+
+            if (light.type == LightType::LIGHT_SPOT){
+                float thetaOuter = light.angle;
+                float thetaInner = thetaOuter - light.penumbra;
+                float x = std::acos(std::clamp(glm::dot(glm::normalize(glm::vec3(light.dir)), -toLight), -1.f, 1.f));
+                if (x > thetaOuter){
+                    continue;
+                } else if (x > thetaInner){
+                    intensity *= 1.f - falloff(x, thetaInner, thetaOuter);
+                }
+            }
+            break;
+        default:
+            continue;
+        }
+
+        float normalDotLight = glm::dot(normal, toLight);
+        if (normalDotLight <= 0.f){
+            continue;
+        }
+
+        if (config.shadows){
+            stats.shadowRays++;
+            if (m_bvh.occluded({position + SURFACE_OFFSET * normal, toLight}, 0.f, distance)){
+                continue;
+            }
+        }
+
+        float reflectDotView = std::max(glm::dot(glm::reflect(-toLight, normal), dirToCamera), 0.f);
+        float specular = material.shininess <= 0.f ? 1.f : std::pow(reflectDotView, material.shininess);
+        color += intensity * light.color * (global.kd * material.cDiffuse * normalDotLight
+                                            + global.ks * material.cSpecular * specular);
+    }
+    return color;
+}
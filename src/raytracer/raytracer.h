@@ -0,0 +1,81 @@
+#pragma once
+
+#include "utils/sceneparser.h"
+#include "utils/shapebvh.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A pixel of the rendered image, 8 bits per channel
+struct RGBA {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a = 255;
+};
+
+// Offline CPU ray tracer over the same RenderData the realtime renderer draws. Shapes are intersected
+// analytically in object space through ShapeBVH, and shaded with the realtime renderer's Phong model plus
+// shadows, reflection (cReflective) and refraction (cTransparent, ior)
+class RayTracer {
+public:
+    struct Config {
+        int width = 1024;
+        int height = 768;
+        int maxDepth = 4;           // reflection and refraction bounces
+        int tileSize = 16;          // in pixels, the unit of work handed to threads
+        int threads = 0;            // 0 for QThreadPool's maxThreadCount()
+        bool shadows = true;
+        bool packets = true;        // traces primary rays in 4x2 pixel packets, see ShapeBVH::intersectPacket()
+    };
+
+    // Rays traced by a render, by kind
+    struct Stats {
+        uint64_t primaryRays = 0;
+        uint64_t secondaryRays = 0;     // reflected and refracted
+        uint64_t shadowRays = 0;
+        int threads = 0;
+        int tilesStolen = 0;
+        double seconds = 0.0;
+
+        uint64_t getRays() const { return primaryRays + secondaryRays + shadowRays; }
+    };
+
+    // Builds the BVH over renderData's shapes, see ShapeBVH::build(). renderData must outlive the tracer
+    RayTracer(const RenderData &renderData, const std::unordered_map<std::string, MeshBounds> &meshBounds = {});
+
+    // Renders the scene from its camera into image, config.width * config.height pixels row by row from the top
+    Stats render(const Config &config, std::vector<RGBA> &image) const;
+
+    // Times finding the nearest hit of every primary ray of the image one ray at a time and in packets,
+    // on the calling thread, and prints rays per second of each
+    void benchmarkTraversal(const Config &config) const;
+
+private:
+    // The scene camera's basis and the size of its view plane at distance 1
+    struct Camera {
+        glm::vec3 eye, u, v, w;
+        float viewWidth, viewHeight;
+    };
+    Camera getCamera(const Config &config) const;
+    // The camera's ray through the center of pixel (x, y)
+    Ray getPrimaryRay(const Camera &camera, const Config &config, int x, int y) const;
+
+    // Primary rays in the order render() traces them: pixel blocks of PACKET_WIDTH x PACKET_HEIGHT
+    // within each tile, so each block is one packet. The pixels go to x and y
+    static constexpr int PACKET_WIDTH = 4, PACKET_HEIGHT = 2;
+    void getTileRays(const Camera &camera, const Config &config, int x0, int y0, int x1, int y1,
+                     std::vector<Ray> &rays, std::vector<int> &x, std::vector<int> &y) const;
+
+    // Color seen along ray, counting the rays it casts into stats
+    glm::vec4 traceRay(const Ray &ray, int depth, const Config &config, Stats &stats) const;
+    glm::vec4 shadeHit(const Ray &ray, const ShapeBVH::Hit &hit, int depth, const Config &config, Stats &stats) const;
+    glm::vec4 shadeLights(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &dirToCamera,
+                          const SceneMaterial &material, const Config &config, Stats &stats) const;
+
+    const RenderData &m_renderData;
+    ShapeBVH m_bvh;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace TileScheduler
+{
+    // Calls fn(tile, worker) for every tile in [0, count) on workers threads, the calling thread being
+    // worker 0 and the rest running on the global QThreadPool. Each worker starts with a contiguous block of
+    // tiles in a deque of its own and takes from its front; once it runs dry it steals from the back of
+    // the others', so blocks that take longer (reflections, dense geometry) are shared out as they go.
+    // @return the number of tiles that were stolen
+    template <typename Function>
+    inline int run(int count, int workers, Function &&fn) {
+        workers = std::max(1, std::min(workers, count));
+        if (count <= 0) {
+            return 0;
+        }
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<int> tiles;
+        };
+        struct State {
+            std::vector<Queue> queues;
+            std::atomic<int> stolen{0};
+            int finished = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+            State(int workers) : queues(workers) {}
+        };
+        auto state = std::make_shared<State>(workers);
+        for (int worker = 0; worker < workers; worker++) {
+            int begin = int(int64_t(count) * worker / workers);
+            int end = int(int64_t(count) * (worker + 1) / workers);
+            for (int tile = begin; tile < end; tile++) {
+                state->queues[worker].tiles.push_back(tile);
+            }
+        }
+
+        // tiles are only ever removed, so a worker that finds every queue empty is done
+        auto *work = &fn;
+        auto drain = [state, work, workers](int worker) {
+            auto take = [&](int victim, bool front, int &tile) {
+                Queue &queue = state->queues[victim];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tiles.empty()) {
+                    return false;
+                }
+                if (front) {
+                    tile = queue.tiles.front();
+                    queue.tiles.pop_front();
+                } else {
+                    tile = queue.tiles.back();
+                    queue.tiles.pop_back();
+                }
+                return true;
+            };
+
+            int tile;
+            while (true) {
+                if (take(worker, true, tile)) {
+                    (*work)(tile, worker);
+                    continue;
+                }
+
+                bool found = false;
+                for (int i = 1; i < workers && !found; i++) {
+                    found = take((worker + i) % workers, false, tile);
+                }
+                if (!found) {
+                    break;
+                }
+                state->stolen++;
+                (*work)(tile, worker);
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->finished == workers) {
+                state->done.notify_all();
+            }
+        };
+
+        QThreadPool *pool = QThreadPool::globalInstance();
+        for (int worker = 1; worker < workers; worker++) {
+            pool->start([drain, worker]() { drain(worker); });
+        }
+        drain(0);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&]() { return state->finished == workers; });
+        return state->stolen;
+    }
+}
@@ -2,10 +2,18 @@
 #include "utils/shaderloader.h"
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
 #include <QMouseEvent>
 #include <QKeyEvent>
+#include <QThreadPool>
 #include <iostream>
+#include <random>
+#include <unordered_set>
 #include "settings.h"
+#include "utils/meshoptimizer.h"
+#include "utils/parallel.h"
+#include "utils/vertexformat.h"
 
 // ================== Project 5: Lights, Camera
 
@@ -23,6 +31,25 @@ Realtime::Realtime(QWidget *parent)
     m_keyMap[Qt::Key_Control] = false;
     m_keyMap[Qt::Key_Space]   = false;
     // If you must use this function, do not edit anything above this
+
+    // without a frame rate cap, each finished frame schedules the next one (display refresh rate)
+    connect(this, &QOpenGLWidget::frameSwapped, this, [this]{
+        if (m_frameLoopActive && m_timer == 0){
+            advanceFrame();
+        }
+    });
+
+    connect(&m_sceneWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path){
+        // editors often save by replacing the file, which drops it from the watcher
+        if (QFileInfo::exists(path) && !m_sceneWatcher.files().contains(path)){
+            m_sceneWatcher.addPath(path);
+        }
+        reloadScene();
+    });
+
+    connect(&m_shaderWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path){
+        reloadShader(path);
+    });
 }
 
 /**
@@ -30,48 +57,207 @@ Realtime::Realtime(QWidget *parent)
  */
 void Realtime::deleteAllVBOSVAOS(){
     glDeleteBuffers(1, &m_sphere_vbo);
+    glDeleteBuffers(1, &m_sphere_ebo);
     glDeleteBuffers(1, &cube_vbo);
+    glDeleteBuffers(1, &cube_ebo);
     glDeleteBuffers(1, &cylinder_vbo);
+    glDeleteBuffers(1, &cylinder_ebo);
     glDeleteBuffers(1, &cone_vbo);
+    glDeleteBuffers(1, &cone_ebo);
+    glDeleteBuffers(1, &torus_vbo);
+    glDeleteBuffers(1, &torus_ebo);
 
     glDeleteVertexArrays(1, &m_sphere_vao);
     glDeleteVertexArrays(1, &cube_vao);
     glDeleteVertexArrays(1, &cylinder_vao);
     glDeleteVertexArrays(1, &cone_vao);
+    glDeleteVertexArrays(1, &torus_vao);
+
+    glDeleteBuffers(1, &m_volume_vbo);
+    glDeleteBuffers(1, &m_volume_ebo);
+    glDeleteVertexArrays(1, &m_volume_vao);
+
+    for (auto &[meshfile, buffers] : m_meshes){
+        deleteMeshBuffers(buffers);
+    }
+    m_meshes.clear();
+}
+
+/**
+ * @brief Deletes one mesh's vbo, ebo and vao
+ */
+void Realtime::deleteMeshBuffers(MeshBuffers &buffers){
+    glDeleteBuffers(1, &buffers.vbo);
+    glDeleteBuffers(1, &buffers.ebo);
+    glDeleteVertexArrays(1, &buffers.vao);
+}
+
+/**
+ * @brief Loads every mesh file referenced by the scene's shapes from firstShape on that isn't loaded yet.
+ *        When all shapes are checked, meshes the scene no longer uses are freed. Each file is loaded once
+ *        however many primitives reference it, on the thread pool with different files in parallel, and
+ *        uploaded in onSceneMeshesLoaded() once the job is done
+ */
+void Realtime::loadSceneMeshes(size_t firstShape){
+    std::unordered_set<std::string> referenced;
+    if (firstShape == 0){
+        referenced.insert(m_store.meshfiles.begin(), m_store.meshfiles.end());
+    }
+    for (size_t i = firstShape; i < m_store.size(); i++){
+        if (m_store.types[i] == PrimitiveType::PRIMITIVE_MESH){
+            referenced.insert(m_store.meshfiles[m_store.meshIndices[i]]);
+        }
+    }
+
+    if (firstShape == 0){
+        makeCurrent();
+        for (auto it = m_meshes.begin(); it != m_meshes.end();){
+            if (referenced.count(it->first)){
+                it++;
+            } else {
+                deleteMeshBuffers(it->second);
+                it = m_meshes.erase(it);
+            }
+        }
+        doneCurrent();
+    }
+
+    // files already loading or that failed during this load aren't tried again
+    auto job = std::make_shared<SceneMeshLoad>();
+    for (const std::string &meshfile : referenced){
+        if (!m_meshes.count(meshfile) && !m_meshesLoading.count(meshfile) && !m_meshesFailed.count(meshfile)){
+            job->meshfiles.push_back(meshfile);
+            m_meshesLoading.insert(meshfile);
+        }
+    }
+    if (job->meshfiles.empty()){
+        return;
+    }
+
+    int loadId = m_sceneLoadId;
+    QThreadPool::globalInstance()->start([this, loadId, job](){
+        int count = int(job->meshfiles.size());
+        job->meshes.resize(count);
+        job->stats.resize(count);
+        job->optimizeStats.resize(count);
+        job->loaded.resize(count);
+        Parallel::forEach(count, [&](int i){
+            job->loaded[i] = MeshCache::load(job->meshfiles[i], job->meshes[i], &job->stats[i], &job->optimizeStats[i]);
+        });
+
+        // hand the meshes back to the GUI thread, which owns the GL context
+        QMetaObject::invokeMethod(this, [this, loadId, job](){
+            onSceneMeshesLoaded(loadId, *job);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Runs on the GUI thread when a mesh loading job is done. Uploads the meshes that loaded, and
+ *        remembers the ones that failed so the rest of the load doesn't try them again
+ */
+void Realtime::onSceneMeshesLoaded(int loadId, SceneMeshLoad &job){
+    // another scene was chosen meanwhile, the job's meshes are freed with it
+    if (loadId != m_sceneLoadId){
+        return;
+    }
+
+    makeCurrent();
+    for (int i=0; i < job.meshfiles.size(); i++){
+        const std::string &meshfile = job.meshfiles[i];
+        m_meshesLoading.erase(meshfile);
+        if (!job.loaded[i]){
+            m_meshesFailed.insert(meshfile);
+            continue;
+        }
+        if (settings.cpuBenchmarks){
+            MeshLoader::printStats(meshfile, job.stats[i]);
+            if (!job.stats[i].cached){
+                MeshOptimizer::printStats(meshfile, job.optimizeStats[i]);
+            }
+        }
+
+        // the cache format is uploaded straight from the mapped file
+        const CachedMesh &mesh = job.meshes[i];
+        MeshBuffers &buffers = m_meshes[meshfile];
+        bindMeshVAO(buffers.vbo, buffers.vao);
+        bindEBO(buffers.ebo, buffers.vao);
+        bindVBO(buffers.vbo, mesh.vertices, mesh.vertexCount*sizeof(PackedVertex));
+        bindVBO(buffers.ebo, mesh.indices, mesh.indexCount*sizeof(GLuint));
+        buffers.vertexDataSize = mesh.vertexCount * 6;
+        buffers.indexCount = mesh.indexCount;
+        buffers.positionOffset = mesh.positionOffset;
+        buffers.positionScale = mesh.positionScale;
+    }
+    doneCurrent();
+
+    // picking tests meshes against the bounds of the loaded ones
+    m_pickBVHDirty = true;
+
+    update(); // asks for a PaintGL() call to occur
 }
 
 /**
  * @brief Executes when program finishes
  */
 void Realtime::finish() {
-    killTimer(m_timer);
+    stopTickTimer();
+    m_scheduler.printStats();
+    m_overdraw.printStats();
+    m_benchmark.printStats();
+    ProgramCache::printStats();
+
+    // let running tesselation and scene loading jobs finish before the widget goes away
+    cancelSceneLoad();
+    QThreadPool::globalInstance()->waitForDone();
+
     this->makeCurrent();
 
     // Students: anything requiring OpenGL calls when the program exits should be done here
     // delete vbos, vaos, fbos, and shader(s)
     deleteAllVBOSVAOS();
     deleteFBOs();
-    glDeleteProgram(m_shader);
+    m_overdraw.destroy();
+    m_benchmark.destroy();
+    lights.destroy();
+    m_materials.destroy();
+    m_forward_variants.destroy();
+    m_deferred_variants.destroy();
+    m_depth_variants.destroy();
+    m_gbuffer_variants.destroy();
+    glDeleteProgram(m_fallback_shader);
 
     this->doneCurrent();
 }
 
 /**
- * @brief Creates invert(per pixel) and kernel-based shader, while setting up FBO related
- *          variables in Filter class
+ * @brief Runs the CPU benchmarks once and prints their results. Each times an optimized path against
+ *        the one it replaced, on the current tesselation params
  */
-void Realtime::initializeFBO(){
-    //load shaders
-    m_invert_shader = ShaderLoader::createShaderProgram(":/resources/shaders/perpixelfilter.vert", ":/resources/shaders/perpixelfilter.frag");
-    m_kernel_shader = ShaderLoader::createShaderProgram(":/resources/shaders/perpixelfilter.vert", ":/resources/shaders/kernelfilter.frag");
+void Realtime::runCpuBenchmarks(){
+    benchmarkShapeData(settings.shapeParameter1, settings.shapeParameter2);
+    benchmarkScene();
+}
 
-    glUseProgram(m_invert_shader);
-    glUseProgram(m_kernel_shader);
+/**
+ * @brief The CPU benchmarks that depend on the scene, run again whenever a scene finishes loading
+ */
+void Realtime::benchmarkScene(){
+    SceneStore::benchmarkIteration(renderData, m_store);
+    benchmarkPicking();
+}
 
+/**
+ * @brief Sets up FBO related variables in Filter class. The invert(per pixel) and kernel-based
+ *          shaders are compiled on first use, per filter mode
+ */
+void Realtime::initializeFBO(){
     // initiate FBO
     filter.initiateFBO(m_fbo_texture, m_fbo_renderbuffer, m_fbo,
                        m_defaultFBO, m_fbo_width, m_fbo_height,
                        m_fullscreen_vbo, m_fullscreen_vao);
+    filter.initiateGBuffer(m_fbo_texture, m_fbo_renderbuffer, m_gbuffer_fbo, m_gbuffer_textures,
+                           m_defaultFBO, m_fbo_width, m_fbo_height);
 }
 
 /**
@@ -79,8 +265,8 @@ void Realtime::initializeFBO(){
  *          GLuints are deleted in main GL pipeline
  */
 void Realtime::deleteFBOs(){
-      glDeleteProgram(m_invert_shader);
-      glDeleteProgram(m_kernel_shader);
+      m_invert_variants.destroy();
+      m_kernel_variants.destroy();
 
       glDeleteVertexArrays(1, &m_fullscreen_vao);
       glDeleteBuffers(1, &m_fullscreen_vbo);
@@ -88,49 +274,79 @@ void Realtime::deleteFBOs(){
       glDeleteTextures(1, &m_fbo_texture);
       glDeleteRenderbuffers(1, &m_fbo_renderbuffer);
       glDeleteFramebuffers(1, &m_fbo);
+
+      glDeleteTextures(Filter::GBUFFER_TARGETS, m_gbuffer_textures);
+      glDeleteFramebuffers(1, &m_gbuffer_fbo);
 }
 
 /**
- * @brief Activates per-pixel or kernel-filter based on is bool var perpixelOn is true.
+ * @brief Activates per-pixel or kernel-filter based on is bool var perpixelOn is true,
+ *        with the permutation of that filter that applies the selected effect, once it has compiled
  */
 void Realtime::paintTexture(GLuint texture){
-    if (perpixelOn){
-        filter.activatePerPixelFilter(texture, m_invert_shader, m_fullscreen_vao, perpixelOn, isGrayScale);
+    ShaderVariants &variants = perpixelOn ? m_invert_variants : m_kernel_variants;
+    ShaderDefines defines = perpixelOn ? ShaderDefines{{"FILTER_MODE", isGrayScale ? 2 : 1}}
+                                       : ShaderDefines{{"FILTER_MODE", kernelFilterOn ? (isSharpen ? 2 : 1) : 0}};
+    GLuint shader = variants.poll(defines);
+
+    // the unfiltered image until the filter has compiled, or until hot reload fixes one that failed
+    if (shader == 0){
+        if (!variants.hasFailed(defines)){
+            update();
+        }
+        shader = m_kernel_variants.get({{"FILTER_MODE", 0}});
+        if (shader == 0){
+            return;
+        }
+        filter.activateKernelFilter(texture, shader, m_fullscreen_vao, size().width(), size().height());
+    } else if (perpixelOn){
+        filter.activatePerPixelFilter(texture, shader, m_fullscreen_vao);
     } else {
-        filter.activateKernelFilter(texture, m_kernel_shader, m_fullscreen_vao, kernelFilterOn,
-                                    isSharpen, size().width(), size().height());
+        filter.activateKernelFilter(texture, shader, m_fullscreen_vao, size().width(), size().height());
     }
 }
 
 /**
- * @brief Given a shape type, bind VBO to OpenGL
+ * @brief Given a shape type, bind VBO to OpenGL. Buffers are untyped, so element buffers are
+ *        filled through GL_ARRAY_BUFFER too, which leaves every VAO's element binding alone
  */
-void Realtime::bindVBO(GLuint &shapeVBO, std::vector<float> shapeData){
+void Realtime::bindVBO(GLuint &shapeVBO, const void *shapeData, GLsizeiptr size){
     glBindBuffer(GL_ARRAY_BUFFER, shapeVBO);
-    glBufferData(GL_ARRAY_BUFFER, shapeData.size()*sizeof(GLfloat), shapeData.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, size, shapeData, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 /**
- * @brief Called ONCE during initializeGL(), creates VAO and VBO for one type of shape
+ * @brief Called ONCE during initializeGL(), creates VAO and VBO for one type of shape.
+ *        The VBO's storage is allocated when shape data is written to it
  */
-void Realtime::bindVAO(GLuint &shapeVBO, GLuint &shapeVAO, std::vector<float> &shapeData){
+void Realtime::bindVAO(GLuint &shapeVBO, GLuint &shapeVAO){
        glGenBuffers(1, &shapeVBO);
-       glBindBuffer(GL_ARRAY_BUFFER, shapeVBO);
-
-       // send data to vbo
-       glBufferData(GL_ARRAY_BUFFER, shapeData.size()*sizeof(GLfloat), shapeData.data(), GL_STATIC_DRAW);
 
-       // generate and bind vao
+       // generate vao
        glGenVertexArrays(1, &shapeVAO);
+
+       setVertexFormat(shapeVBO, shapeVAO, false);
+}
+
+/**
+ * @brief Points a shape's VAO at its VBO, laid out either as 6 floats per vertex or as PackedShapeVertex
+ */
+void Realtime::setVertexFormat(GLuint &shapeVBO, GLuint &shapeVAO, bool packed){
+       glBindBuffer(GL_ARRAY_BUFFER, shapeVBO);
        glBindVertexArray(shapeVAO);
 
        // determine attribute locations: 0 --> position 1--> normal
        glEnableVertexAttribArray(0);
-       glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), reinterpret_cast<void *>(0*sizeof(GLfloat)));
-
        glEnableVertexAttribArray(1);
-       glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), reinterpret_cast<void *>(3*sizeof(GLfloat)));
+       if (packed){
+           // the normal's unused 4th component is dropped by the shader's vec3 input
+           glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedShapeVertex), reinterpret_cast<void *>(offsetof(PackedShapeVertex, position)));
+           glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedShapeVertex), reinterpret_cast<void *>(offsetof(PackedShapeVertex, normal)));
+       } else {
+           glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), reinterpret_cast<void *>(0*sizeof(GLfloat)));
+           glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), reinterpret_cast<void *>(3*sizeof(GLfloat)));
+       }
 
        // cleanup bindings by unbinding
        glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -138,33 +354,312 @@ void Realtime::bindVAO(GLuint &shapeVBO, GLuint &shapeVAO, std::vector<float> &s
 }
 
 /**
- * @brief Called on settingsChanged(), updates the params of shapeDatas to create new vertexData
+ * @brief Creates the VAO and VBO of a cached mesh, whose vertices are PackedVertex
+ */
+void Realtime::bindMeshVAO(GLuint &meshVBO, GLuint &meshVAO){
+    glGenBuffers(1, &meshVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+
+    glGenVertexArrays(1, &meshVAO);
+    glBindVertexArray(meshVAO);
+
+    // 0 --> quantized position, normalized to [0, 1] 1 --> octahedral normal, normalized to [-1, 1]
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void *>(offsetof(PackedVertex, position)));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void *>(offsetof(PackedVertex, normal)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+/**
+ * @brief Called ONCE during initializeGL(), creates the EBO of an indexed shape and attaches it to the shape's VAO
+ */
+void Realtime::bindEBO(GLuint &shapeEBO, GLuint &shapeVAO){
+    glGenBuffers(1, &shapeEBO);
+
+    // the element buffer binding is part of the vao's state
+    glBindVertexArray(shapeVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shapeEBO);
+    glBindVertexArray(0);
+}
+
+/**
+ * @brief Tesselates every primitive type straight into the given storage, which must be sized by
+ *        each shape's getVertexDataSize(). Thread safe, so it may run off the GUI thread
+ */
+void Realtime::writeShapeData(const ShapeMeshSpans &data, int param1, int param2){
+    // each shape also splits its own wedges/faces across the thread pool
+    Parallel::forEach(5, [&](int i){
+        switch (i){
+            case 0: Sphere().writeVertexData(param1, param2, data.sphere); break;
+            case 1: Cube().writeVertexData(param1, data.cube); break;
+            case 2: Cylinder().writeVertexData(param1, param2, data.cylinder); break;
+            case 3: Cone().writeVertexData(param1, param2, data.cone); break;
+            case 4: Torus().writeVertexData(param1, param2, data.torus, data.torusIndices); break;
+        }
+    });
+}
+
+/**
+ * @brief Times tesselating every primitive type into storage sized up front, as generateShapeData() does,
+ *        against emitting the same floats the way the shapes used to: push_back one at a time into a
+ *        vector that was never reserved, returned by value and copied once more on the way to bindVBO().
+ *        Then prints the vertex cache efficiency optimizeShapeData() gets out of the tesselated order
+ */
+void Realtime::benchmarkShapeData(int param1, int param2){
+    ShapeMeshData data;
+    auto resize = [&](){
+        data.sphere.vertices.resize(Sphere::getVertexDataSize(param1, param2));
+        data.cube.vertices.resize(Cube::getVertexDataSize(param1));
+        data.cylinder.vertices.resize(Cylinder::getVertexDataSize(param1, param2));
+        data.cone.vertices.resize(Cone::getVertexDataSize(param1, param2));
+        data.torus.vertices.resize(Torus::getVertexDataSize(param1, param2));
+        data.torus.indices.resize(Torus::getIndexCount(param1, param2));
+    };
+    auto write = [&](){
+        writeShapeData({data.sphere.vertices, data.cube.vertices, data.cylinder.vertices, data.cone.vertices,
+                        data.torus.vertices, data.torus.indices}, param1, param2);
+    };
+    auto pushBack = [](const std::vector<float> &floats){
+        std::vector<float> vertexData;
+        for (float value : floats){
+            vertexData.push_back(value);
+        }
+        return vertexData;
+    };
+
+    resize();
+    size_t vertices = (data.sphere.vertices.size() + data.cube.vertices.size() + data.cylinder.vertices.size() +
+                       data.cone.vertices.size() + data.torus.vertices.size()) / 6;
+    constexpr int ITERATIONS = 20;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < ITERATIONS; i++){
+        data = ShapeMeshData();
+        resize();
+        write();
+    }
+    qint64 directNsecs = std::max<qint64>(timer.nsecsElapsed(), 1);
+
+    timer.start();
+    for (int i = 0; i < ITERATIONS; i++){
+        write();
+        for (MeshData *mesh : {&data.sphere, &data.cube, &data.cylinder, &data.cone, &data.torus}){
+            std::vector<float> shapeData = pushBack(mesh->vertices);
+            std::vector<float> upload = shapeData;
+
+            // the copy replaces the mesh's vertices, so it can't be optimized away
+            mesh->vertices.swap(upload);
+        }
+    }
+    qint64 pushBackNsecs = std::max<qint64>(timer.nsecsElapsed(), 1);
+
+    std::cout << "Tesselating " << vertices << " vertices (" << param1 << ", " << param2 << "): "
+              << vertices * ITERATIONS * 1e3 / directNsecs << " Mverts/s into preallocated storage, "
+              << vertices * ITERATIONS * 1e3 / pushBackNsecs << " Mverts/s through push_back and copies" << std::endl;
+
+    // vertex cache efficiency of the tesselated order against the optimized one
+    std::array<MeshOptimizeStats, 5> stats;
+    optimizeShapeData(data, &stats);
+    const char *names[] = {"sphere", "cube", "cylinder", "cone", "torus"};
+    for (int i = 0; i < 5; i++){
+        MeshOptimizer::printStats(names[i], stats[i]);
+    }
+}
+
+/**
+ * @brief Tesselates every primitive type into CPU memory, then indexes and optimizes it for drawing.
+ *        Every vector is sized exactly once up front. Thread safe, so it may run off the GUI thread
+ */
+void Realtime::generateShapeData(ShapeMeshData &data, int param1, int param2){
+    data.sphere.vertices.resize(Sphere::getVertexDataSize(param1, param2));
+    data.cube.vertices.resize(Cube::getVertexDataSize(param1));
+    data.cylinder.vertices.resize(Cylinder::getVertexDataSize(param1, param2));
+    data.cone.vertices.resize(Cone::getVertexDataSize(param1, param2));
+    data.torus.vertices.resize(Torus::getVertexDataSize(param1, param2));
+    data.torus.indices.resize(Torus::getIndexCount(param1, param2));
+
+    writeShapeData({data.sphere.vertices, data.cube.vertices, data.cylinder.vertices, data.cone.vertices,
+                    data.torus.vertices, data.torus.indices}, param1, param2);
+    optimizeShapeData(data);
+}
+
+/**
+ * @brief Welds the triangle lists the shapes tesselate into indexed meshes, then orders their triangles
+ *        for the post-transform vertex cache and against overdraw, and their vertices for fetching.
+ *        Thread safe, so it may run off the GUI thread
+ * @param stats -- if not null, receives what optimizing did to each shape, in ShapeMeshData's order
+ */
+void Realtime::optimizeShapeData(ShapeMeshData &data, std::array<MeshOptimizeStats, 5> *stats){
+    std::array<MeshData *, 5> meshes = {&data.sphere, &data.cube, &data.cylinder, &data.cone, &data.torus};
+    Parallel::forEach(5, [&](int i){
+        // the torus is tesselated indexed already
+        if (meshes[i] != &data.torus){
+            MeshOptimizer::generateIndexBuffer(*meshes[i], 6);
+        }
+        MeshOptimizeStats optimized = MeshOptimizer::optimize(*meshes[i], 6);
+        if (stats){
+            (*stats)[i] = optimized;
+        }
+    });
+}
+
+/**
+ * @brief Synchronously tesselates and uploads every primitive type.
+ *        Used once in initializeGL(), later changes go through requestShapeData()
  */
 void Realtime::updateShapeData(int param1, int param2){
-    sphereData = sphere.getUpdatedSphereData(param1, param2);
-    cubeData = cube.getUpdatedCubeData(param1);
-    cylinderData = cylinder.getUpdatedCylinderData(param1, param2);
-    coneData = cone.getUpdatedConeData(param1, param2);
+    ShapeMeshData data;
+    generateShapeData(data, param1, param2);
+    updateAllVBOS(data);
+
+    m_shapeParam1 = m_requestedParam1 = param1;
+    m_shapeParam2 = m_requestedParam2 = param2;
+}
+
+/**
+ * @brief Called on settingsChanged(), tesselates the shapes on the thread pool so the GUI never blocks.
+ *        The VBOs are updated in onShapeDataReady() once the job is done
+ */
+void Realtime::requestShapeData(int param1, int param2){
+    m_requestedParam1 = param1;
+    m_requestedParam2 = param2;
+
+    // a running job will start a follow-up for these params when it finishes
+    if (m_shapeJobRunning){
+        return;
+    }
+
+    if (param1 == m_shapeParam1 && param2 == m_shapeParam2){
+        return;
+    }
+
+    m_shapeJobRunning = true;
+    QThreadPool::globalInstance()->start([this, param1, param2](){
+        auto data = std::make_shared<ShapeMeshData>();
+        generateShapeData(*data, param1, param2);
+
+        // hand the result back to the GUI thread, which owns the GL context
+        QMetaObject::invokeMethod(this, [this, param1, param2, data](){
+            onShapeDataReady(param1, param2, *data);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Runs on the GUI thread when a tesselation job finishes. Uploads the new vertex data,
+ *        or starts another job if the params changed again in the meantime
+ */
+void Realtime::onShapeDataReady(int param1, int param2, ShapeMeshData &data){
+    m_shapeJobRunning = false;
+
+    if (param1 != m_requestedParam1 || param2 != m_requestedParam2){
+        requestShapeData(m_requestedParam1, m_requestedParam2);
+        return;
+    }
+
+    m_shapeParam1 = param1;
+    m_shapeParam2 = param2;
+
+    // the CPU copy is freed with the job's data once it has been uploaded
+    makeCurrent();
+    updateAllVBOS(data);
+    doneCurrent();
+
+    update(); // asks for a PaintGL() call to occur
 }
 
 /**
  * @brief Initializes VAOS for all shape types
  */
 void Realtime::initializeAllVAOS(){
-    bindVAO(m_sphere_vbo, m_sphere_vao, sphereData);
-    bindVAO(cube_vbo, cube_vao, cubeData);
-    bindVAO(cylinder_vbo, cylinder_vao, cylinderData);
-    bindVAO(cone_vbo, cone_vao, coneData);
+    bindVAO(m_sphere_vbo, m_sphere_vao);
+    bindEBO(m_sphere_ebo, m_sphere_vao);
+    bindVAO(cube_vbo, cube_vao);
+    bindEBO(cube_ebo, cube_vao);
+    bindVAO(cylinder_vbo, cylinder_vao);
+    bindEBO(cylinder_ebo, cylinder_vao);
+    bindVAO(cone_vbo, cone_vao);
+    bindEBO(cone_ebo, cone_vao);
+    bindVAO(torus_vbo, torus_vao);
+    bindEBO(torus_ebo, torus_vao);
+}
+
+/**
+ * @brief Called ONCE during initializeGL(), uploads the sphere drawn around each light with a finite
+ *        radius in deferred shading. Its vertices lie on the unit sphere's surface, so its flat faces
+ *        cut inside it and the mesh is scaled up until the faces' planes clear the sphere
+ */
+void Realtime::initializeLightVolume(){
+    MeshData volume;
+    volume.vertices.resize(Sphere::getVertexDataSize(8, 16));
+    Sphere().writeVertexData(8, 16, volume.vertices);
+    MeshOptimizer::generateIndexBuffer(volume, 6);
+
+    float minPlaneDistance = 0.5f;
+    auto position = [&](unsigned int index){
+        const float *vertex = &volume.vertices[index*6];
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    };
+    for (size_t i = 0; i + 2 < volume.indices.size(); i += 3){
+        glm::vec3 a = position(volume.indices[i]);
+        glm::vec3 b = position(volume.indices[i + 1]);
+        glm::vec3 c = position(volume.indices[i + 2]);
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        if (glm::length(normal) > 0.f){
+            minPlaneDistance = std::min(minPlaneDistance, std::abs(glm::dot(glm::normalize(normal), a)));
+        }
+    }
+    m_volumeScale = 0.5f/minPlaneDistance;
+
+    bindVAO(m_volume_vbo, m_volume_vao);
+    bindEBO(m_volume_ebo, m_volume_vao);
+    bindVBO(m_volume_vbo, volume.vertices.data(), volume.vertices.size()*sizeof(GLfloat));
+    bindVBO(m_volume_ebo, volume.indices.data(), volume.indices.size()*sizeof(GLuint));
+    m_volumeIndexCount = volume.indices.size();
+}
+
+/**
+ * @brief Uploads one shape's mesh in the vertex format picked by settings.packedVertices
+ */
+void Realtime::updateShapeVBO(GLuint &shapeVBO, GLuint &shapeEBO, GLuint &shapeVAO, const MeshData &mesh){
+    if (m_packedVertices){
+        std::vector<PackedShapeVertex> packed;
+        VertexFormat::packShapeVertices(mesh.vertices, packed);
+        bindVBO(shapeVBO, packed.data(), packed.size()*sizeof(PackedShapeVertex));
+    } else {
+        bindVBO(shapeVBO, mesh.vertices.data(), mesh.vertices.size()*sizeof(GLfloat));
+    }
+    bindVBO(shapeEBO, mesh.indices.data(), mesh.indices.size()*sizeof(GLuint));
+    setVertexFormat(shapeVBO, shapeVAO, m_packedVertices);
 }
 
 /**
  * @brief Updates all VBOS with updated shapeData upon settingsChanged();
  */
-void Realtime::updateAllVBOS(){
-    bindVBO(m_sphere_vbo, sphereData);
-    bindVBO(cube_vbo, cubeData);
-    bindVBO(cylinder_vbo, cylinderData);
-    bindVBO(cone_vbo, coneData);
+void Realtime::updateAllVBOS(const ShapeMeshData &data){
+    m_packedVertices = settings.packedVertices;
+    updateShapeVBO(m_sphere_vbo, m_sphere_ebo, m_sphere_vao, data.sphere);
+    updateShapeVBO(cube_vbo, cube_ebo, cube_vao, data.cube);
+    updateShapeVBO(cylinder_vbo, cylinder_ebo, cylinder_vao, data.cylinder);
+    updateShapeVBO(cone_vbo, cone_ebo, cone_vao, data.cone);
+    updateShapeVBO(torus_vbo, torus_ebo, torus_vao, data.torus);
+
+    sphereDataSize = data.sphere.vertices.size();
+    cubeDataSize = data.cube.vertices.size();
+    cylinderDataSize = data.cylinder.vertices.size();
+    coneDataSize = data.cone.vertices.size();
+    torusDataSize = data.torus.vertices.size();
+
+    sphereIndexCount = data.sphere.indices.size();
+    cubeIndexCount = data.cube.indices.size();
+    cylinderIndexCount = data.cylinder.indices.size();
+    coneIndexCount = data.cone.indices.size();
+    torusIndexCount = data.torus.indices.size();
 }
 
 /**
@@ -179,8 +674,10 @@ void Realtime::initializeGL() {
       m_fbo_width = m_screen_width;
       m_fbo_height = m_screen_height;
 
-    m_timer = startTimer(1000/60);
-    m_elapsedTimer.start();
+    // the tick timer is started on demand, unless every frame should be redrawn
+    if (settings.continuousRender){
+        startTickTimer();
+    }
 
     // Initializing GL.
     // GLEW (GL Extension Wrangler) provides access to OpenGL functions.
@@ -205,113 +702,463 @@ void Realtime::initializeGL() {
     // set clear color to black
     glClearColor(0,0,0,1);
 
-    // bind shaders!!!
-    m_shader = ShaderLoader::createShaderProgram(":/resources/shaders/default.vert", ":/resources/shaders/default.frag");
-
-    // set up each shape data member variable intially
-    updateShapeData(settings.shapeParameter1, settings.shapeParameter2);
+    // bind shaders!!! The big ones compile in the background, so the window shows before they are done
+    ShaderLoader::enableParallelCompile();
+    requestShaders();
+    m_fallback_shader = ShaderLoader::createShaderProgram(":/resources/shaders/default.vert", ":/resources/shaders/fallback.frag");
+    m_overdraw.initialize();
+    m_benchmark.initialize();
+    lights.initialize();
+    m_materials.initialize();
 
     // creates all vaos, vbos, fbos only ONCE. vbos are then rebinded each time settings are changed
     initializeAllVAOS();
+    initializeLightVolume();
     initializeFBO();
+
+    // tesselate each shape intially
+    updateShapeData(settings.shapeParameter1, settings.shapeParameter2);
+
+    // a scene loaded before GL was ready still needs its meshes and materials
+    loadSceneMeshes();
+    m_materials.update(m_store.materials);
+}
+
+/**
+ * @brief Submits the shader permutations the current scene and settings draw with, so the driver
+ *        compiles them all at once, in parallel where it can. paintGL() uses whichever are done
+ */
+void Realtime::requestShaders(){
+    ShaderDefines lightDefines = lights.getShaderDefines();
+    if (settings.deferredShading){
+        m_deferred_variants.request(lightDefines);
+        m_gbuffer_variants.request({});
+    } else {
+        m_forward_variants.request(lightDefines);
+    }
+    if (settings.depthPrepass){
+        m_depth_variants.request({});
+    }
+
+    // the unfiltered image is shown while the selected filter compiles
+    m_kernel_variants.request({{"FILTER_MODE", 0}});
+    if (perpixelOn){
+        m_invert_variants.request({{"FILTER_MODE", isGrayScale ? 2 : 1}});
+    } else if (kernelFilterOn){
+        m_kernel_variants.request({{"FILTER_MODE", isSharpen ? 2 : 1}});
+    }
 }
 
 /**
  * @brief Retrives specfifc primitive type's vao, and updates vertedDataSize based on size of
- *        that shape's data
+ *        that shape's data. indexCount is the number of indices to draw for indexed shapes, 0 otherwise.
+ *        mesh is the loaded mesh of a PRIMITIVE_MESH shape, or null if it failed to load
  * @return GLuint shape_vao
  */
-GLuint Realtime::getPrimitiveVAO(RenderShapeData &currShape, int &vertexDataSize){
-    switch (currShape.primitive.type){
+GLuint Realtime::getPrimitiveVAO(PrimitiveType type, const MeshBuffers *mesh, int &vertexDataSize, int &indexCount){
+    indexCount = 0;
+    switch (type){
         case PrimitiveType::PRIMITIVE_SPHERE:       
-            vertexDataSize = sphereData.size();
+            vertexDataSize = sphereDataSize;
+            indexCount = sphereIndexCount;
             return m_sphere_vao;
         break;
         case PrimitiveType::PRIMITIVE_CUBE:
-            vertexDataSize = cubeData.size();
+            vertexDataSize = cubeDataSize;
+            indexCount = cubeIndexCount;
             return cube_vao;
         break;
         case PrimitiveType::PRIMITIVE_CYLINDER:
-            vertexDataSize = cylinderData.size();
+            vertexDataSize = cylinderDataSize;
+            indexCount = cylinderIndexCount;
             return cylinder_vao;
         break;
         case PrimitiveType::PRIMITIVE_CONE:
-            vertexDataSize = coneData.size();
+            vertexDataSize = coneDataSize;
+            indexCount = coneIndexCount;
             return cone_vao;
         break;
+        case PrimitiveType::PRIMITIVE_TORUS:
+            vertexDataSize = torusDataSize;
+            indexCount = torusIndexCount;
+            return torus_vao;
+        break;
+        case PrimitiveType::PRIMITIVE_MESH:
+            if (mesh == nullptr){
+                vertexDataSize = 0;
+                return 0;
+            }
+            vertexDataSize = mesh->vertexDataSize;
+            indexCount = mesh->indexCount;
+            return mesh->vao;
+        break;
     default:
+        vertexDataSize = 0;
         return 0;
         break;
     }
 }
 
 /**
- * @brief Binds coefficients specific to a single shape's material
+ * @brief Tells the vertex shader how a shape's vertices are stored: cached meshes are quantized,
+ *        primitives are quantized within the unit cube when packed, or plain floats
  */
-void Realtime::bindMaterialCoeff(RenderShapeData &currShape){
-    shininess = currShape.primitive.material.shininess;
-    glUniform1f(glGetUniformLocation(m_shader, "shininess"), currShape.primitive.material.shininess);
+void Realtime::bindVertexDecoding(const VertexDecodingLocations &locations, PrimitiveType type, const MeshBuffers *mesh){
+    glm::vec3 offset(0.f);
+    glm::vec3 scale(1.f);
+    bool octNormals = false;
+
+    if (m_packedVertices){
+        offset = glm::vec3(-0.5f);
+    }
 
-    shape_a = currShape.primitive.material.cAmbient;
-    shape_d = currShape.primitive.material.cDiffuse;
-    shape_s = currShape.primitive.material.cSpecular;
+    if (type == PrimitiveType::PRIMITIVE_MESH && mesh != nullptr){
+        offset = mesh->positionOffset;
+        scale = mesh->positionScale;
+        octNormals = true;
+    }
 
-    glUniform4f(glGetUniformLocation(m_shader, "shape_a"), shape_a[0], shape_a[1], shape_a[2], shape_a[3]);
-    glUniform4f(glGetUniformLocation(m_shader, "shape_d"), shape_d[0], shape_d[1], shape_d[2], shape_d[3]);
-    glUniform4f(glGetUniformLocation(m_shader, "shape_s"), shape_s[0], shape_s[1], shape_s[2], shape_s[3]);
+    glUniform3fv(locations.posOffset, 1, &offset[0]);
+    glUniform3fv(locations.posScale, 1, &scale[0]);
+    glUniform1i(locations.octNormals, octNormals);
 }
 
 /**
- * @brief PaintGL() is called anytime the scene is re-rendered or updated
+ * @brief Uploads the materials m_store gained since the last upload
  */
-void Realtime::paintGL() {
-    // BIND FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glViewport(0, 0, m_screen_width, m_screen_height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Realtime::uploadMaterials(){
+    if (!glewInitialized){
+        return;
+    }
+    makeCurrent();
+    m_materials.update(m_store.materials);
+    doneCurrent();
+}
+
+/**
+ * @brief Draws every shape in renderData with shader. Materials binds each shape's material and normals,
+ *        lighting the lights on top. The G-buffer only needs materials, the depth pre-pass only positions
+ */
+void Realtime::drawShapes(GLuint shader, bool materials, bool lighting){
+    if (m_store.size() == 0){
+        return;
+    }
 
     // bind shader
-    glUseProgram(m_shader);
+    glUseProgram(shader);
 
     // pass in m_view and m_proj, which are constant for all primitives in scene
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "m_view"), 1, GL_FALSE, &m_view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "m_proj"), 1, GL_FALSE, &m_proj[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "m_view"), 1, GL_FALSE, &m_view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "m_proj"), 1, GL_FALSE, &m_proj[0][0]);
+
+    if (lighting){
+        // passes in world_cam position once
+        glUniform4f(glGetUniformLocation(shader, "world_camera_pos"), world_camera_pos[0],world_camera_pos[1],world_camera_pos[2],world_camera_pos[3]);
+
+        // populates shader with light data, binned by paintGL()
+        lights.setupLightData(shader, m_screen_width, m_screen_height, ka, kd, ks);
+    } else if (materials){
+        // the G-buffer's colour starts out as the ambient term
+        lights.setSceneLightingCoeff(shader, ka, kd, ks);
+    }
+    if (materials){
+        m_materials.bind(shader);
+    }
 
-    // passes in world_cam position once
-    glUniform4f(glGetUniformLocation(m_shader, "world_camera_pos"), world_camera_pos[0],world_camera_pos[1],world_camera_pos[2],world_camera_pos[3]);
+    // per shape uniforms are looked up once per pass
+    GLint materialLocation = glGetUniformLocation(shader, "material_index");
+    GLint modelLocation = glGetUniformLocation(shader, "m_model");
+    GLint normalMatrixLocation = glGetUniformLocation(shader, "inverse_transpose_ctm");
+    VertexDecodingLocations decodingLocations = {glGetUniformLocation(shader, "pos_offset"),
+                                                 glGetUniformLocation(shader, "pos_scale"),
+                                                 glGetUniformLocation(shader, "oct_normals")};
+    uint32_t boundMaterial = UINT32_MAX;
+
+    // primitives all decode the same way and each mesh file its own, so the decoding follows the mesh
+    bool decodingBound = false;
+    const MeshBuffers *boundMesh = nullptr;
+
+    // the loaded mesh of every mesh file, looked up once per pass rather than once per shape. Null if it failed to load
+    std::vector<const MeshBuffers *> meshes(m_store.meshfiles.size(), nullptr);
+    for (size_t i = 0; i < meshes.size(); i++){
+        auto mesh = m_meshes.find(m_store.meshfiles[i]);
+        if (mesh != m_meshes.end()){
+            meshes[i] = &mesh->second;
+        }
+    }
 
-    RenderShapeData currShape;
+    // reads only the store's arrays, shape i at index i of each
     int vertexDataSize;
+    int indexCount;
+    for (size_t i = 0; i < m_store.size(); i++){
+        PrimitiveType type = m_store.types[i];
+        const MeshBuffers *mesh = type == PrimitiveType::PRIMITIVE_MESH ? meshes[m_store.meshIndices[i]] : nullptr;
+
+        // bind vao for that shape type and then draw. Meshes that failed to load have none
+        GLuint vao = getPrimitiveVAO(type, mesh, vertexDataSize, indexCount);
+        if (vao == 0){
+            continue;
+        }
+        glBindVertexArray(vao);
+
+        // bind the shape's material, only when it differs from the previous shape's, and vertex format
+        if (materials && m_store.materialIndices[i] != boundMaterial){
+            boundMaterial = m_store.materialIndices[i];
+            glUniform1i(materialLocation, boundMaterial);
+        }
+        if (!decodingBound || mesh != boundMesh){
+            decodingBound = true;
+            boundMesh = mesh;
+            bindVertexDecoding(decodingLocations, type, mesh);
+        }
+
+        // get and bind ctms
+        m_model = m_store.ctms[i];
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &m_model[0][0]);
+        if (materials){
+            inverse_transpose_model = m_store.normalMatrices[i];
+            glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &inverse_transpose_model[0][0]);
+        }
+
+        // draw command
+        if (indexCount > 0){
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, vertexDataSize / 6);
+        }
 
-    if (renderData.shapes.size() > 0){
-        // populates shader with light data
-        lights.setupLightData(m_shader, renderData.lights, ka, kd, ks);
+        // unbind array
+        glBindVertexArray(0);
+    }
 
-        for (int i=0; i < renderData.shapes.size(); i++){
-            currShape = renderData.shapes[i];
+    // deactivate shader
+    glUseProgram(0);
+}
 
-            // bind vao for that shape type and then draw
-            glBindVertexArray(getPrimitiveVAO(currShape, vertexDataSize));
+/**
+ * @brief Shades the G-buffer with every light, adding onto the ambient colour the geometry pass
+ *        left in m_fbo_texture. Global lights shade every pixel in one fullscreen pass. Each other light
+ *        draws the back faces of a sphere around it, which pass GL_GEQUAL only behind scene surfaces,
+ *        so a light only shades the pixels its sphere covers
+ */
+void Realtime::paintDeferredLights(){
+    int globalLights = lights.getGlobalLightCount();
+    int volumeLights = lights.getLightCount() - globalLights;
+
+    glUseProgram(m_deferred_shader);
+    glUniformMatrix4fv(glGetUniformLocation(m_deferred_shader, "m_view"), 1, GL_FALSE, &m_view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_deferred_shader, "m_proj"), 1, GL_FALSE, &m_proj[0][0]);
+    glUniform4f(glGetUniformLocation(m_deferred_shader, "world_camera_pos"), world_camera_pos[0],world_camera_pos[1],world_camera_pos[2],world_camera_pos[3]);
+    lights.setupLightData(m_deferred_shader, m_screen_width, m_screen_height, ka, kd, ks);
+
+    // G-buffer textures go after the light buffers' units
+    const char *samplers[Filter::GBUFFER_TARGETS] = {"g_position", "g_normal", "g_diffuse", "g_specular"};
+    for (int i = 0; i < Filter::GBUFFER_TARGETS; i++){
+        glActiveTexture(GL_TEXTURE4 + i);
+        glBindTexture(GL_TEXTURE_2D, m_gbuffer_textures[i]);
+        glUniform1i(glGetUniformLocation(m_deferred_shader, samplers[i]), 4 + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    // lights add up, and the geometry pass's depth is only tested against
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    if (globalLights > 0){
+        glDisable(GL_DEPTH_TEST);
+        glUniform1i(glGetUniformLocation(m_deferred_shader, "light_volumes"), false);
+        glBindVertexArray(m_fullscreen_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glEnable(GL_DEPTH_TEST);
+    }
 
-            // bind currShape's specific material coefficients
-            bindMaterialCoeff(currShape);
+    if (volumeLights > 0){
+        // back faces still draw with the camera inside a volume, and depth clamping keeps
+        // volumes reaching past the far plane from being clipped open
+        glCullFace(GL_FRONT);
+        glDepthFunc(GL_GEQUAL);
+        glEnable(GL_DEPTH_CLAMP);
+
+        glUniform1i(glGetUniformLocation(m_deferred_shader, "light_volumes"), true);
+        glUniform1i(glGetUniformLocation(m_deferred_shader, "first_light"), globalLights);
+        glUniform1f(glGetUniformLocation(m_deferred_shader, "volume_scale"), m_volumeScale);
+        glBindVertexArray(m_volume_vao);
+        glDrawElementsInstanced(GL_TRIANGLES, m_volumeIndexCount, GL_UNSIGNED_INT, nullptr, volumeLights);
+
+        glDisable(GL_DEPTH_CLAMP);
+        glDepthFunc(GL_LESS);
+        glCullFace(GL_BACK);
+    }
 
-            // get and bind ctms
-            m_model = currShape.ctm;
-            inverse_transpose_model = currShape.inverse_transpose_ctm;
-            glUniformMatrix4fv(glGetUniformLocation(m_shader, "m_model"), 1, GL_FALSE, &m_model[0][0]);
-            glUniformMatrix3fv(glGetUniformLocation(m_shader, "inverse_transpose_ctm"), 1, GL_FALSE, &inverse_transpose_model[0][0]);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
 
-            // draw command
-            glDrawArrays(GL_TRIANGLES, 0, vertexDataSize / 6);
+    for (int i = 0; i < Filter::GBUFFER_TARGETS; i++){
+        glActiveTexture(GL_TEXTURE4 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+}
 
-            // unbind array
-            glBindVertexArray(0);
+/**
+ * @brief Starts or stops shader hot reload. While it is on, shaders are read from the source tree
+ *        instead of the resources, and every file in it is watched for changes
+ */
+void Realtime::updateShaderWatcher(){
+    m_shaderHotReload = settings.shaderHotReload;
+    if (!m_shaderWatcher.files().isEmpty()){
+        m_shaderWatcher.removePaths(m_shaderWatcher.files());
+    }
+
+#ifdef RESOURCE_SOURCE_DIR
+    if (settings.shaderHotReload){
+        ShaderLoader::setSourceDirectory(RESOURCE_SOURCE_DIR);
+        QDir shaderDir(QString(RESOURCE_SOURCE_DIR) + "/resources/shaders");
+        for (const QFileInfo &file : shaderDir.entryInfoList(QDir::Files)){
+            m_shaderWatcher.addPath(file.absoluteFilePath());
         }
+        std::cout << "Watching " << m_shaderWatcher.files().size() << " shaders in "
+                  << shaderDir.absolutePath().toStdString() << std::endl;
+        return;
+    }
+#else
+    if (settings.shaderHotReload){
+        std::cerr << "Shader hot reload needs RESOURCE_SOURCE_DIR, set by CMakeLists.txt" << std::endl;
     }
+#endif
 
-    // deactivate shader
-    glUseProgram(0);
+    // back to the resources compiled into the executable, programs already built from the source tree stay
+    ShaderLoader::setSourceDirectory("");
+}
+
+/**
+ * @brief Every set of shader programs Realtime draws with
+ */
+std::array<ShaderVariants *, 6> Realtime::getShaderVariants(){
+    return {&m_forward_variants, &m_deferred_variants, &m_depth_variants,
+            &m_gbuffer_variants, &m_invert_variants, &m_kernel_variants};
+}
+
+/**
+ * @brief Recompiles every shader program that reads the changed file. The running programs keep
+ *        drawing until the new ones are ready, and stay if the new ones fail to compile
+ */
+void Realtime::reloadShader(const QString &path){
+    // editors often save by replacing the file, which drops it from the watcher
+    if (QFileInfo::exists(path) && !m_shaderWatcher.files().contains(path)){
+        m_shaderWatcher.addPath(path);
+    }
+
+    if (!glewInitialized){
+        return;
+    }
+
+    makeCurrent();
+    std::string filepath = QFileInfo(path).absoluteFilePath().toStdString();
+    bool used = false;
+    for (ShaderVariants *variants : getShaderVariants()){
+        used |= variants->reload(filepath);
+    }
+    doneCurrent();
+
+    if (used){
+        std::cout << "Reloading shaders that read " << filepath << std::endl;
+        update(); // paintGL() swaps the new programs in as they finish
+    }
+}
+
+/**
+ * @brief PaintGL() is called anytime the scene is re-rendered or updated
+ */
+void Realtime::paintGL() {
+    bool deferred = settings.deferredShading;
+
+    // the lighting permutation for the current lights. Until it has compiled, shapes are drawn forward
+    // with the fallback shader, and another frame is asked for to check again. If it or the G-buffer
+    // program failed to compile, the fallback shader draws until hot reload brings a fixed version
+    ShaderVariants &lightingVariants = deferred ? m_deferred_variants : m_forward_variants;
+    GLuint lighting = lightingVariants.poll(lights.getShaderDefines());
+    GLuint gbuffer = deferred && lighting != 0 ? m_gbuffer_variants.get({}) : 0;
+    if (lighting == 0 || (deferred && gbuffer == 0)){
+        if (lighting == 0 && !lightingVariants.hasFailed(lights.getShaderDefines())){
+            update();
+        }
+        lighting = 0;
+        deferred = false;
+        m_shader = m_fallback_shader;
+    } else if (deferred){
+        m_deferred_shader = lighting;
+    } else {
+        m_shader = lighting;
+    }
+
+    // hot reloaded programs replace the old ones as they finish compiling, checked every frame until all have
+    bool reloading = false;
+    for (ShaderVariants *variants : getShaderVariants()){
+        reloading |= variants->swapReloaded();
+    }
+    if (reloading){
+        update();
+    }
+
+    // BIND FBO, deferred shading renders shapes into the G-buffer, which shares m_fbo's colour and depth
+    glBindFramebuffer(GL_FRAMEBUFFER, deferred ? m_gbuffer_fbo : m_fbo);
+    glViewport(0, 0, m_screen_width, m_screen_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (deferred){
+        // position.w = 0 marks pixels without geometry for the light passes
+        const GLfloat empty[4] = {0.f, 0.f, 0.f, 0.f};
+        glClearBufferfv(GL_COLOR, 1, empty);
+    }
+
+    // frames drawn with the fallback shader don't count
+    if (lighting != 0){
+        m_benchmark.beginFrame(std::string(deferred ? "deferred, " : "forward, ") + std::to_string(lights.getLightCount()) + " lights");
+    }
+    m_overdraw.beginFrame();
+
+    // bins point and spot lights into clusters for this frame's camera, deferred shading doesn't need them
+    if (deferred){
+        lights.uploadLights();
+    } else {
+        lights.cullLights(m_view, m_proj, settings.nearPlane, settings.farPlane);
+    }
+
+    // the pre-pass lays down the final depth with a trivial shader, so the shading pass
+    // runs default.frag only for fragments that pass GL_EQUAL, once per visible pixel
+    GLuint depthShader = settings.depthPrepass ? m_depth_variants.get({}) : 0;
+    bool prepass = depthShader != 0;
+    if (prepass){
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        m_overdraw.beginPass(OverdrawCounter::DepthPass);
+        drawShapes(depthShader, false, false);
+        m_overdraw.endPass();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    m_overdraw.beginPass(OverdrawCounter::ShadingPass);
+    drawShapes(deferred ? gbuffer : m_shader, true, !deferred);
+    m_overdraw.endPass();
+    m_overdraw.endFrame();
+
+    // depth writes must be back on for the next glClear
+    if (prepass){
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    // the light passes read the G-buffer, so they draw into m_fbo, which only has the colour attachment
+    if (deferred){
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        paintDeferredLights();
+    }
+    m_benchmark.endFrame();
 
     // bind DEFAULT FBO
     glBindFramebuffer(GL_FRAMEBUFFER, m_defaultFBO);
@@ -356,15 +1203,125 @@ void Realtime::resizeGL(int w, int h) {
 
     // update FBO dimensions and camera settings
     filter.updateFBOSettings(m_fbo_texture, m_fbo_renderbuffer, m_fbo, m_defaultFBO, m_fbo_width, m_fbo_height);
+    filter.updateGBufferSettings(m_fbo_texture, m_fbo_renderbuffer, m_gbuffer_fbo, m_gbuffer_textures,
+                                 m_defaultFBO, m_fbo_width, m_fbo_height);
     updateCameraSettings(settings.nearPlane, settings.farPlane, size().width(), size().height(), renderData);
 }
 
 /**
- * @brief When new scene is loaded
+ * @brief When new scene is loaded. Parses it on the thread pool, cancelling a load still running.
+ *        The previous scene stays on screen until the new one's metadata arrives
  */
 void Realtime::sceneChanged() {
-    // parses scene once, whenever scene is changed
-    parser.parse(settings.sceneFilePath, renderData);
+    cancelSceneLoad();
+    m_sceneReloadPending = false;
+    m_meshesLoading.clear();
+    m_meshesFailed.clear();
+    if (!m_sceneWatcher.files().isEmpty()){
+        m_sceneWatcher.removePaths(m_sceneWatcher.files());
+    }
+
+    int loadId = m_sceneLoadId;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_sceneLoadCancelled = cancelled;
+    m_sceneLoading = true;
+    m_sceneLoadTimer.start();
+    if (m_sceneLoadProgress){
+        m_sceneLoadProgress(0.f);
+    }
+
+    std::string filepath = settings.sceneFilePath;
+    QThreadPool::globalInstance()->start([this, loadId, cancelled, filepath](){
+        // hands every result back to the GUI thread, which owns renderData and the GL context
+        RenderData header;
+        auto subtrees = std::make_shared<std::vector<SceneSubtree>>();
+        bool first = true;
+        size_t sentMaterials = 0;
+        bool success = SceneParser::parse(filepath, header, SCENE_CHUNK_SIZE,
+                                          [&](std::vector<RenderShapeData> &chunk, float progress){
+            if (*cancelled){
+                return false;
+            }
+
+            if (first){
+                first = false;
+                auto metadata = std::make_shared<RenderData>(header);
+                QMetaObject::invokeMethod(this, [this, loadId, metadata](){
+                    onSceneHeaderReady(loadId, *metadata);
+                }, Qt::QueuedConnection);
+            }
+
+            // the chunk's shapes index materials interned since the previous chunk, which are sent along
+            const std::vector<SceneMaterial> &interned = header.materials.getMaterials();
+            auto materials = std::make_shared<std::vector<SceneMaterial>>(interned.begin() + sentMaterials, interned.end());
+            sentMaterials = interned.size();
+
+            auto shapes = std::make_shared<std::vector<RenderShapeData>>(std::move(chunk));
+            QMetaObject::invokeMethod(this, [this, loadId, shapes, materials, progress](){
+                onSceneChunkReady(loadId, *shapes, *materials, progress);
+            }, Qt::QueuedConnection);
+            return true;
+        }, subtrees.get());
+
+        if (!*cancelled){
+            QMetaObject::invokeMethod(this, [this, loadId, success, subtrees](){
+                onSceneLoaded(loadId, success, *subtrees);
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+/**
+ * @brief Stops the running scene load, whatever it has shown so far stays
+ */
+void Realtime::cancelSceneLoad() {
+    if (m_sceneLoadCancelled){
+        *m_sceneLoadCancelled = true;
+        m_sceneLoadCancelled.reset();
+    }
+
+    // results already queued by the cancelled load are dropped
+    m_sceneLoadId++;
+
+    if (m_sceneLoading){
+        m_sceneLoading = false;
+        std::cout << "Cancelled loading scene after " << m_sceneLoadTimer.elapsed() << " ms" << std::endl;
+        if (m_sceneLoadProgress){
+            m_sceneLoadProgress(1.f);
+        }
+    }
+}
+
+void Realtime::setSceneLoadProgressHandler(std::function<void(float progress)> handler) {
+    m_sceneLoadProgress = std::move(handler);
+}
+
+/**
+ * @brief Runs on the GUI thread once the scene's global data, camera and lights are parsed.
+ *        Replaces the previous scene, whose shapes are cleared for the new ones to stream in
+ */
+void Realtime::onSceneHeaderReady(int loadId, const RenderData &header) {
+    if (loadId != m_sceneLoadId){
+        return;
+    }
+
+    renderData.globalData = header.globalData;
+    renderData.cameraData = header.cameraData;
+    renderData.lights = header.lights;
+    renderData.shapes.clear();
+    renderData.materials = MaterialTable();
+    m_store.clear();
+    uploadMaterials();
+    m_pickBVHDirty = true;
+    m_picked = ShapeBVH::Hit();
+
+    m_sceneLightCount = renderData.lights.size();
+    updateBenchmarkLights();
+    if (glewInitialized){
+        makeCurrent();
+        requestShaders();
+        doneCurrent();
+    }
 
     // updates camera settings
     camera.initializeCamera(renderData);
@@ -373,6 +1330,222 @@ void Realtime::sceneChanged() {
     update(); // asks for a PaintGL() call to occur
 }
 
+/**
+ * @brief Runs on the GUI thread for every chunk of flattened shapes, which are drawn from the next frame on
+ */
+void Realtime::onSceneChunkReady(int loadId, std::vector<RenderShapeData> &shapes, const std::vector<SceneMaterial> &materials,
+                                 float progress) {
+    if (loadId != m_sceneLoadId){
+        return;
+    }
+
+    // interned in the parser's order, so the shapes' indices hold here too
+    for (const SceneMaterial &material : materials){
+        renderData.materials.intern(material);
+    }
+    if (!materials.empty()){
+        m_store.updateMaterials(renderData.materials);
+        uploadMaterials();
+    }
+
+    size_t firstShape = renderData.shapes.size();
+    renderData.shapes.insert(renderData.shapes.end(), std::make_move_iterator(shapes.begin()),
+                             std::make_move_iterator(shapes.end()));
+    m_store.append(renderData.shapes.data() + firstShape, renderData.shapes.size() - firstShape);
+    m_pickBVHDirty = true;
+
+    // loaded before GL is ready, initializeGL() loads the meshes of all shapes so far
+    if (glewInitialized && firstShape < renderData.shapes.size()){
+        loadSceneMeshes(firstShape);
+    }
+
+    if (m_sceneLoadProgress){
+        m_sceneLoadProgress(progress);
+    }
+    update();
+}
+
+/**
+ * @brief Runs on the GUI thread once the whole scene is parsed, or the parse failed
+ */
+void Realtime::onSceneLoaded(int loadId, bool success, std::vector<SceneSubtree> &subtrees) {
+    if (loadId != m_sceneLoadId){
+        return;
+    }
+
+    m_sceneLoading = false;
+    m_sceneLoadCancelled.reset();
+    m_sceneSubtrees = std::move(subtrees);
+    m_sceneWatcher.addPath(QString::fromStdString(settings.sceneFilePath));
+    if (success){
+        std::cout << "Loaded " << renderData.shapes.size() << " shapes in " << m_sceneLoadTimer.elapsed() << " ms" << std::endl;
+
+        // frees the previous scene's meshes this one doesn't use, and scatters benchmark lights over the final bounds
+        if (glewInitialized){
+            loadSceneMeshes();
+        }
+        if (m_benchmarkLightCount > 0){
+            updateBenchmarkLights();
+        }
+        if (settings.cpuBenchmarks){
+            benchmarkScene();
+        }
+    } else {
+        std::cerr << "Failed to load scene: " << settings.sceneFilePath << std::endl;
+    }
+
+    if (m_sceneLoadProgress){
+        m_sceneLoadProgress(1.f);
+    }
+    update();
+
+    // edits saved while the scene was loading
+    if (m_sceneReloadPending){
+        reloadScene();
+    }
+}
+
+/**
+ * @brief Called when the scene file changes on disk. Parses it again on the thread pool, against the
+ *        subtrees renderData holds now, so only the subtrees that changed are flattened again
+ */
+void Realtime::reloadScene() {
+    // a load reads the file after this change anyway, a running reload may not have
+    if (m_sceneLoading || m_sceneReloadRunning){
+        m_sceneReloadPending = true;
+        return;
+    }
+    m_sceneReloadPending = false;
+    m_sceneReloadRunning = true;
+    m_meshesFailed.clear();
+
+    int loadId = m_sceneLoadId;
+    std::string filepath = settings.sceneFilePath;
+    std::vector<SceneSubtree> previous = m_sceneSubtrees;
+    MaterialTable materials = renderData.materials;
+    m_sceneLoadTimer.start();
+    QThreadPool::globalInstance()->start([this, loadId, filepath, previous, materials](){
+        auto sceneUpdate = std::make_shared<SceneUpdate>();
+        bool success = SceneParser::parseChanges(filepath, previous, materials, *sceneUpdate);
+
+        QMetaObject::invokeMethod(this, [this, loadId, success, sceneUpdate](){
+            onSceneReloaded(loadId, success, *sceneUpdate);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Runs on the GUI thread when a reload is parsed. Patches renderData and redoes only the work that
+ *        depends on what changed: lights are uploaded and shaders requested if the lights changed, meshes
+ *        loaded if shapes changed, and the camera reset only if the file's camera changed
+ */
+void Realtime::onSceneReloaded(int loadId, bool success, SceneUpdate &sceneUpdate) {
+    m_sceneReloadRunning = false;
+
+    // another scene was chosen meanwhile
+    if (loadId != m_sceneLoadId){
+        return;
+    }
+
+    // a half written file fails to parse, the next save reloads it
+    if (!success){
+        std::cerr << "Failed to reload scene, keeping the current one: " << settings.sceneFilePath << std::endl;
+    } else {
+        SceneChanges changes = SceneDiff::apply(sceneUpdate, renderData, m_sceneLightCount, m_sceneSubtrees);
+
+        // the store follows the shapes, rebuilt whole as it is cheap next to parsing
+        bool shapesChanged = changes.shapesChanged > 0 || changes.shapesMoved;
+        if (shapesChanged){
+            m_store.build(renderData);
+            m_pickBVHDirty = true;
+            m_picked = ShapeBVH::Hit();
+        } else if (changes.materials){
+            m_store.updateMaterials(renderData.materials);
+        }
+        if (changes.materials){
+            uploadMaterials();
+        }
+
+        if (changes.lights){
+            m_sceneLightCount = renderData.lights.size();
+            updateBenchmarkLights();
+            if (glewInitialized){
+                makeCurrent();
+                requestShaders();
+                doneCurrent();
+            }
+        } else if (shapesChanged && m_benchmarkLightCount > 0){
+            updateBenchmarkLights();
+        }
+
+        if (shapesChanged && glewInitialized){
+            loadSceneMeshes();
+        }
+
+        if (changes.camera){
+            camera.initializeCamera(renderData);
+        }
+        if (changes.camera || changes.globalData){
+            updateCameraSettings(settings.nearPlane, settings.farPlane, size().width(), size().height(), renderData);
+        }
+
+        std::cout << "Reloaded scene in " << m_sceneLoadTimer.elapsed() << " ms: " << changes.shapesChanged << " of "
+                  << renderData.shapes.size() << " shapes changed" << (changes.shapesMoved ? " (rebuilt)" : "")
+                  << (changes.lights ? ", lights changed" : "") << (changes.camera ? ", camera changed" : "")
+                  << (changes.globalData ? ", global data changed" : "") << std::endl;
+        for (const std::string &name : changes.changedSubtrees){
+            std::cout << "  changed: " << name << std::endl;
+        }
+
+        if (changes.any()){
+            update();
+        }
+    }
+
+    if (m_sceneReloadPending){
+        reloadScene();
+    }
+}
+
+/**
+ * @brief Replaces the random lights appended to the scene's lights with settings.benchmarkLights new ones.
+ *        They are point lights scattered over the shapes' bounds, each reaching a quarter of the way across,
+ *        and always the same for the same scene and count so forward and deferred timings compare
+ */
+void Realtime::updateBenchmarkLights(){
+    renderData.lights.resize(m_sceneLightCount);
+    m_benchmarkLightCount = settings.benchmarkLights;
+
+    glm::vec3 boundsMin(-1.f);
+    glm::vec3 boundsMax(1.f);
+    if (m_store.size() > 0){
+        boundsMin = boundsMax = glm::vec3(m_store.ctms[0][3]);
+        for (const glm::mat4 &ctm : m_store.ctms){
+            boundsMin = glm::min(boundsMin, glm::vec3(ctm[3]));
+            boundsMax = glm::max(boundsMax, glm::vec3(ctm[3]));
+        }
+        boundsMin -= 1.f;
+        boundsMax += 1.f;
+    }
+    float radius = 0.25f*glm::length(boundsMax - boundsMin);
+
+    std::mt19937 rng(m_benchmarkLightCount);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    for (int i = 0; i < m_benchmarkLightCount; i++){
+        SceneLightData light{};
+        light.id = m_sceneLightCount + i;
+        light.type = LightType::LIGHT_POINT;
+        light.pos = glm::vec4(glm::mix(boundsMin, boundsMax, glm::vec3(unit(rng), unit(rng), unit(rng))), 1.f);
+        light.color = glm::vec4(0.1f + 0.4f*unit(rng), 0.1f + 0.4f*unit(rng), 0.1f + 0.4f*unit(rng), 1.f);
+
+        // attenuates to about 1/256 at radius
+        light.function = glm::vec3(1.f, 0.f, 256.f/(radius*radius));
+        renderData.lights.push_back(light);
+    }
+
+    lights.updateLights(renderData.lights);
+}
+
 /**
  * @brief Determines which filters to activate depending on buttons selected in GUI
  */
@@ -411,20 +1584,101 @@ void Realtime::settingsChanged() {
 
     // updates both camera settings and shapeData based on GUI param sliders
     updateCameraSettings(settings.nearPlane, settings.farPlane, size().width(), size().height(), renderData);
-    updateShapeData(settings.shapeParameter1, settings.shapeParameter2);
 
-    // only if initializeGL() was called and the vao/vbos had been generated
+    // only if initializeGL() was called and the vao/vbos had been generated,
+    // otherwise initializeGL() tesselates with the current params itself
     if (glewInitialized){
-        updateAllVBOS();
+        // switching vertex formats re-tesselates, as no float copy of the shapes is kept once uploaded.
+        // A running job uploads in the new format anyway
+        if (settings.packedVertices != m_packedVertices && !m_shapeJobRunning){
+            m_shapeParam1 = m_shapeParam2 = -1;
+        }
+        requestShapeData(settings.shapeParameter1, settings.shapeParameter2);
     }
 
     adjustFilterSettings(); // adjusts activated booleans
+
+    if (settings.benchmarkLights != m_benchmarkLightCount){
+        updateBenchmarkLights();
+    }
+
+    if (glewInitialized){
+        requestShaders();
+    }
+
+    if (settings.shaderHotReload != m_shaderHotReload){
+        updateShaderWatcher();
+    }
+
+    if (settings.cpuBenchmarks && !m_cpuBenchmarks){
+        runCpuBenchmarks();
+    }
+    m_cpuBenchmarks = settings.cpuBenchmarks;
+
+    // restart a running frame loop if its frame rate cap changed
+    if (m_frameLoopActive && m_loopFrameRate != settings.maxFrameRate){
+        stopTickTimer();
+    }
+
+    // continuous mode keeps the tick timer alive, otherwise it stops on the next idle tick
+    if (settings.continuousRender){
+        startTickTimer();
+    }
+
     update(); // asks for a PaintGL() call to occur
 }
 
+/**
+ * @brief Starts the frame loop if it is not already running. Frames are driven either by a timer
+ *        at settings.maxFrameRate, or by frameSwapped() when the rate is uncapped
+ */
+void Realtime::startTickTimer(){
+    if (m_frameLoopActive){
+        return;
+    }
+
+    m_frameLoopActive = true;
+    m_loopFrameRate = settings.maxFrameRate;
+
+    // restart so the first tick after idling does not see the whole idle period as deltaTime
+    m_scheduler.reset();
+    m_elapsedTimer.start();
+
+    if (m_loopFrameRate > 0){
+        m_timer = startTimer(1000/m_loopFrameRate);
+    } else {
+        update(); // the first frameSwapped() keeps the loop going
+    }
+}
+
+/**
+ * @brief Stops the frame loop, so that no paintGL() calls happen until the next input or change
+ */
+void Realtime::stopTickTimer(){
+    if (m_timer != 0){
+        killTimer(m_timer);
+        m_timer = 0;
+    }
+    m_frameLoopActive = false;
+}
+
+/**
+ * @brief Checks if any key that moves the camera is currently held down
+ */
+bool Realtime::isCameraMoving(){
+    return m_keyMap[Qt::Key_W] || m_keyMap[Qt::Key_A] || m_keyMap[Qt::Key_S] || m_keyMap[Qt::Key_D] ||
+           m_keyMap[Qt::Key_Space] || m_keyMap[Qt::Key_Control] || m_keyMap[Qt::Key_Meta] ||
+           m_keyMap[Qt::Key_R];
+}
+
 // ================== Project 6: Action!
 void Realtime::keyPressEvent(QKeyEvent *event) {
     m_keyMap[Qt::Key(event->key())] = true;
+
+    // wake up the tick timer only when the key actually moves the camera
+    if (isCameraMoving()){
+        startTickTimer();
+    }
 }
 
 void Realtime::keyReleaseEvent(QKeyEvent *event) {
@@ -435,13 +1689,91 @@ void Realtime::mousePressEvent(QMouseEvent *event) {
     if (event->buttons().testFlag(Qt::LeftButton)) {
         m_mouseDown = true;
         m_prev_mouse_pos = glm::vec2(event->position().x(), event->position().y());
+        m_press_mouse_pos = m_prev_mouse_pos;
     }
 }
 
+/**
+ * @brief A left click that didn't drag the camera picks the shape under the cursor
+ */
 void Realtime::mouseReleaseEvent(QMouseEvent *event) {
     if (!event->buttons().testFlag(Qt::LeftButton)) {
         m_mouseDown = false;
     }
+
+    glm::vec2 position(event->position().x(), event->position().y());
+    if (event->button() == Qt::LeftButton && glm::distance(position, m_press_mouse_pos) < 3.f) {
+        m_picked = pick(position.x, position.y);
+        if (m_pickHandler) {
+            m_pickHandler(m_picked);
+        }
+    }
+}
+
+void Realtime::setPickHandler(std::function<void(const ShapeBVH::Hit &hit)> handler) {
+    m_pickHandler = std::move(handler);
+}
+
+/**
+ * @brief Rebuilds the picking BVH if the shapes or loaded meshes changed since it was built
+ */
+void Realtime::updatePickBVH() {
+    if (!m_pickBVHDirty){
+        return;
+    }
+    m_pickBVHDirty = false;
+
+    // meshes are picked by the bounds of their quantized positions
+    std::unordered_map<std::string, MeshBounds> meshBounds;
+    for (const auto &[meshfile, buffers] : m_meshes){
+        meshBounds[meshfile] = {buffers.positionOffset, buffers.positionOffset + buffers.positionScale};
+    }
+
+    m_pickBVH.build(renderData.shapes, meshBounds);
+}
+
+/**
+ * @brief Unprojects a point of the widget, in logical pixels from the top left, into a world space ray
+ *        from the camera through it
+ */
+Ray Realtime::getPickRay(float x, float y) {
+    glm::vec4 ndc(2.f * x / size().width() - 1.f, 1.f - 2.f * y / size().height(), 1.f, 1.f);
+    glm::vec4 view = glm::inverse(m_proj) * ndc;
+    view /= view.w;
+
+    glm::vec3 origin = glm::vec3(camera.getInverseViewMatrix() * glm::vec4(0.f, 0.f, 0.f, 1.f));
+    glm::vec3 target = glm::vec3(camera.getInverseViewMatrix() * view);
+    return {origin, glm::normalize(target - origin)};
+}
+
+/**
+ * @brief Finds the nearest shape under a point of the widget
+ * @return the hit, whose shape is -1 if the ray hit nothing
+ */
+ShapeBVH::Hit Realtime::pick(float x, float y) {
+    updatePickBVH();
+
+    ShapeBVH::Hit hit;
+    m_pickBVH.intersect(getPickRay(x, y), hit);
+    return hit;
+}
+
+/**
+ * @brief Picks through pseudo random points of the viewport and prints picks per second
+ */
+void Realtime::benchmarkPicking() {
+    updatePickBVH();
+    if (m_pickBVH.empty()){
+        return;
+    }
+
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> x(0.f, size().width()), y(0.f, size().height());
+    std::vector<Ray> rays(100000);
+    for (Ray &ray : rays){
+        ray = getPickRay(x(random), y(random));
+    }
+    m_pickBVH.benchmark(rays);
 }
 
 /**
@@ -468,18 +1800,38 @@ void Realtime::mouseMoveEvent(QMouseEvent *event) {
 }
 
 /**
- * @brief Allows translate on key press
+ * @brief Paces frames when the frame rate is capped
  */
 void Realtime::timerEvent(QTimerEvent *event) {
-    int elapsedms   = m_elapsedTimer.elapsed();
-    float deltaTime = elapsedms * 0.001f;
+    advanceFrame();
+}
+
+/**
+ * @brief Allows translate on key press. Runs the fixed simulation ticks that fit in the time since
+ *        the last frame, then renders the interpolated camera. Stops once no movement keys are held
+ */
+void Realtime::advanceFrame() {
+    float frameSeconds = m_elapsedTimer.nsecsElapsed() * 1e-9f;
     m_elapsedTimer.restart();
 
-    // Use deltaTime and m_keyMap here to move around
-    camera.translateCamera(m_keyMap, deltaTime);
+    // Use the fixed tick delta and m_keyMap here to move around
+    int ticks = m_scheduler.advance(frameSeconds);
+    for (int i = 0; i < ticks; i++){
+        camera.translateCamera(m_keyMap, m_scheduler.getTickDelta());
+    }
+
+    bool keepRunning = settings.continuousRender || isCameraMoving();
+
+    // when stopping, snap to the latest tick so the camera rests where the simulation ended
+    camera.setInterpolationAlpha(keepRunning ? m_scheduler.getAlpha() : 1.f);
 
     // updates camera according to new pos, look, up variables
     updateCameraSettings(settings.nearPlane, settings.farPlane, size().width(), size().height(), renderData);
 
     update(); // asks for a PaintGL() call to occur
+
+    // nothing will change until the next input, so stop ticking
+    if (!keepRunning){
+        stopTickTimer();
+    }
 }
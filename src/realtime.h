@@ -3,32 +3,103 @@
 // Defined before including GLEW to suppress deprecation messages on macOS
 #include "camera.h"
 #include "filter.h"
+#include "framescheduler.h"
+#include "overdrawcounter.h"
 #include "lights.h"
+#include "materialbuffer.h"
+#include "renderbenchmark.h"
 #include "shapes/cone.h"
 #include "shapes/cube.h"
 #include "shapes/cylinder.h"
 #include "shapes/sphere.h"
+#include "shapes/torus.h"
+#include "utils/meshcache.h"
+#include "utils/scenediff.h"
+#include "utils/scenestore.h"
+#include "utils/shapebvh.h"
 #include "utils/sceneparser.h"
+#include "utils/shadervariants.h"
 #ifdef __APPLE__
 #define GL_SILENCE_DEPRECATION
 #endif
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <span>
 #include <unordered_map>
+#include <unordered_set>
 #include <QElapsedTimer>
+#include <QFileSystemWatcher>
 #include <QOpenGLWidget>
 #include <QTime>
 #include <QTimer>
 
+// Indexed, optimized meshes of every primitive type for one pair of tesselation parameters
+struct ShapeMeshData {
+    MeshData sphere;
+    MeshData cube;
+    MeshData cylinder;
+    MeshData cone;
+    MeshData torus;
+};
+
+// GPU buffers of one loaded mesh file
+struct MeshBuffers {
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLuint vao = 0;
+    int vertexDataSize = 0;
+    int indexCount = 0;
+    glm::vec3 positionOffset = glm::vec3(0.f);         // decodes the quantized positions, see CachedMesh
+    glm::vec3 positionScale = glm::vec3(1.f);
+};
+
+// Uniform locations of a shader's vertex decoding, see Realtime::bindVertexDecoding()
+struct VertexDecodingLocations {
+    GLint posOffset;
+    GLint posScale;
+    GLint octNormals;
+};
+
+// Mesh files loaded by one background job, see Realtime::loadSceneMeshes()
+struct SceneMeshLoad {
+    std::vector<std::string> meshfiles;
+    std::vector<CachedMesh> meshes;
+    std::vector<MeshLoadStats> stats;
+    std::vector<MeshOptimizeStats> optimizeStats;
+    std::vector<char> loaded;
+};
+
+// Destination storage for the tesselated vertex data of every primitive type
+struct ShapeMeshSpans {
+    std::span<float> sphere;
+    std::span<float> cube;
+    std::span<float> cylinder;
+    std::span<float> cone;
+    std::span<float> torus;
+    std::span<unsigned int> torusIndices;
+};
+
 class Realtime : public QOpenGLWidget
 {
 public:
     Realtime(QWidget *parent = nullptr);
     void finish();                                      // Called on program exit
-    void sceneChanged();
+    void sceneChanged();                                // starts loading settings.sceneFilePath in the background
+    void cancelSceneLoad();
     void settingsChanged();
 
+    // Called on the GUI thread as a scene loads, with the fraction of its shapes shown so far. 1 once it is done or failed
+    void setSceneLoadProgressHandler(std::function<void(float progress)> handler);
+
+    // Called on the GUI thread when a click picks, with the nearest shape under the cursor. Its shape is -1 if there is none
+    void setPickHandler(std::function<void(const ShapeBVH::Hit &hit)> handler);
+    const ShapeBVH::Hit &getPickedHit() const { return m_picked; }  // the last pick, cleared when the shapes change
+
 public slots:
     void tick(QTimerEvent* event);                      // Called once per tick of m_timer
 
@@ -49,36 +120,102 @@ private:
     void timerEvent(QTimerEvent *event) override;
 
     // Tick Related Variables
-    int m_timer;                                        // Stores timer which attempts to run ~60 times per second
+    int m_timer = 0;                                    // Stores timer which paints at settings.maxFrameRate, 0 while idle or vsync driven
     QElapsedTimer m_elapsedTimer;                       // Stores timer which keeps track of actual time between frames
+    FrameScheduler m_scheduler;                         // Turns frame time into fixed simulation ticks
+    bool m_frameLoopActive = false;                     // Whether frames are currently being driven by the timer or frameSwapped()
+    int m_loopFrameRate = 0;                            // settings.maxFrameRate the running frame loop was started with
 
     // Input Related Variables
     bool m_mouseDown = false;                           // Stores state of left mouse button
     glm::vec2 m_prev_mouse_pos;                         // Stores mouse position
+    glm::vec2 m_press_mouse_pos;                        // Where the left button went down, releasing it there picks
     std::unordered_map<Qt::Key, bool> m_keyMap;         // Stores whether keys are pressed or not
 
+    // picking: rays from the cursor against renderData.shapes through a BVH, rebuilt on the first pick after
+    // the shapes or meshes change
+    ShapeBVH m_pickBVH;
+    bool m_pickBVHDirty = true;
+    ShapeBVH::Hit m_picked;                             // its shape indexes renderData.shapes, -1 if none
+    std::function<void(const ShapeBVH::Hit &)> m_pickHandler;
+    void updatePickBVH();
+    Ray getPickRay(float x, float y);
+    ShapeBVH::Hit pick(float x, float y);
+    void benchmarkPicking();
+
     // Device Correction Variables
     int m_devicePixelRatio;
 
-    GLuint m_shader;
+    // default.frag and lighting.frag are specialized for the scene's lights, see Lights::getShaderDefines.
+    // m_shader is the permutation for the current lights, picked in paintGL()
+    ShaderVariants m_forward_variants{":/resources/shaders/default.vert",
+                                      {":/resources/shaders/default.frag", ":/resources/shaders/lighting.frag"}};
+    GLuint m_shader = 0;
+    GLuint m_fallback_shader;                           // draws shapes until the lighting permutation has compiled
+    void requestShaders();
+    ShaderVariants m_depth_variants{":/resources/shaders/depth.vert", {":/resources/shaders/depth.frag"}};  // position only, for the depth pre-pass
+
+    // shader hot reload: edited shaders in the source tree are recompiled in place of the running ones
+    QFileSystemWatcher m_shaderWatcher;
+    bool m_shaderHotReload = false;                     // settings.shaderHotReload the watcher was set up for
+    void updateShaderWatcher();
+    void reloadShader(const QString &path);
+    std::array<ShaderVariants *, 6> getShaderVariants();
+    OverdrawCounter m_overdraw;
+    RenderBenchmark m_benchmark;                        // GPU time of forward and deferred shading per light count
+
+    // CPU benchmarks, run on the GUI thread while settings.cpuBenchmarks is turned on
+    bool m_cpuBenchmarks = false;                       // settings.cpuBenchmarks the benchmarks last ran for
+    void runCpuBenchmarks();
+    void benchmarkScene();
+    static void benchmarkShapeData(int param1, int param2);
 
     // shape data
     GLuint m_sphere_vbo;
+    GLuint m_sphere_ebo;
     GLuint m_sphere_vao;
 
     GLuint cube_vbo;
+    GLuint cube_ebo;
     GLuint cube_vao;
 
     GLuint cylinder_vbo;
+    GLuint cylinder_ebo;
     GLuint cylinder_vao;
 
     GLuint cone_vbo;
+    GLuint cone_ebo;
     GLuint cone_vao;
 
-    std::vector<float> sphereData;
-    std::vector<float> cubeData;
-    std::vector<float> cylinderData;
-    std::vector<float> coneData;
+    GLuint torus_vbo;
+    GLuint torus_ebo;
+    GLuint torus_vao;
+
+    // number of floats in each shape's VBO
+    int sphereDataSize = 0;
+    int cubeDataSize = 0;
+    int cylinderDataSize = 0;
+    int coneDataSize = 0;
+    int torusDataSize = 0;
+
+    // number of indices in each shape's EBO, every shape is drawn with glDrawElements
+    int sphereIndexCount = 0;
+    int cubeIndexCount = 0;
+    int cylinderIndexCount = 0;
+    int coneIndexCount = 0;
+    int torusIndexCount = 0;
+
+    bool m_packedVertices = false;                      // whether the shape VBOs hold PackedShapeVertex instead of floats
+
+    // mesh files referenced by the scene, each loaded once no matter how many primitives use it
+    std::unordered_map<std::string, MeshBuffers> m_meshes;
+    std::unordered_set<std::string> m_meshesLoading;    // on the thread pool, uploaded when they arrive
+    std::unordered_set<std::string> m_meshesFailed;     // not tried again until the scene is loaded or reloaded again
+    void loadSceneMeshes(size_t firstShape = 0);
+    void onSceneMeshesLoaded(int loadId, SceneMeshLoad &job);
+    void deleteMeshBuffers(MeshBuffers &buffers);
+    void bindMeshVAO(GLuint &meshVBO, GLuint &meshVAO);
+    void bindVertexDecoding(const VertexDecodingLocations &locations, PrimitiveType type, const MeshBuffers *mesh);
 
 
     // matrices
@@ -92,61 +229,119 @@ private:
     Camera camera;
     RenderData renderData;
     SceneParser parser;
+    SceneStore m_store;                                 // renderData.shapes as arrays for drawing, updated with them
+
+    // scenes are parsed and flattened on the thread pool, and their shapes shown a chunk at a time as they
+    // arrive. Results of a load that was cancelled or replaced carry an old m_sceneLoadId and are dropped
+    static constexpr size_t SCENE_CHUNK_SIZE = 256;
+    void onSceneHeaderReady(int loadId, const RenderData &header);
+    void onSceneChunkReady(int loadId, std::vector<RenderShapeData> &shapes, const std::vector<SceneMaterial> &materials,
+                           float progress);
+    void onSceneLoaded(int loadId, bool success, std::vector<SceneSubtree> &subtrees);
+    int m_sceneLoadId = 0;
+    std::shared_ptr<std::atomic<bool>> m_sceneLoadCancelled;   // set to stop the running load's parse
+    bool m_sceneLoading = false;
+    QElapsedTimer m_sceneLoadTimer;
+    std::function<void(float)> m_sceneLoadProgress;
+
+    // the loaded scene file is watched, and edits to it re-flatten only the subtrees that changed, see SceneDiff
+    QFileSystemWatcher m_sceneWatcher;
+    std::vector<SceneSubtree> m_sceneSubtrees;          // the subtrees renderData.shapes holds, in order
+    void reloadScene();
+    void onSceneReloaded(int loadId, bool success, SceneUpdate &sceneUpdate);
+    bool m_sceneReloadRunning = false;
+    bool m_sceneReloadPending = false;                  // the file changed while a load or reload was running
 
 
     // update and initialization
     void updateShapeData(int param1, int param2);
-    void updateAllVBOS();
+    void updateAllVBOS(const ShapeMeshData &data);
+    static void generateShapeData(ShapeMeshData &data, int param1, int param2);
+    static void writeShapeData(const ShapeMeshSpans &data, int param1, int param2);
+    static void optimizeShapeData(ShapeMeshData &data, std::array<MeshOptimizeStats, 5> *stats = nullptr);
+
+    // tesselation runs on the thread pool, at most one job at a time.
+    // Params changed while a job runs are picked up by a follow-up job once it finishes
+    void requestShapeData(int param1, int param2);
+    void onShapeDataReady(int param1, int param2, ShapeMeshData &data);
+    bool m_shapeJobRunning = false;
+    int m_shapeParam1 = -1;                             // params of the shape data currently in the VBOs
+    int m_shapeParam2 = -1;
+    int m_requestedParam1 = -1;                         // most recently requested params
+    int m_requestedParam2 = -1;
 
     void initializeAllVAOS();
     void deleteAllVBOSVAOS();
 
 
-    GLuint getPrimitiveVAO(RenderShapeData &currShape, int &vertexDataSize);
-    void bindVAO(GLuint &shapeVBO, GLuint &shapeVAO, std::vector<float> &shapeData);
-    void bindVBO(GLuint &shapeVBO, std::vector<float> shapeData);
+    GLuint getPrimitiveVAO(PrimitiveType type, const MeshBuffers *mesh, int &vertexDataSize, int &indexCount);
+    void bindVAO(GLuint &shapeVBO, GLuint &shapeVAO);
+    void setVertexFormat(GLuint &shapeVBO, GLuint &shapeVAO, bool packed);
+    void updateShapeVBO(GLuint &shapeVBO, GLuint &shapeEBO, GLuint &shapeVAO, const MeshData &mesh);
+    void bindEBO(GLuint &shapeEBO, GLuint &shapeVAO);
+    void bindVBO(GLuint &shapeVBO, const void *shapeData, GLsizeiptr size);
     void updateCameraSettings(float near, float far, int width, int height, RenderData &renderData);
 
-    bool glewInitialized = false;
-
-    // shape data
-    Sphere sphere;
-    Cube cube;
-    Cone cone;
-    Cylinder cylinder;
+    // on-demand rendering: the tick timer only runs while the camera is moving or continuous mode is on
+    void startTickTimer();
+    void stopTickTimer();
+    bool isCameraMoving();
+    void advanceFrame();
 
+    bool glewInitialized = false;
 
     // lighting variables
     float ka;
     float kd;
     float ks;
-    float shininess;
-
-    glm::vec4 shape_a;
-    glm::vec4 shape_d;
-    glm::vec4 shape_s;
 
     glm::vec3 lightPositions[8];
     glm::vec3 lightColors[8];
 
     glm::vec4 world_camera_pos;
 
-    void bindMaterialCoeff(RenderShapeData &currShape);
+    MaterialBuffer m_materials;                         // m_store.materials on the GPU
+    void uploadMaterials();
+    void drawShapes(GLuint shader, bool materials, bool lighting);
+
+    // deferred shading: shapes write their surfaces into the G-buffer, then each light shades
+    // only the pixels it reaches, a fullscreen pass for global lights and a sphere volume for the rest
+    ShaderVariants m_gbuffer_variants{":/resources/shaders/default.vert", {":/resources/shaders/gbuffer.frag"}};
+    ShaderVariants m_deferred_variants{":/resources/shaders/deferred.vert",
+                                       {":/resources/shaders/deferred.frag", ":/resources/shaders/lighting.frag"}};
+    GLuint m_deferred_shader = 0;                       // permutation for the current lights
+    GLuint m_gbuffer_fbo;
+    GLuint m_gbuffer_textures[Filter::GBUFFER_TARGETS];
+
+    GLuint m_volume_vbo;
+    GLuint m_volume_ebo;
+    GLuint m_volume_vao;
+    int m_volumeIndexCount = 0;
+    float m_volumeScale = 1.f;                          // makes the tesselated unit sphere contain the true sphere
+
+    void initializeLightVolume();
+    void paintDeferredLights();
+
+    // random point lights appended to the scene's lights, see settings.benchmarkLights
+    int m_sceneLightCount = 0;                          // lights in renderData.lights that came from the scene file
+    int m_benchmarkLightCount = 0;
+    void updateBenchmarkLights();
 
     void initializeFBO();
     void paintTexture(GLuint texture);
     void deleteFBOs();
 
-    bool perpixelOn; // controls if perpixel filter is turned on or off
-    bool kernelFilterOn; // controls if kernel filter is turned on or off
-    bool isGrayScale;
-    bool isSharpen;
+    bool perpixelOn = false; // controls if perpixel filter is turned on or off
+    bool kernelFilterOn = false; // controls if kernel filter is turned on or off
+    bool isGrayScale = false;
+    bool isSharpen = false;
 
     void adjustFilterSettings();
 
     //FBO & FILTER
-    GLuint m_invert_shader;
-    GLuint m_kernel_shader;
+    // one permutation per FILTER_MODE, so the filters don't branch on which filter is on
+    ShaderVariants m_invert_variants{":/resources/shaders/perpixelfilter.vert", {":/resources/shaders/perpixelfilter.frag"}};
+    ShaderVariants m_kernel_variants{":/resources/shaders/perpixelfilter.vert", {":/resources/shaders/kernelfilter.frag"}};
 
     GLuint m_fbo;
     GLuint m_fbo_texture;
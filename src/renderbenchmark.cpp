@@ -0,0 +1,78 @@
+#include "renderbenchmark.h"
+#include <iomanip>
+#include <iostream>
+
+/**
+ * @brief Creates the queries, to be called once the GL context exists
+ */
+void RenderBenchmark::initialize(){
+    glGenQueries(QUERY_COUNT, m_queries);
+}
+
+void RenderBenchmark::destroy(){
+    glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+/**
+ * @brief Collects the results the GPU has finished, oldest first, as results arrive in order
+ */
+void RenderBenchmark::readResults(){
+    while (m_inFlight > 0){
+        int query = (m_next - m_inFlight + QUERY_COUNT) % QUERY_COUNT;
+
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available != GL_TRUE){
+            return;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &nanoseconds);
+        Timing &timing = m_timings[m_labels[query]];
+        timing.frames++;
+        timing.milliseconds += nanoseconds / 1e6;
+        m_inFlight--;
+    }
+}
+
+/**
+ * @brief Starts timing this frame's rendering under label, if a query is free
+ */
+void RenderBenchmark::beginFrame(const std::string &label){
+    readResults();
+
+    m_timing = m_inFlight < QUERY_COUNT;
+    if (m_timing){
+        m_labels[m_next] = label;
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    }
+}
+
+void RenderBenchmark::endFrame(){
+    if (m_timing){
+        glEndQuery(GL_TIME_ELAPSED);
+        m_next = (m_next + 1) % QUERY_COUNT;
+        m_inFlight++;
+        m_timing = false;
+    }
+}
+
+void RenderBenchmark::printStats() const {
+    if (m_timings.empty()){
+        return;
+    }
+
+    std::cout << "GPU render time per frame:" << std::endl;
+    for (const auto &[label, timing] : m_timings){
+        std::cout << "  " << std::left << std::setw(32) << label << std::right << std::fixed << std::setprecision(3)
+                  << timing.milliseconds/timing.frames << " ms over " << timing.frames << " frames" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+/**
+ * @brief Clears the timings of every label
+ */
+void RenderBenchmark::resetStats(){
+    m_timings.clear();
+}
@@ -0,0 +1,46 @@
+#ifndef RENDERBENCHMARK_H
+#define RENDERBENCHMARK_H
+
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <map>
+#include <string>
+
+
+// Times how long the GPU spends rendering the scene with GL_TIME_ELAPSED queries, grouped by a label naming
+// the configuration (e.g. forward or deferred shading and the light count). Queries are read frames later,
+// once the GPU has them, so timing never stalls the pipeline; frames without a free query aren't timed.
+class RenderBenchmark
+{
+public:
+    void initialize();
+    void destroy();
+
+    void beginFrame(const std::string &label);
+    void endFrame();
+
+    void printStats() const;
+    void resetStats();
+
+private:
+    void readResults();
+
+    static constexpr int QUERY_COUNT = 4;               // frames in flight that can be timed at once
+
+    GLuint m_queries[QUERY_COUNT] = {};
+    std::string m_labels[QUERY_COUNT];
+    int m_next = 0;                                     // query the next timed frame uses, queries are used in turn
+    int m_inFlight = 0;                                 // queries before m_next whose results have not been read yet
+    bool m_timing = false;                              // whether the current frame is being timed
+
+    // stats per label
+    struct Timing {
+        long frames = 0;
+        double milliseconds = 0.0;
+    };
+    std::map<std::string, Timing> m_timings;
+};
+
+#endif // RENDERBENCHMARK_H
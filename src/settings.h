@@ -15,6 +15,14 @@ struct Settings {
     bool extraCredit2 = false;
     bool extraCredit3 = false;
     bool extraCredit4 = false;
+    bool continuousRender = false; // repaints every tick even when idle (for benchmarking)
+    int maxFrameRate = 60;         // paint rate cap while moving, 0 paints at the display refresh rate
+    bool depthPrepass = false;     // lays down depth first so every visible pixel is shaded once
+    bool packedVertices = false;   // stores primitive vertices as 16 bit positions and 10 bit normals, half the size of floats
+    bool deferredShading = false;  // shades lights over a G-buffer instead of per fragment of every shape
+    int benchmarkLights = 0;       // random point lights added to the scene, for comparing forward and deferred shading
+    bool shaderHotReload = false;  // reads shaders from the source tree and recompiles them when they are saved
+    bool cpuBenchmarks = false;    // times the CPU side against its unoptimized paths and prints the results, see Realtime::runCpuBenchmarks
 };
 
 
@@ -1,34 +1,38 @@
 #include "cube.h"
+#include "utils/parallel.h"
 
 void Cube::updateParams(int param1) {
-    m_vertexData = std::vector<float>();
     m_param1 = param1;
-    setVertexData();
 }
 
-void Cube::makeTile(glm::vec3 topLeft,
+void Cube::makeTile(float *&data,
+                    glm::vec3 topLeft,
                     glm::vec3 topRight,
                     glm::vec3 bottomLeft,
                     glm::vec3 bottomRight,
                     glm::vec3 n) {
     // Task 2: create a tile (i.e. 2 triangles) based on 4 given points.
 
-    insertVec3(m_vertexData, topLeft);
-    insertVec3(m_vertexData, n);
-    insertVec3(m_vertexData, bottomLeft);
-    insertVec3(m_vertexData, n);
-    insertVec3(m_vertexData, bottomRight);
-    insertVec3(m_vertexData, n);
-    insertVec3(m_vertexData, topLeft);
-    insertVec3(m_vertexData, n);
-    insertVec3(m_vertexData, bottomRight);
-    insertVec3(m_vertexData, n);
-    insertVec3(m_vertexData, topRight);
-    insertVec3(m_vertexData, n);
+    insertVec3(data, topLeft);
+    insertVec3(data, n);
+    insertVec3(data, bottomLeft);
+    insertVec3(data, n);
+    insertVec3(data, bottomRight);
+    insertVec3(data, n);
+    insertVec3(data, topLeft);
+    insertVec3(data, n);
+    insertVec3(data, bottomRight);
+    insertVec3(data, n);
+    insertVec3(data, topRight);
+    insertVec3(data, n);
 
 }
 
-void Cube::makeFace(glm::vec3 topLeft,
+/**
+ * @brief Writes one face (m_param1 x m_param1 tiles) starting at data
+ */
+void Cube::makeFace(float *data,
+                    glm::vec3 topLeft,
                     glm::vec3 topRight,
                     glm::vec3 bottomLeft,
                     glm::vec3 bottomRight,
@@ -53,7 +57,7 @@ void Cube::makeFace(glm::vec3 topLeft,
             bottomLeft = topLeft - increment_y;
             bottomRight = topRight - increment_y;
 
-            makeTile(topLeft, topRight, bottomLeft, bottomRight, n);
+            makeTile(data, topLeft, topRight, bottomLeft, bottomRight, n);
 
             topLeft = topLeft + increment_x;
 
@@ -62,73 +66,63 @@ void Cube::makeFace(glm::vec3 topLeft,
 }
 
 
-void Cube::setVertexData() {
-
-    m_vertexData = std::vector<float>();
-
+void Cube::setVertexData(float *data) {
 
     glm::vec3 z(0.0, 0.0, 1.0);
      glm::vec3 y(0.0, 1.0, 0.0);
       glm::vec3 x(1.0, 0.0, 0.0);
 
-//      // z faces
-     makeFace(
-
-              glm::vec3(-0.5f,  0.5f, 0.5f),
-              glm::vec3( 0.5f,  0.5f, 0.5f),
-              glm::vec3(-0.5f, -0.5f, 0.5f),
-                 glm::vec3( 0.5f, -0.5f, 0.5f),
-                 z);
-
-     makeFace(
-
-              glm::vec3(0.5f,  -0.5f, -0.5f),
-              glm::vec3(0.5f, 0.5f, -0.5f),
-              glm::vec3( -0.5f,  -0.5f, -0.5f),
-              glm::vec3(- 0.5f, 0.5f, -0.5f),
-                 -z);
-
-//     // y faces
-     makeFace(glm::vec3(0.5f, 0.5f, -0.5f),
-              glm::vec3(0.5f, 0.5f, 0.5f),
-              glm::vec3(-0.5f,  0.5f, -0.5f),
-              glm::vec3(-0.5f,  0.5f, 0.5f),
-              y);
-
-     makeFace(
-                 glm::vec3(-0.5f, -0.5f, 0.5f),
-                 glm::vec3(0.5f,  -0.5f, 0.5f),
-                 glm::vec3(-0.5f, -0.5f, -0.5f),
-                 glm::vec3(0.5f,  -0.5f, -0.5f),
-                 -y);
-
-//////     // x faces
-     makeFace(glm::vec3(0.5f, -0.5f, 0.5f),
-              glm::vec3(0.5f,  0.5f, 0.5f),
-              glm::vec3(0.5f, -0.5f, -0.5f),
-              glm::vec3(0.5f,  0.5f, -0.5f),
-              x);
-
-     makeFace(glm::vec3(-0.5f, 0.5f, -0.5f),
-              glm::vec3(-0.5f, 0.5f, 0.5f),
-              glm::vec3(-0.5f,  -0.5f, -0.5f),
-              glm::vec3(-0.5f,  -0.5f, 0.5f),
-              -x);
+    // corners (topLeft, topRight, bottomLeft, bottomRight) and normal of each face
+    const glm::vec3 faces[6][5] = {
+        // z faces
+        {glm::vec3(-0.5f,  0.5f, 0.5f), glm::vec3( 0.5f,  0.5f, 0.5f),
+         glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3( 0.5f, -0.5f, 0.5f), z},
+        {glm::vec3(0.5f,  -0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f),
+         glm::vec3( -0.5f,  -0.5f, -0.5f), glm::vec3(- 0.5f, 0.5f, -0.5f), -z},
+
+        // y faces
+        {glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, 0.5f),
+         glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(-0.5f,  0.5f, 0.5f), y},
+        {glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f,  -0.5f, 0.5f),
+         glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f,  -0.5f, -0.5f), -y},
+
+        // x faces
+        {glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f,  0.5f, 0.5f),
+         glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f,  0.5f, -0.5f), x},
+        {glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, 0.5f),
+         glm::vec3(-0.5f,  -0.5f, -0.5f), glm::vec3(-0.5f,  -0.5f, 0.5f), -x},
+    };
+
+    // every face is the same size, so the faces are written into their own slices in parallel
+    int faceSize = m_param1 * m_param1 * 6 * 6;
+
+    Parallel::forEach(6, [&](int i){
+        makeFace(data + i*faceSize,
+                 faces[i][0], faces[i][1], faces[i][2], faces[i][3], faces[i][4]);
+    });
 }
 
-// Inserts a glm::vec3 into a vector of floats.
-// This will come in handy if you want to take advantage of vectors to build your shape!
-void Cube::insertVec3(std::vector<float> &data, glm::vec3 v) {
-    data.push_back(v.x);
-    data.push_back(v.y);
-    data.push_back(v.z);
+// Writes a glm::vec3 at data and advances data past it
+void Cube::insertVec3(float *&data, glm::vec3 v) {
+    data[0] = v.x;
+    data[1] = v.y;
+    data[2] = v.z;
+    data += 3;
+}
+
+/**
+ * @brief Gets the exact number of floats writeVertexData() writes for param1
+ * @return int -- interleaved position/normal floats (6 per vertex)
+ */
+int Cube::getVertexDataSize(int param1){
+    return 6 * param1 * param1 * 6 * 6;
 }
 
 /**
- * @brief Updates param1, which executes cube creation and inserts them into m_vertexData
- * @return std::vector<float> m_vertexData
+ * @brief Updates param1, and writes the cube's vertex data into caller-owned storage
+ * (e.g. a mapped VBO). data must hold getVertexDataSize(param1) floats
  */
-std::vector<float> Cube::getUpdatedCubeData(int param1){
+void Cube::writeVertexData(int param1, std::span<float> data){
     updateParams(param1);
-    return m_vertexData;
+    setVertexData(data.data());
 }
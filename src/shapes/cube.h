@@ -1,7 +1,7 @@
 #ifndef CUBE_H
 #define CUBE_H
 
-#include <vector>
+#include <span>
 #include <glm/glm.hpp>
 
 
@@ -9,24 +9,26 @@ class Cube
 {
 public:
 
-    std::vector<float> getUpdatedCubeData(int param1);
+    static int getVertexDataSize(int param1);
+    void writeVertexData(int param1, std::span<float> data);
 
 private:
     void updateParams(int param1);
-    void insertVec3(std::vector<float> &data, glm::vec3 v);
-    void setVertexData();
-    void makeTile(glm::vec3 topLeft,
+    void insertVec3(float *&data, glm::vec3 v);
+    void setVertexData(float *data);
+    void makeTile(float *&data,
+                  glm::vec3 topLeft,
                   glm::vec3 topRight,
                   glm::vec3 bottomLeft,
                   glm::vec3 bottomRight,
                   glm::vec3 n);
-    void makeFace(glm::vec3 topLeft,
+    void makeFace(float *data,
+                  glm::vec3 topLeft,
                   glm::vec3 topRight,
                   glm::vec3 bottomLeft,
                   glm::vec3 bottomRight,
                   glm::vec3 n);
 
-    std::vector<float> m_vertexData;
     int m_param1;
 };
 #endif // CUBE_H
@@ -0,0 +1,100 @@
+#ifndef LATTICE_H
+#define LATTICE_H
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief sin and cos of count+1 angles, so tesselation looks them up instead of calling
+ * trig functions for every tile corner
+ */
+struct SinCosTable
+{
+    std::vector<float> sin;
+    std::vector<float> cos;
+
+    // angles i*step, the way the shapes step theta from wedge to wedge
+    static SinCosTable multiples(int count, float step) {
+        SinCosTable table(count);
+        for (int i = 0; i <= count; i++) {
+            table.set(i, i*step);
+        }
+        return table;
+    }
+
+    // angles summed one step at a time, the way the shapes step phi from row to row
+    static SinCosTable accumulated(int count, float step) {
+        SinCosTable table(count);
+        float angle = 0.f;
+        for (int i = 0; i <= count; i++) {
+            table.set(i, angle);
+            angle += step;
+        }
+        return table;
+    }
+
+private:
+    explicit SinCosTable(int count) : sin(count + 1), cos(count + 1) {}
+
+    void set(int i, float angle) {
+        sin[i] = std::sin(angle);
+        cos[i] = std::cos(angle);
+    }
+};
+
+/**
+ * @brief A rows x columns grid of interleaved position/normal vertices. Every corner is computed
+ * once, then copied into each tile that shares it
+ */
+class Lattice
+{
+public:
+    Lattice(int rows, int columns) : m_columns(columns), m_vertices(rows*columns*6) {}
+
+    void set(int row, int column, glm::vec3 position, glm::vec3 normal) {
+        float *v = vertex(row, column);
+        v[0] = position.x; v[1] = position.y; v[2] = position.z;
+        v[3] = normal.x;   v[4] = normal.y;   v[5] = normal.z;
+    }
+
+    glm::vec3 getPosition(int row, int column) const {
+        const float *v = vertex(row, column);
+        return glm::vec3(v[0], v[1], v[2]);
+    }
+
+    // Writes a vertex at data and advances data past it
+    void insertVertex(float *&data, int row, int column) const {
+        std::memcpy(data, vertex(row, column), 6*sizeof(float));
+        data += 6;
+    }
+
+    // Writes a vertex's position with a different normal at data and advances data past it
+    void insertVertex(float *&data, int row, int column, glm::vec3 normal) const {
+        std::memcpy(data, vertex(row, column), 3*sizeof(float));
+        data[3] = normal.x; data[4] = normal.y; data[5] = normal.z;
+        data += 6;
+    }
+
+    // Writes the 2 triangles between rows row and row+1, and columns left and right.
+    // Swapping left and right flips the winding
+    void insertTile(float *&data, int row, int left, int right) const {
+        insertVertex(data, row, left);
+        insertVertex(data, row + 1, left);
+        insertVertex(data, row + 1, right);
+
+        insertVertex(data, row, left);
+        insertVertex(data, row + 1, right);
+        insertVertex(data, row, right);
+    }
+
+private:
+    float *vertex(int row, int column) { return m_vertices.data() + (row*m_columns + column)*6; }
+    const float *vertex(int row, int column) const { return m_vertices.data() + (row*m_columns + column)*6; }
+
+    int m_columns;
+    std::vector<float> m_vertices;
+};
+
+#endif // LATTICE_H
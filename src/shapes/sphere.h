@@ -1,31 +1,23 @@
 #ifndef SPHERE_H
 #define SPHERE_H
 
-#include <vector>
+#include <span>
 #include <glm/glm.hpp>
+#include "lattice.h"
 
 class Sphere
 {
 public:
-    void updateParams(int param1, int param2);
-
-    std::vector<float> getUpdatedSphereData(int param1, int param2);
-
-
-
+    static int getVertexDataSize(int param1, int param2);
+    void writeVertexData(int param1, int param2, std::span<float> data);
 
 private:
-    void makeSphere();
-    void insertVec3(std::vector<float> &data, glm::vec3 v);
-    void setVertexData();
-    void makeTile(glm::vec3 topLeft,
-                  glm::vec3 topRight,
-                  glm::vec3 bottomLeft,
-                  glm::vec3 bottomRight);
-    void makeWedge(float currTheta, float nextTheta);
+    static void clampParams(int &param1, int &param2);
+    void updateParams(int param1, int param2);
+    void makeSphere(float *data);
+    void makeWedge(float *data, const Lattice &lattice, int wedge);
 
 
-    std::vector<float> m_vertexData;
     float m_radius = 0.5;
     int m_param1;
     int m_param2;
@@ -0,0 +1,105 @@
+#include "torus.h"
+#include "utils/parallel.h"
+
+void Torus::updateParams(int param1, int param2) {
+    m_param1 = param1;
+    m_param2 = param2;
+}
+
+/**
+ * @brief Writes the m_param1+1 vertices of one ring (a circle around the tube) starting at data.
+ * The first and last vertex overlap so the seam can be indexed like any other edge
+ */
+void Torus::makeRing(float *data, const SinCosTable &phi, float sinTheta, float cosTheta) {
+    for (int j=0; j<=m_param1; j++){
+        glm::vec3 normal(phi.cos[j] * sinTheta, phi.sin[j], phi.cos[j] * cosTheta);
+        glm::vec3 center(m_majorRadius * sinTheta, 0.f, m_majorRadius * cosTheta);
+        glm::vec3 position = center + m_minorRadius * normal;
+
+        data[0] = position.x; data[1] = position.y; data[2] = position.z;
+        data[3] = normal.x;   data[4] = normal.y;   data[5] = normal.z;
+        data += 6;
+    }
+}
+
+/**
+ * @brief Writes the triangles between ring and ring+1 starting at indices.
+ * Consecutive tiles share two vertices, so the post-transform cache gets reused along the strip
+ */
+void Torus::makeRingIndices(unsigned int *indices, int ring) {
+    unsigned int ringSize = m_param1 + 1;
+    unsigned int current = ring * ringSize;
+    unsigned int next = current + ringSize;
+
+    for (unsigned int j=0; j<m_param1; j++){
+        // triangle 1
+        *indices++ = current + j;
+        *indices++ = next + j;
+        *indices++ = next + j + 1;
+
+        // triangle 2
+        *indices++ = current + j;
+        *indices++ = next + j + 1;
+        *indices++ = current + j + 1;
+    }
+}
+
+void Torus::makeTorus(float *data, unsigned int *indices) {
+    float phiStep = glm::radians(360.f / m_param1);
+    float thetaStep = glm::radians(360.f / m_param2);
+    SinCosTable phi = SinCosTable::multiples(m_param1, phiStep);
+    SinCosTable theta = SinCosTable::multiples(m_param2, thetaStep);
+
+    // every ring is the same size, so rings and the triangles between them are written in parallel
+    int ringSize = (m_param1 + 1) * 6;
+    int ringIndexCount = m_param1 * 6;
+
+    Parallel::forEach(m_param2 + 1, [&](int i){
+        makeRing(data + i*ringSize, phi, theta.sin[i], theta.cos[i]);
+        if (i < m_param2){
+            makeRingIndices(indices + i*ringIndexCount, i);
+        }
+    });
+}
+
+/**
+ * @brief Clamps param1 and param2 to make sure torus is always in view
+ */
+void Torus::clampParams(int &param1, int &param2){
+    if (param1 < 3){
+        param1 = 3;
+    }
+
+    if (param2 < 3){
+        param2 = 3;
+    }
+}
+
+/**
+ * @brief Gets the exact number of floats writeVertexData() writes for these params
+ * @return int -- interleaved position/normal floats (6 per vertex)
+ */
+int Torus::getVertexDataSize(int param1, int param2){
+    clampParams(param1, param2);
+    return (param2 + 1) * (param1 + 1) * 6;
+}
+
+/**
+ * @brief Gets the exact number of indices writeVertexData() writes for these params
+ * @return int -- 3 per triangle
+ */
+int Torus::getIndexCount(int param1, int param2){
+    clampParams(param1, param2);
+    return param2 * param1 * 6;
+}
+
+/**
+ * @brief Updates param1 and param2, and writes the torus' vertices and triangle indices into
+ * caller-owned storage (e.g. mapped buffers). data and indices must hold getVertexDataSize() and
+ * getIndexCount() elements
+ */
+void Torus::writeVertexData(int param1, int param2, std::span<float> data, std::span<unsigned int> indices){
+    clampParams(param1, param2);
+    updateParams(param1, param2);
+    makeTorus(data.data(), indices.data());
+}
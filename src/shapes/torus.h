@@ -0,0 +1,28 @@
+#ifndef TORUS_H
+#define TORUS_H
+
+#include <span>
+#include <glm/glm.hpp>
+#include "lattice.h"
+
+class Torus
+{
+public:
+    static int getVertexDataSize(int param1, int param2);
+    static int getIndexCount(int param1, int param2);
+    void writeVertexData(int param1, int param2, std::span<float> data, std::span<unsigned int> indices);
+
+private:
+    static void clampParams(int &param1, int &param2);
+    void updateParams(int param1, int param2);
+    void makeTorus(float *data, unsigned int *indices);
+    void makeRing(float *data, const SinCosTable &phi, float sinTheta, float cosTheta);
+    void makeRingIndices(unsigned int *indices, int ring);
+
+    int m_param1;                       // segments around the tube
+    int m_param2;                       // segments around the ring
+    float m_majorRadius = 0.35;         // center of the ring to center of the tube
+    float m_minorRadius = 0.15;         // radius of the tube, so the torus fits the unit cube like other primitives
+};
+
+#endif // TORUS_H
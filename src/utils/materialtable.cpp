@@ -0,0 +1,40 @@
+#include "materialtable.h"
+
+/**
+ * @brief Serializes every field of material, so equal materials have equal keys
+ */
+std::string MaterialTable::getKey(const SceneMaterial &material){
+    std::string key;
+    auto add = [&key](const void *data, size_t size){
+        key.append(static_cast<const char *>(data), size);
+    };
+    auto addMap = [&](const SceneFileMap &map){
+        add(&map.isUsed, sizeof(map.isUsed));
+        add(&map.repeatU, sizeof(map.repeatU));
+        add(&map.repeatV, sizeof(map.repeatV));
+        size_t length = map.filename.size();
+        add(&length, sizeof(length));
+        key += map.filename;
+    };
+
+    add(&material.cAmbient, sizeof(material.cAmbient));
+    add(&material.cDiffuse, sizeof(material.cDiffuse));
+    add(&material.cSpecular, sizeof(material.cSpecular));
+    add(&material.shininess, sizeof(material.shininess));
+    add(&material.cReflective, sizeof(material.cReflective));
+    add(&material.cTransparent, sizeof(material.cTransparent));
+    add(&material.ior, sizeof(material.ior));
+    add(&material.blend, sizeof(material.blend));
+    add(&material.cEmissive, sizeof(material.cEmissive));
+    addMap(material.textureMap);
+    addMap(material.bumpMap);
+    return key;
+}
+
+uint32_t MaterialTable::intern(const SceneMaterial &material){
+    auto [index, added] = m_indices.try_emplace(getKey(material), uint32_t(m_materials.size()));
+    if (added){
+        m_materials.push_back(material);
+    }
+    return index->second;
+}
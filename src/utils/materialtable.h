@@ -0,0 +1,26 @@
+#pragma once
+
+#include "scenedata.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The distinct materials of a scene, each stored once and referenced by index. Indices stay valid
+// as materials are added, so shapes keep theirs when a reload adds the materials of edited subtrees
+class MaterialTable {
+public:
+    // Returns the index of a material equal to material, adding it if there is none
+    uint32_t intern(const SceneMaterial &material);
+
+    const SceneMaterial &operator[](uint32_t index) const { return m_materials[index]; }
+    const std::vector<SceneMaterial> &getMaterials() const { return m_materials; }
+    size_t size() const { return m_materials.size(); }
+
+private:
+    static std::string getKey(const SceneMaterial &material);
+
+    std::vector<SceneMaterial> m_materials;
+    std::unordered_map<std::string, uint32_t> m_indices;    // by getKey()
+};
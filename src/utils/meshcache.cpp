@@ -0,0 +1,192 @@
+#include "meshcache.h"
+
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+// bump whenever the layout or the vertex/index ordering changes, so old caches get rebuilt
+constexpr uint32_t MESH_CACHE_VERSION = 2;
+constexpr char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'C', 'C', 'H', '\0'};
+
+inline int16_t toSnorm16(float value) {
+    return int16_t(std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+// Maps a unit vector onto the octahedron |x|+|y|+|z| = 1, whose lower half is folded over the upper
+inline glm::vec2 octEncode(glm::vec3 n) {
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.f) {
+        encoded = (1.f - glm::abs(glm::vec2(n.y, n.x))) *
+                  glm::vec2(n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f);
+    }
+    return encoded;
+}
+
+}
+
+std::string MeshCache::getCachePath(const std::string &filepath) {
+    return filepath + ".meshcache";
+}
+
+bool MeshCache::getSourceStamp(const std::string &filepath, SourceStamp &stamp) {
+    std::error_code error;
+    stamp.size = std::filesystem::file_size(filepath, error);
+    if (error) {
+        return false;
+    }
+    stamp.modified = std::filesystem::last_write_time(filepath, error).time_since_epoch().count();
+    return !error;
+}
+
+/**
+ * @brief Points mesh into a cache file's contents after checking they are complete and match the source
+ */
+bool MeshCache::view(const char *data, size_t size, const SourceStamp &stamp, CachedMesh &mesh) {
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        header.sourceSize != stamp.size || header.sourceModified != stamp.modified) {
+        return false;
+    }
+
+    size_t vertexBytes = size_t(header.vertexCount) * sizeof(PackedVertex);
+    size_t indexBytes = size_t(header.indexCount) * sizeof(uint32_t);
+    if (size != sizeof(Header) + vertexBytes + indexBytes) {
+        return false;
+    }
+
+    mesh.positionOffset = glm::vec3(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+    mesh.positionScale = glm::vec3(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+    mesh.vertexCount = header.vertexCount;
+    mesh.indexCount = header.indexCount;
+    mesh.vertices = reinterpret_cast<const PackedVertex *>(data + sizeof(Header));
+    mesh.indices = reinterpret_cast<const uint32_t *>(data + sizeof(Header) + vertexBytes);
+    return true;
+}
+
+/**
+ * @brief Maps an existing cache file, leaving mesh untouched if it is missing or stale
+ */
+bool MeshCache::mapCache(const std::string &cachepath, const SourceStamp &stamp, CachedMesh &mesh) {
+    auto file = std::make_unique<QFile>(QString::fromStdString(cachepath));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(Header))) {
+        return false;
+    }
+
+    const char *data = reinterpret_cast<const char *>(file->map(0, file->size()));
+    if (!data || !view(data, file->size(), stamp, mesh)) {
+        return false;
+    }
+
+    // the mapping lives as long as the file
+    mesh.file = std::move(file);
+    return true;
+}
+
+/**
+ * @brief Encodes an optimized mesh into cache format: quantized positions and octahedral normals
+ */
+void MeshCache::build(const MeshData &source, const SourceStamp &stamp, std::vector<char> &buffer) {
+    size_t vertexCount = source.vertices.size() / 6;
+    glm::vec3 lower(0.f), upper(0.f);
+    if (vertexCount > 0) {
+        lower = upper = glm::vec3(source.vertices[0], source.vertices[1], source.vertices[2]);
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        glm::vec3 position(source.vertices[v*6], source.vertices[v*6 + 1], source.vertices[v*6 + 2]);
+        lower = glm::min(lower, position);
+        upper = glm::max(upper, position);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexCount = uint32_t(vertexCount);
+    header.indexCount = uint32_t(source.indices.size());
+    header.sourceSize = stamp.size;
+    header.sourceModified = stamp.modified;
+    glm::vec3 extent = upper - lower;
+    for (int axis = 0; axis < 3; axis++) {
+        header.positionOffset[axis] = lower[axis];
+        header.positionScale[axis] = extent[axis];
+    }
+
+    buffer.resize(sizeof(Header) + vertexCount*sizeof(PackedVertex) + source.indices.size()*sizeof(uint32_t));
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+
+    PackedVertex *vertices = reinterpret_cast<PackedVertex *>(buffer.data() + sizeof(Header));
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float *sourceVertex = &source.vertices[v*6];
+        PackedVertex &packed = vertices[v];
+        for (int axis = 0; axis < 3; axis++) {
+            float t = extent[axis] > 0.f ? (sourceVertex[axis] - lower[axis]) / extent[axis] : 0.f;
+            packed.position[axis] = uint16_t(std::round(std::clamp(t, 0.f, 1.f) * 65535.f));
+        }
+        packed.padding = 0;
+
+        glm::vec2 normal = octEncode(glm::vec3(sourceVertex[3], sourceVertex[4], sourceVertex[5]));
+        packed.normal[0] = toSnorm16(normal.x);
+        packed.normal[1] = toSnorm16(normal.y);
+    }
+
+    std::memcpy(buffer.data() + sizeof(Header) + vertexCount*sizeof(PackedVertex),
+                source.indices.data(), source.indices.size()*sizeof(uint32_t));
+}
+
+bool MeshCache::load(const std::string &filepath, CachedMesh &mesh, MeshLoadStats *stats, MeshOptimizeStats *optimizeStats) {
+    QElapsedTimer timer;
+    timer.start();
+
+    SourceStamp stamp;
+    if (!getSourceStamp(filepath, stamp)) {
+        std::cerr << "could not open " << filepath << std::endl;
+        return false;
+    }
+
+    std::string cachepath = getCachePath(filepath);
+    if (mapCache(cachepath, stamp, mesh)) {
+        if (stats) {
+            stats->bytes = mesh.file->size();
+            stats->triangles = mesh.indexCount / 3;
+            stats->vertices = mesh.vertexCount;
+            stats->seconds = timer.nsecsElapsed() * 1e-9;
+            stats->cached = true;
+        }
+        return true;
+    }
+
+    MeshData source;
+    if (!MeshLoader::load(filepath, source, stats)) {
+        return false;
+    }
+    MeshOptimizeStats optimized = MeshOptimizer::optimize(source, 6);
+    if (optimizeStats) {
+        *optimizeStats = optimized;
+    }
+    build(source, stamp, mesh.buffer);
+
+    // a failed save (e.g. a read only directory) only means the next load parses the source again
+    QSaveFile file(QString::fromStdString(cachepath));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(mesh.buffer.data(), mesh.buffer.size()) != qint64(mesh.buffer.size()) ||
+        !file.commit()) {
+        std::cerr << "could not write mesh cache " << cachepath << std::endl;
+    }
+
+    if (stats) {
+        stats->seconds = timer.nsecsElapsed() * 1e-9;
+    }
+    return view(mesh.buffer.data(), mesh.buffer.size(), stamp, mesh);
+}
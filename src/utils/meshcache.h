@@ -0,0 +1,75 @@
+#pragma once
+
+#include "meshloader.h"
+#include "meshoptimizer.h"
+
+#include <QFile>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Vertex of a cached mesh, half the size of the float vertices primitives use: the position is
+// quantized to 16 bits per axis within the mesh's bounds, and the normal is octahedral encoded
+struct PackedVertex {
+    uint16_t position[3];
+    uint16_t padding;           // keeps the normal 4 byte aligned
+    int16_t normal[2];
+};
+
+// A mesh in cache format, uploaded to the GPU as is and decoded by the vertex shader
+struct CachedMesh {
+    glm::vec3 positionOffset;   // position = positionOffset + positionScale * (quantized position / 65535)
+    glm::vec3 positionScale;
+    const PackedVertex *vertices = nullptr;
+    const uint32_t *indices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+
+    // owns the data above: the mapped cache file, or the freshly built cache if it couldn't be saved
+    std::unique_ptr<QFile> file;
+    std::vector<char> buffer;
+};
+
+class MeshCache {
+public:
+    // Loads a mesh through its binary cache, stored next to the source as <meshfile>.meshcache.
+    // Caches hold the mesh after MeshOptimizer::optimize(), so it is only optimized once.
+    // A cache that is missing, from another format version, or made from a different version of the
+    // source file (by size and modification time) is rebuilt from the source and saved first.
+    // @param filepath    The path of the OBJ or PLY mesh file.
+    // @param mesh        On return, this will point to the mesh's cached vertices and indices.
+    // @param stats       If not null, on return this will contain the load's size and time, rebuilding the cache included.
+    // @param optimizeStats If not null and the cache was rebuilt, on return this will contain what optimizing did.
+    // @return            A boolean value indicating whether the load was successful.
+    static bool load(const std::string &filepath, CachedMesh &mesh, MeshLoadStats *stats = nullptr,
+                     MeshOptimizeStats *optimizeStats = nullptr);
+
+    static std::string getCachePath(const std::string &filepath);
+
+private:
+    // Identifies one version of a source file
+    struct SourceStamp {
+        uint64_t size = 0;
+        int64_t modified = 0;
+    };
+
+    // Start of a cache file, followed by vertexCount PackedVertex and indexCount uint32_t indices
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t padding;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        float positionOffset[3];
+        float positionScale[3];
+    };
+
+    static bool getSourceStamp(const std::string &filepath, SourceStamp &stamp);
+    static bool mapCache(const std::string &cachepath, const SourceStamp &stamp, CachedMesh &mesh);
+    static bool view(const char *data, size_t size, const SourceStamp &stamp, CachedMesh &mesh);
+    static void build(const MeshData &source, const SourceStamp &stamp, std::vector<char> &buffer);
+};
@@ -0,0 +1,767 @@
+#include "meshloader.h"
+#include "parallel.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t NO_INDEX = ~0u;
+
+/////////////////////////////////////////////////////////////////////////////
+// Text scanning. Mapped files are not null terminated, so everything takes an end pointer
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline void skipSpaces(const char *&p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+}
+
+inline void skipLine(const char *&p, const char *end) {
+    const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    p = newline ? newline + 1 : end;
+}
+
+inline bool parseInt(const char *&p, const char *end, int64_t &value) {
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    int64_t result = 0;
+    const char *digits = p;
+    while (p < end && isDigit(*p)) {
+        result = result*10 + (*p - '0');
+        p++;
+    }
+
+    if (p == digits) {
+        p = start;
+        return false;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// Decimal float parser, much faster than strtof and exact to within float rounding for typical mesh data
+inline bool parseFloat(const char *&p, const char *end, float &value) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    // keeps the first 18 significant digits, later ones only shift the exponent
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && isDigit(*p); p++, digits++) {
+        if (mantissa < 100000000000000000ull) {
+            mantissa = mantissa*10 + (*p - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && isDigit(*p); p++, digits++) {
+            if (mantissa < 100000000000000000ull) {
+                mantissa = mantissa*10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+
+    if (digits == 0) {
+        p = start;
+        return false;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        int64_t power;
+        if (parseInt(e, end, power)) {
+            exponent += int(std::clamp<int64_t>(power, -1000, 1000));
+            p = e;
+        }
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0 && exponent >= -22) {
+        result /= powers[-exponent];
+    } else if (exponent > 0 && exponent <= 22) {
+        result *= powers[exponent];
+    } else if (exponent != 0) {
+        result *= std::pow(10.0, exponent);
+    }
+
+    value = float(negative ? -result : result);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// OBJ
+
+// Face references are stored as global 0-based indices. Negative (relative) references can only be
+// resolved once the number of vertices in earlier chunks is known, so they are stored as the
+// chunk-local index offset by RELATIVE_REF until then
+constexpr int64_t RELATIVE_REF = int64_t(1) << 40;
+constexpr int64_t NO_REF = -1;
+
+struct OBJChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<int64_t> positionRefs;      // 3 per triangle
+    std::vector<int64_t> normalRefs;        // 3 per triangle, NO_REF where the corner has no normal
+    bool missingNormals = false;
+    std::string error;
+};
+
+inline int64_t encodeRef(int64_t ref, size_t localCount) {
+    if (ref > 0) {
+        return ref - 1;
+    }
+    return RELATIVE_REF + int64_t(localCount) + ref;
+}
+
+inline int64_t resolveRef(int64_t ref, size_t chunkOffset) {
+    if (ref >= RELATIVE_REF/2) {
+        return int64_t(chunkOffset) + (ref - RELATIVE_REF);
+    }
+    return ref;
+}
+
+bool parseVec3(const char *&p, const char *end, glm::vec3 &v) {
+    for (int i = 0; i < 3; i++) {
+        skipSpaces(p, end);
+        if (!parseFloat(p, end, v[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parses the lines in [p, end), which starts and ends on line boundaries
+void parseOBJChunk(const char *p, const char *end, OBJChunk &chunk) {
+    std::vector<int64_t> facePositions;
+    std::vector<int64_t> faceNormals;
+
+    while (p < end) {
+        skipSpaces(p, end);
+        if (end - p < 2) {
+            skipLine(p, end);
+            continue;
+        }
+
+        bool separated = p[1] == ' ' || p[1] == '\t';
+        if (p[0] == 'v' && separated) {
+            p += 2;
+            glm::vec3 position;
+            if (!parseVec3(p, end, position)) {
+                chunk.error = "bad vertex position";
+                return;
+            }
+            chunk.positions.push_back(position);
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            p += 2;
+            glm::vec3 normal;
+            if (!parseVec3(p, end, normal)) {
+                chunk.error = "bad vertex normal";
+                return;
+            }
+            chunk.normals.push_back(normal);
+        } else if (p[0] == 'f' && separated) {
+            p += 2;
+            facePositions.clear();
+            faceNormals.clear();
+
+            // each corner is v, v/vt, v//vn or v/vt/vn
+            while (true) {
+                skipSpaces(p, end);
+                if (p >= end || *p == '\n' || *p == '#') {
+                    break;
+                }
+
+                int64_t position, texture, normal;
+                if (!parseInt(p, end, position) || position == 0) {
+                    chunk.error = "bad face";
+                    return;
+                }
+                facePositions.push_back(encodeRef(position, chunk.positions.size()));
+
+                int64_t normalRef = NO_REF;
+                if (p < end && *p == '/') {
+                    p++;
+                    parseInt(p, end, texture);
+                    if (p < end && *p == '/') {
+                        p++;
+                        if (parseInt(p, end, normal) && normal != 0) {
+                            normalRef = encodeRef(normal, chunk.normals.size());
+                        }
+                    }
+                }
+                faceNormals.push_back(normalRef);
+                chunk.missingNormals |= normalRef == NO_REF;
+
+                // skips anything unexpected after the corner
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+                    p++;
+                }
+            }
+
+            // polygons are split into a fan of triangles
+            for (size_t i = 1; i + 1 < facePositions.size(); i++) {
+                for (size_t corner : {size_t(0), i, i + 1}) {
+                    chunk.positionRefs.push_back(facePositions[corner]);
+                    chunk.normalRefs.push_back(faceNormals[corner]);
+                }
+            }
+        }
+
+        skipLine(p, end);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// PLY
+
+enum class PLYType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+struct PLYProperty {
+    std::string name;
+    PLYType type = PLYType::Invalid;
+    PLYType countType = PLYType::Invalid;   // only for lists
+    bool isList = false;
+};
+
+struct PLYElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PLYProperty> properties;
+};
+
+PLYType parsePLYType(const std::string &name) {
+    if (name == "char" || name == "int8") return PLYType::Int8;
+    if (name == "uchar" || name == "uint8") return PLYType::UInt8;
+    if (name == "short" || name == "int16") return PLYType::Int16;
+    if (name == "ushort" || name == "uint16") return PLYType::UInt16;
+    if (name == "int" || name == "int32") return PLYType::Int32;
+    if (name == "uint" || name == "uint32") return PLYType::UInt32;
+    if (name == "float" || name == "float32") return PLYType::Float32;
+    if (name == "double" || name == "float64") return PLYType::Float64;
+    return PLYType::Invalid;
+}
+
+int plyTypeSize(PLYType type) {
+    switch (type) {
+        case PLYType::Int8: case PLYType::UInt8: return 1;
+        case PLYType::Int16: case PLYType::UInt16: return 2;
+        case PLYType::Int32: case PLYType::UInt32: case PLYType::Float32: return 4;
+        case PLYType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+template <typename T>
+inline T readRaw(const char *p, bool swap) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+inline double readPLYValue(const char *p, PLYType type, bool swap) {
+    switch (type) {
+        case PLYType::Int8: return readRaw<int8_t>(p, swap);
+        case PLYType::UInt8: return readRaw<uint8_t>(p, swap);
+        case PLYType::Int16: return readRaw<int16_t>(p, swap);
+        case PLYType::UInt16: return readRaw<uint16_t>(p, swap);
+        case PLYType::Int32: return readRaw<int32_t>(p, swap);
+        case PLYType::UInt32: return readRaw<uint32_t>(p, swap);
+        case PLYType::Float32: return readRaw<float>(p, swap);
+        case PLYType::Float64: return readRaw<double>(p, swap);
+        default: return 0;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Welding
+
+inline uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 31;
+    hash *= 0x7FB5D329728EA185ull;
+    hash ^= hash >> 27;
+    hash *= 0x81DADEF4BC2DD44Dull;
+    return hash ^ (hash >> 33);
+}
+
+// Open addressing table of ids, which is far faster than std::unordered_map for millions of vertices.
+// Keys live outside the table, equals(id) tells whether a stored id has the key being looked up
+class IdTable {
+public:
+    explicit IdTable(size_t count) {
+        size_t capacity = 16;
+        while (capacity < count*2) {
+            capacity *= 2;
+        }
+        m_slots.assign(capacity, NO_INDEX);
+    }
+
+    // Returns the id stored for the key, storing id if the key is new
+    template <typename Equals>
+    uint32_t findOrInsert(uint64_t hash, uint32_t id, Equals &&equals) {
+        size_t mask = m_slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            if (m_slots[slot] == NO_INDEX) {
+                m_slots[slot] = id;
+                return id;
+            }
+            if (equals(m_slots[slot])) {
+                return m_slots[slot];
+            }
+        }
+    }
+
+private:
+    std::vector<uint32_t> m_slots;
+};
+
+}
+
+/**
+ * @brief Parses an OBJ file. The file is split into chunks on line boundaries which are parsed in
+ *        parallel, then stitched together once every chunk's vertex counts are known
+ */
+bool MeshLoader::parseOBJ(const char *data, size_t size, RawMesh &raw) {
+    const char *end = data + size;
+    int chunkCount = int(std::clamp<size_t>(size >> 20, 1, 1024));
+
+    // chunk boundaries are moved forward to the start of the next line
+    std::vector<const char *> bounds(chunkCount + 1);
+    bounds[0] = data;
+    bounds[chunkCount] = end;
+    for (int i = 1; i < chunkCount; i++) {
+        const char *p = std::max(data + size*i/chunkCount, bounds[i - 1]);
+        if (p > data && p[-1] != '\n') {
+            skipLine(p, end);
+        }
+        bounds[i] = p;
+    }
+
+    std::vector<OBJChunk> chunks(chunkCount);
+    Parallel::forEach(chunkCount, [&](int i){
+        parseOBJChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    size_t positionCount = 0, normalCount = 0, cornerCount = 0;
+    std::vector<size_t> positionOffsets(chunkCount), normalOffsets(chunkCount), cornerOffsets(chunkCount);
+    bool missingNormals = false;
+    for (int i = 0; i < chunkCount; i++) {
+        if (!chunks[i].error.empty()) {
+            std::cerr << chunks[i].error << std::endl;
+            return false;
+        }
+        positionOffsets[i] = positionCount;
+        normalOffsets[i] = normalCount;
+        cornerOffsets[i] = cornerCount;
+        positionCount += chunks[i].positions.size();
+        normalCount += chunks[i].normals.size();
+        cornerCount += chunks[i].positionRefs.size();
+        missingNormals |= chunks[i].missingNormals;
+    }
+
+    raw.positions.resize(positionCount);
+    raw.normals.resize(normalCount);
+    raw.positionIndices.resize(cornerCount);
+    raw.normalIndices.resize(missingNormals ? 0 : cornerCount);
+
+    std::atomic<bool> outOfRange = false;
+    Parallel::forEach(chunkCount, [&](int i){
+        const OBJChunk &chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), raw.positions.begin() + positionOffsets[i]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), raw.normals.begin() + normalOffsets[i]);
+
+        for (size_t j = 0; j < chunk.positionRefs.size(); j++) {
+            int64_t position = resolveRef(chunk.positionRefs[j], positionOffsets[i]);
+            if (position < 0 || position >= int64_t(positionCount)) {
+                outOfRange = true;
+                return;
+            }
+            raw.positionIndices[cornerOffsets[i] + j] = uint32_t(position);
+
+            if (!missingNormals) {
+                int64_t normal = resolveRef(chunk.normalRefs[j], normalOffsets[i]);
+                if (normal < 0 || normal >= int64_t(normalCount)) {
+                    outOfRange = true;
+                    return;
+                }
+                raw.normalIndices[cornerOffsets[i] + j] = uint32_t(normal);
+            }
+        }
+    });
+
+    if (outOfRange) {
+        std::cerr << "face references a missing vertex" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a binary PLY file. Vertices have a fixed size, so they are read in parallel.
+ *        Faces are variable length lists and are walked in order
+ */
+bool MeshLoader::parsePLY(const char *data, size_t size, RawMesh &raw) {
+    const char *end = data + size;
+
+    // the header is text, terminated by an end_header line
+    const char *body = nullptr;
+    for (const char *p = data; p < end; skipLine(p, end)) {
+        if (end - p >= 10 && std::memcmp(p, "end_header", 10) == 0) {
+            skipLine(p, end);
+            body = p;
+            break;
+        }
+    }
+    if (!body) {
+        std::cerr << "missing PLY end_header" << std::endl;
+        return false;
+    }
+
+    std::istringstream header(std::string(data, body));
+    std::string line;
+    std::getline(header, line);
+    if (line.rfind("ply", 0) != 0) {
+        std::cerr << "not a PLY file" << std::endl;
+        return false;
+    }
+
+    bool swap = false;
+    std::vector<PLYElement> elements;
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            bool bigEndian = format == "binary_big_endian";
+            if (!bigEndian && format != "binary_little_endian") {
+                std::cerr << "unsupported PLY format " << format << ", only binary PLY is supported" << std::endl;
+                return false;
+            }
+            uint16_t probe = 1;
+            bool hostBigEndian = *reinterpret_cast<uint8_t *>(&probe) == 0;
+            swap = bigEndian != hostBigEndian;
+        } else if (keyword == "element") {
+            PLYElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            PLYProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.isList = true;
+                property.countType = parsePLYType(countType);
+                type = itemType;
+            }
+            property.type = parsePLYType(type);
+            words >> property.name;
+            if (property.type == PLYType::Invalid || (property.isList && property.countType == PLYType::Invalid)) {
+                std::cerr << "unsupported PLY property: " << line << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    const char *p = body;
+    size_t vertexCount = 0;
+    bool hasVertices = false;
+    for (const PLYElement &element : elements) {
+        bool fixedSize = std::none_of(element.properties.begin(), element.properties.end(),
+                                      [](const PLYProperty &property){ return property.isList; });
+
+        // byte offsets of fixed size properties within one element
+        size_t stride = 0;
+        std::unordered_map<std::string, std::pair<size_t, PLYType>> offsets;
+        for (const PLYProperty &property : element.properties) {
+            offsets[property.name] = {stride, property.type};
+            stride += plyTypeSize(property.type);
+        }
+
+        if (element.name == "vertex") {
+            if (!fixedSize || !offsets.count("x") || !offsets.count("y") || !offsets.count("z")) {
+                std::cerr << "PLY vertices need x, y and z and no lists" << std::endl;
+                return false;
+            }
+            if (size_t(end - p) / std::max<size_t>(stride, 1) < element.count) {
+                std::cerr << "truncated PLY vertex data" << std::endl;
+                return false;
+            }
+
+            const char *names[] = {"x", "y", "z", "nx", "ny", "nz"};
+            bool hasNormals = offsets.count("nx") && offsets.count("ny") && offsets.count("nz");
+            std::pair<size_t, PLYType> fields[6];
+            for (int i = 0; i < (hasNormals ? 6 : 3); i++) {
+                fields[i] = offsets[names[i]];
+            }
+
+            vertexCount = element.count;
+            hasVertices = true;
+            raw.positions.resize(vertexCount);
+            raw.normals.resize(hasNormals ? vertexCount : 0);
+
+            const int blockSize = 1 << 16;
+            int blocks = int((vertexCount + blockSize - 1) / blockSize);
+            const char *vertices = p;
+            Parallel::forEach(blocks, [&](int block){
+                size_t last = std::min(vertexCount, size_t(block + 1)*blockSize);
+                for (size_t i = size_t(block)*blockSize; i < last; i++) {
+                    const char *v = vertices + i*stride;
+                    for (int axis = 0; axis < 3; axis++) {
+                        raw.positions[i][axis] = float(readPLYValue(v + fields[axis].first, fields[axis].second, swap));
+                        if (hasNormals) {
+                            raw.normals[i][axis] = float(readPLYValue(v + fields[axis + 3].first, fields[axis + 3].second, swap));
+                        }
+                    }
+                }
+            });
+            p += vertexCount*stride;
+        } else if (element.name == "face") {
+            if (!hasVertices) {
+                std::cerr << "PLY faces must come after vertices" << std::endl;
+                return false;
+            }
+
+            // every face takes at least a byte, which bounds what a corrupt count can reserve
+            raw.positionIndices.reserve(std::min<size_t>(element.count, end - p)*3);
+            std::vector<uint32_t> face;
+            for (size_t i = 0; i < element.count; i++) {
+                for (const PLYProperty &property : element.properties) {
+                    int itemSize = plyTypeSize(property.type);
+                    if (!property.isList) {
+                        if (end - p < itemSize) {
+                            std::cerr << "truncated PLY face data" << std::endl;
+                            return false;
+                        }
+                        p += itemSize;
+                        continue;
+                    }
+
+                    int countSize = plyTypeSize(property.countType);
+                    if (end - p < countSize) {
+                        std::cerr << "truncated PLY face data" << std::endl;
+                        return false;
+                    }
+                    // negative or fractional counts from signed or float count types are rejected too
+                    double listCount = readPLYValue(p, property.countType, swap);
+                    p += countSize;
+                    if (!(listCount >= 0) || listCount != std::floor(listCount) || listCount > double((end - p) / itemSize)) {
+                        std::cerr << "bad or truncated PLY face list" << std::endl;
+                        return false;
+                    }
+                    size_t count = size_t(listCount);
+
+                    if (property.name == "vertex_indices" || property.name == "vertex_index") {
+                        face.resize(count);
+                        for (size_t j = 0; j < count; j++) {
+                            double index = readPLYValue(p + j*itemSize, property.type, swap);
+                            if (index < 0 || index >= double(vertexCount)) {
+                                std::cerr << "face references a missing vertex" << std::endl;
+                                return false;
+                            }
+                            face[j] = uint32_t(index);
+                        }
+
+                        // polygons are split into a fan of triangles
+                        for (size_t j = 1; j + 1 < count; j++) {
+                            raw.positionIndices.push_back(face[0]);
+                            raw.positionIndices.push_back(face[j]);
+                            raw.positionIndices.push_back(face[j + 1]);
+                        }
+                    }
+                    p += count*itemSize;
+                }
+            }
+        } else if (fixedSize) {
+            p += std::min<size_t>(element.count, size_t(end - p) / std::max<size_t>(stride, 1))*stride;
+        } else {
+            std::cerr << "unsupported PLY element " << element.name << std::endl;
+            return false;
+        }
+    }
+
+    // PLY normals belong to the vertices, so they share the position indices
+    if (!raw.normals.empty()) {
+        raw.normalIndices = raw.positionIndices;
+    }
+    return true;
+}
+
+/**
+ * @brief Merges vertices with identical positions (and normals, if the file has them) and builds
+ *        the indexed mesh. Without normals, smooth area weighted normals are generated
+ */
+void MeshLoader::weld(RawMesh &raw, MeshData &mesh) {
+    // positions are compared bitwise, with -0 folded into 0
+    std::vector<std::array<uint32_t, 3>> keys(raw.positions.size());
+    for (size_t i = 0; i < raw.positions.size(); i++) {
+        glm::vec3 position = raw.positions[i] + glm::vec3(0.f);
+        std::memcpy(keys[i].data(), &position[0], sizeof(keys[i]));
+    }
+
+    std::vector<uint32_t> canonical(raw.positions.size());
+    IdTable unique(raw.positions.size());
+    for (size_t i = 0; i < raw.positions.size(); i++) {
+        const std::array<uint32_t, 3> &key = keys[i];
+        uint64_t hash = mixHash((uint64_t(key[0]) << 32 | key[1]) ^ mixHash(key[2]));
+        canonical[i] = unique.findOrInsert(hash, uint32_t(i), [&](uint32_t other){ return keys[other] == key; });
+    }
+
+    size_t cornerCount = raw.positionIndices.size();
+    mesh.indices.resize(cornerCount);
+    mesh.vertices.clear();
+
+    auto insertVertex = [&](glm::vec3 position, glm::vec3 normal){
+        mesh.vertices.insert(mesh.vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z});
+    };
+
+    if (!raw.normalIndices.empty()) {
+        // every distinct position/normal pair becomes one vertex, numbered in order of first use
+        std::vector<uint64_t> vertexKeys;
+        IdTable vertexIds(cornerCount);
+        for (size_t i = 0; i < cornerCount; i++) {
+            uint32_t position = canonical[raw.positionIndices[i]];
+            uint64_t key = (uint64_t(position) << 32) | raw.normalIndices[i];
+            uint32_t id = vertexIds.findOrInsert(mixHash(key), uint32_t(vertexKeys.size()),
+                                                 [&](uint32_t other){ return vertexKeys[other] == key; });
+            if (id == vertexKeys.size()) {
+                vertexKeys.push_back(key);
+                glm::vec3 normal = raw.normals[raw.normalIndices[i]];
+                float length = glm::length(normal);
+                insertVertex(raw.positions[position], length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f));
+            }
+            mesh.indices[i] = id;
+        }
+        return;
+    }
+
+    // every distinct position becomes one vertex, numbered in order of first use
+    std::vector<uint32_t> vertexIds(raw.positions.size(), NO_INDEX);
+    std::vector<uint32_t> sources;
+    for (size_t i = 0; i < cornerCount; i++) {
+        uint32_t position = canonical[raw.positionIndices[i]];
+        if (vertexIds[position] == NO_INDEX) {
+            vertexIds[position] = uint32_t(sources.size());
+            sources.push_back(position);
+        }
+        mesh.indices[i] = vertexIds[position];
+    }
+
+    // the cross product's length is twice the triangle's area, so bigger triangles weigh more
+    std::vector<glm::vec3> normals(sources.size(), glm::vec3(0.f));
+    for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+        uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+        glm::vec3 pa = raw.positions[sources[a]];
+        glm::vec3 faceNormal = glm::cross(raw.positions[sources[b]] - pa, raw.positions[sources[c]] - pa);
+        normals[a] += faceNormal;
+        normals[b] += faceNormal;
+        normals[c] += faceNormal;
+    }
+
+    mesh.vertices.resize(sources.size()*6);
+    Parallel::forEach(int((sources.size() + 65535) / 65536), [&](int block){
+        size_t last = std::min(sources.size(), size_t(block + 1)*65536);
+        for (size_t i = size_t(block)*65536; i < last; i++) {
+            glm::vec3 position = raw.positions[sources[i]];
+            float length = glm::length(normals[i]);
+            glm::vec3 normal = length > 0.f ? normals[i] / length : glm::vec3(0.f, 1.f, 0.f);
+
+            float *v = &mesh.vertices[i*6];
+            v[0] = position.x; v[1] = position.y; v[2] = position.z;
+            v[3] = normal.x;   v[4] = normal.y;   v[5] = normal.z;
+        }
+    });
+}
+
+bool MeshLoader::load(const std::string &filepath, MeshData &mesh, MeshLoadStats *stats) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(filepath.c_str());
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "could not open " << filepath << std::endl;
+        return false;
+    }
+
+    qint64 size = file.size();
+    auto *mapping = size > 0 ? file.map(0, size) : nullptr;
+    const char *data = reinterpret_cast<const char *>(mapping);
+    if (!data) {
+        std::cerr << "could not map " << filepath << std::endl;
+        return false;
+    }
+
+    std::string extension = std::filesystem::path(filepath).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    RawMesh raw;
+    bool parsed = false;
+    if (extension == ".obj") {
+        parsed = parseOBJ(data, size, raw);
+    } else if (extension == ".ply") {
+        parsed = parsePLY(data, size, raw);
+    } else {
+        std::cerr << "unsupported mesh format " << extension << std::endl;
+    }
+    file.unmap(mapping);
+
+    if (!parsed) {
+        std::cerr << "could not load mesh " << filepath << std::endl;
+        return false;
+    }
+
+    weld(raw, mesh);
+
+    if (stats) {
+        stats->bytes = size;
+        stats->triangles = mesh.indices.size() / 3;
+        stats->vertices = mesh.vertices.size() / 6;
+        stats->seconds = timer.nsecsElapsed() * 1e-9;
+        stats->cached = false;
+    }
+    return true;
+}
+
+void MeshLoader::printStats(const std::string &filepath, const MeshLoadStats &stats) {
+    double seconds = std::max(stats.seconds, 1e-9);
+    std::cout << "Loaded " << filepath << (stats.cached ? " from its cache: " : ": ") << stats.triangles
+              << " triangles, " << stats.vertices << " vertices in " << stats.seconds * 1e3 << " ms ("
+              << stats.bytes * 1e-6 / seconds << " MB/s, " << stats.triangles * 1e-6 / seconds << " Mtris/s)" << std::endl;
+}
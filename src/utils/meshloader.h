@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Triangle mesh ready for upload: interleaved position/normal vertices (6 floats each) and triangle indices
+struct MeshData {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// What one mesh load read and produced, and how long it took
+struct MeshLoadStats {
+    size_t bytes = 0;           // size of the file read
+    size_t triangles = 0;
+    size_t vertices = 0;
+    double seconds = 0.0;
+    bool cached = false;        // read from a MeshCache file instead of parsed from the source
+};
+
+class MeshLoader {
+public:
+    // Loads a triangle mesh from an OBJ or binary PLY file, picked by the file extension.
+    // The file is memory mapped and parsed in parallel, identical vertices are welded,
+    // and smooth normals are generated if the file has none.
+    // @param filepath    The path of the mesh file to load.
+    // @param mesh        On return, this will contain the welded, indexed mesh.
+    // @param stats       If not null, on return this will contain the load's size and time.
+    // @return            A boolean value indicating whether the load was successful.
+    static bool load(const std::string &filepath, MeshData &mesh, MeshLoadStats *stats = nullptr);
+
+    // Prints a load's throughput, for comparing mesh loading
+    static void printStats(const std::string &filepath, const MeshLoadStats &stats);
+
+private:
+    // Unwelded triangles as parsed: every triangle corner indexes a position and optionally a normal
+    struct RawMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<uint32_t> positionIndices;  // 3 per triangle
+        std::vector<uint32_t> normalIndices;    // 3 per triangle, or empty if any corner has no normal
+    };
+
+    static bool parseOBJ(const char *data, size_t size, RawMesh &raw);
+    static bool parsePLY(const char *data, size_t size, RawMesh &raw);
+    static void weld(RawMesh &raw, MeshData &mesh);
+};
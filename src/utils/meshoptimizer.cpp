@@ -0,0 +1,341 @@
+#include "meshoptimizer.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+
+namespace {
+
+// Post-transform cache that evicts the least recently transformed vertex, the model ACMR is usually quoted for
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, int size) : m_stamps(vertexCount, 0), m_time(size + 1), m_size(size) {}
+
+    // Returns whether v had to be transformed
+    bool access(unsigned int v) {
+        if (m_time - m_stamps[v] > unsigned(m_size)) {
+            m_stamps[v] = m_time++;
+            return true;
+        }
+        return false;
+    }
+
+    // Evicts every vertex, as if drawing continued from an unrelated part of the mesh
+    void flush() {
+        m_time += m_size + 1;
+    }
+
+private:
+    std::vector<unsigned int> m_stamps;
+    unsigned int m_time;
+    int m_size;
+};
+
+// fewer clusters than this leave too little to reorder for the cache misses their splits cost
+constexpr size_t MIN_OVERDRAW_CLUSTERS = 8;
+
+inline uint64_t hashVertex(const float *vertex, int vertexSize) {
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < vertexSize; i++) {
+        uint32_t bits;
+        std::memcpy(&bits, &vertex[i], sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    }
+    return hash ^ (hash >> 29);
+}
+
+inline glm::vec3 getPosition(const std::vector<float> &vertices, unsigned int v, int vertexSize) {
+    const float *position = &vertices[size_t(v)*vertexSize];
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+}
+
+MeshOptimizeStats MeshOptimizer::optimize(MeshData &mesh, int vertexSize) {
+    QElapsedTimer timer;
+    timer.start();
+
+    MeshOptimizeStats stats;
+    size_t vertexCount = mesh.vertices.size() / vertexSize;
+    stats.before = analyzeVertexCache(mesh.indices, vertexCount);
+
+    // Tipsify and the overdraw pass can both lose to an already cache friendly order, e.g. the shapes'
+    // small strips, so each result is only kept if it doesn't raise the ACMR of the original order
+    std::vector<unsigned int> best = mesh.indices;
+    optimizeVertexCache(mesh.indices, vertexCount);
+    if (analyzeVertexCache(mesh.indices, vertexCount).acmr > stats.before.acmr) {
+        mesh.indices = best;
+    } else {
+        best = mesh.indices;
+    }
+    optimizeOverdraw(mesh.indices, mesh.vertices, vertexSize);
+    if (analyzeVertexCache(mesh.indices, vertexCount).acmr > stats.before.acmr) {
+        mesh.indices.swap(best);
+    }
+
+    // renumbering vertices doesn't change which ones the cache holds
+    optimizeVertexFetch(mesh.indices, mesh.vertices, vertexSize);
+    stats.after = analyzeVertexCache(mesh.indices, mesh.vertices.size() / vertexSize);
+    stats.seconds = timer.nsecsElapsed() * 1e-9;
+    return stats;
+}
+
+void MeshOptimizer::printStats(const std::string &name, const MeshOptimizeStats &stats) {
+    std::cout << "Optimized " << name << " in " << stats.seconds * 1e3 << " ms: ACMR " << stats.before.acmr
+              << " -> " << stats.after.acmr << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+}
+
+void MeshOptimizer::generateIndexBuffer(MeshData &mesh, int vertexSize) {
+    size_t cornerCount = mesh.vertices.size() / vertexSize;
+    mesh.indices.resize(cornerCount);
+
+    // open addressing table of unique vertex ids, at most half full
+    size_t capacity = 16;
+    while (capacity < cornerCount*2) {
+        capacity *= 2;
+    }
+    std::vector<unsigned int> vertexIds(capacity, ~0u);
+    size_t mask = capacity - 1;
+
+    // unique vertices are compacted to the front of the same storage, which they never overtake
+    unsigned int uniqueCount = 0;
+    for (size_t corner = 0; corner < cornerCount; corner++) {
+        const float *vertex = &mesh.vertices[corner*vertexSize];
+        size_t slot = hashVertex(vertex, vertexSize) & mask;
+        while (vertexIds[slot] != ~0u &&
+               std::memcmp(&mesh.vertices[size_t(vertexIds[slot])*vertexSize], vertex, vertexSize*sizeof(float)) != 0) {
+            slot = (slot + 1) & mask;
+        }
+
+        if (vertexIds[slot] == ~0u) {
+            vertexIds[slot] = uniqueCount;
+            std::memmove(&mesh.vertices[size_t(uniqueCount)*vertexSize], vertex, vertexSize*sizeof(float));
+            uniqueCount++;
+        }
+        mesh.indices[corner] = vertexIds[slot];
+    }
+
+    mesh.vertices.resize(size_t(uniqueCount)*vertexSize);
+    mesh.vertices.shrink_to_fit();
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) {
+        return;
+    }
+
+    // triangles touching each vertex, stored back to back
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = unsigned(i / 3);
+    }
+
+    std::vector<unsigned int> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+    }
+
+    // a vertex is in the cache while time - cacheTime[v] <= cacheSize
+    std::vector<long long> cacheTime(vertexCount, 0);
+    long long time = cacheSize + 1;
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    size_t cursor = 0;
+
+    long long fanning = indices[0];
+    while (fanning >= 0) {
+        // emits every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int v = indices[triangle*3 + corner];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        // next fans around the candidate that stays in the cache longest while its triangles are emitted
+        fanning = -1;
+        long long bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            long long priority = 0;
+            if (time - cacheTime[v] + 2*liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        // dead end: falls back to recently used vertices, then to any vertex with triangles left
+        while (fanning < 0 && !deadEnds.empty()) {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) {
+                fanning = v;
+            }
+        }
+        while (fanning < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                fanning = cursor;
+            }
+            cursor++;
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &vertices, int vertexSize,
+                                     int cacheSize, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertices.size() / vertexSize;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // clusters start where the cache was flushed anyway (all 3 corners missed), and wherever the cluster so far
+    // is cheap enough that starting the next one with an empty cache keeps the ACMR within the threshold
+    float limit = analyzeVertexCache(indices, vertexCount, cacheSize).acmr * threshold;
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<size_t> clusterStarts = {0};
+    size_t clusterMisses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        int misses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            misses += cache.access(indices[t*3 + corner]);
+        }
+        if (misses == 3 && t > clusterStarts.back()) {
+            clusterStarts.push_back(t);
+            clusterMisses = 0;
+        }
+
+        clusterMisses += misses;
+        size_t clusterTriangles = t + 1 - clusterStarts.back();
+        if (t + 1 < triangleCount && clusterMisses <= limit * clusterTriangles) {
+            clusterStarts.push_back(t + 1);
+            clusterMisses = 0;
+            cache.flush();
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    size_t clusterCount = clusterStarts.size() - 1;
+    if (clusterCount < MIN_OVERDRAW_CLUSTERS) {
+        return;
+    }
+
+    // area weighted centroid and normal of each cluster, and of the whole mesh
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            glm::vec3 a = getPosition(vertices, indices[t*3], vertexSize);
+            glm::vec3 b = getPosition(vertices, indices[t*3 + 1], vertexSize);
+            glm::vec3 d = getPosition(vertices, indices[t*3 + 2], vertexSize);
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            centroids[c] += area * (a + b + d) / 3.f;
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.f ? centroids[c] / clusterArea : getPosition(vertices, indices[clusterStarts[c]*3], vertexSize);
+    }
+    meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3(0.f);
+
+    // clusters facing away from the mesh's centre are the likeliest occluders, so they are drawn first
+    std::vector<float> facing(clusterCount, 0.f);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float length = glm::length(normals[c]);
+        if (length > 0.f) {
+            facing[c] = glm::dot(centroids[c] - meshCentroid, normals[c] / length);
+        }
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return facing[a] > facing[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c : order) {
+        output.insert(output.end(), indices.begin() + clusterStarts[c]*3, indices.begin() + clusterStarts[c + 1]*3);
+    }
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<unsigned int> &indices, std::vector<float> &vertices, int vertexSize) {
+    size_t vertexCount = vertices.size() / vertexSize;
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    unsigned int next = 0;
+    for (unsigned int &index : indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<float> reordered(size_t(next)*vertexSize);
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] != ~0u) {
+            std::memcpy(&reordered[size_t(remap[v])*vertexSize], &vertices[v*vertexSize], vertexSize*sizeof(float));
+        }
+    }
+    vertices.swap(reordered);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<char> used(vertexCount, 0);
+    size_t transformed = 0;
+    size_t usedCount = 0;
+    for (unsigned int index : indices) {
+        transformed += cache.access(index);
+        if (!used[index]) {
+            used[index] = 1;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = float(transformed) / (indices.size() / 3);
+    stats.atvr = float(transformed) / usedCount;
+    return stats;
+}
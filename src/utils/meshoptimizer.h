@@ -0,0 +1,68 @@
+#pragma once
+
+#include "meshloader.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    float acmr = 0.f;   // average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst
+    float atvr = 0.f;   // average transformed vertex ratio: transformed vertices per vertex, 1 at best
+};
+
+// Vertex cache efficiency of a mesh before and after MeshOptimizer::optimize(), and the time it took
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    double seconds = 0.0;
+};
+
+class MeshOptimizer {
+public:
+    // Runs every pass below on an indexed mesh: vertex cache order, then overdraw order, then vertex fetch order.
+    // A pass whose triangle order has a higher ACMR than the mesh came with is undone, so the ACMR never rises.
+    // @param mesh         The mesh to reorder in place.
+    // @param vertexSize   Floats per vertex, starting with the position.
+    // @return             The vertex cache statistics before and after.
+    static MeshOptimizeStats optimize(MeshData &mesh, int vertexSize);
+
+    // Prints what optimize() did to the mesh called name
+    static void printStats(const std::string &name, const MeshOptimizeStats &stats);
+
+    // Turns non-indexed triangles into an indexed mesh by welding bitwise identical vertices.
+    // @param mesh         On input, vertices holds 3 vertices per triangle and indices is ignored.
+    //                     On return, vertices holds each distinct vertex once, in order of first use.
+    // @param vertexSize   Floats per vertex.
+    static void generateIndexBuffer(MeshData &mesh, int vertexSize);
+
+    // Reorders triangles so consecutive triangles reuse vertices still in the GPU's post-transform
+    // vertex cache, using Tipsify (Sander et al. 2007). Runs in linear time.
+    // @param indices      Triangle indices, reordered in place.
+    // @param vertexCount  Number of vertices the indices refer to.
+    // @param cacheSize    Number of vertices the targeted cache holds.
+    static void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize = 16);
+
+    // Reorders clusters of a cache optimized triangle order so outward facing clusters come first and
+    // occlude the rest, cutting overdraw from any viewpoint. Clusters are only split where that raises
+    // the ACMR by at most threshold times (Sander et al. 2007). Meshes that split into only a few
+    // clusters are left as they are.
+    // @param indices      Triangle indices, already ordered by optimizeVertexCache(), reordered in place.
+    // @param vertices     Interleaved vertices of vertexSize floats each, starting with the position.
+    // @param vertexSize   Floats per vertex.
+    // @param cacheSize    Number of vertices the targeted cache holds.
+    // @param threshold    Largest allowed ACMR increase, as a ratio.
+    static void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &vertices, int vertexSize,
+                                 int cacheSize = 16, float threshold = 1.05f);
+
+    // Renumbers vertices in order of first use, so vertex fetches walk memory forwards.
+    // @param indices      Triangle indices, rewritten in place to the new numbering.
+    // @param vertices     Interleaved vertices of vertexSize floats each, reordered in place.
+    //                     Vertices no index refers to are dropped.
+    // @param vertexSize   Floats per vertex.
+    static void optimizeVertexFetch(std::vector<unsigned int> &indices, std::vector<float> &vertices, int vertexSize);
+
+    // Simulates drawing indices through a FIFO post-transform cache of cacheSize vertices
+    static VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize = 16);
+};
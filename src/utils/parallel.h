@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace Parallel
+{
+    // Calls fn(i) for every i in [0, count), spread over the global QThreadPool.
+    // The calling thread takes items too, so this is safe to call from inside a pool task:
+    // helpers that only get scheduled after all items are taken simply return.
+    template <typename Function>
+    inline void forEach(int count, Function &&fn) {
+        if (count <= 0) {
+            return;
+        }
+
+        QThreadPool *pool = QThreadPool::globalInstance();
+        int helpers = std::min(count, pool->maxThreadCount()) - 1;
+        if (helpers <= 0) {
+            for (int i = 0; i < count; i++) {
+                fn(i);
+            }
+            return;
+        }
+
+        struct State {
+            std::atomic<int> next{0};
+            int finished = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto state = std::make_shared<State>();
+        auto *work = &fn;
+
+        // takes items until none are left, fn is only touched while the caller is still waiting
+        auto drain = [state, work, count]() {
+            int completed = 0;
+            for (int i = state->next++; i < count; i = state->next++) {
+                (*work)(i);
+                completed++;
+            }
+            if (completed > 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished += completed;
+                if (state->finished == count) {
+                    state->done.notify_all();
+                }
+            }
+        };
+
+        for (int i = 0; i < helpers; i++) {
+            pool->start(drain);
+        }
+        drain();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&]() { return state->finished == count; });
+    }
+}
@@ -0,0 +1,149 @@
+#include "programcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// bump whenever the file layout changes
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+constexpr char PROGRAM_CACHE_MAGIC[8] = {'P', 'R', 'O', 'G', 'B', 'I', 'N', '\0'};
+
+const char *getGLString(GLenum name){
+    const GLubyte *value = glGetString(name);
+    return value ? reinterpret_cast<const char *>(value) : "";
+}
+
+}
+
+bool ProgramCache::isSupported(){
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string ProgramCache::getKey(const std::vector<std::string> &sources){
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    // a binary is only valid for the driver build that produced it
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}){
+        hash.addData(QByteArray::fromRawData(getGLString(name), std::strlen(getGLString(name)) + 1));
+    }
+
+    // lengths keep e.g. ("ab", "c") and ("a", "bc") apart
+    for (const std::string &source : sources){
+        uint64_t length = source.size();
+        hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(&length), sizeof(length)));
+        hash.addData(QByteArray::fromRawData(source.data(), source.size()));
+    }
+
+    return hash.result().toHex().toStdString();
+}
+
+std::string ProgramCache::getCachePath(const std::string &key){
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+    return (directory + "/" + QString::fromStdString(key) + ".bin").toStdString();
+}
+
+GLuint ProgramCache::load(const std::string &key){
+    if (!isSupported()){
+        return 0;
+    }
+
+    QFile file(QString::fromStdString(getCachePath(key)));
+    if (!file.open(QIODevice::ReadOnly)){
+        return 0;
+    }
+    QByteArray data = file.readAll();
+
+    Header header;
+    if (size_t(data.size()) < sizeof(Header)){
+        return 0;
+    }
+    std::memcpy(&header, data.constData(), sizeof(Header));
+    if (std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PROGRAM_CACHE_VERSION ||
+        size_t(data.size()) != sizeof(Header) + header.binaryLength){
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, data.constData() + sizeof(Header), header.binaryLength);
+
+    // drivers may reject binaries from before an update even when the version string is unchanged
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE){
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ProgramCache::save(const std::string &key, GLuint program){
+    if (!isSupported()){
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0){
+        return;
+    }
+
+    QByteArray data(sizeof(Header) + length, '\0');
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binaryFormat, data.data() + sizeof(Header));
+    if (written <= 0){
+        return;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = written;
+    std::memcpy(data.data(), &header, sizeof(Header));
+    data.resize(sizeof(Header) + written);
+
+    // a failed save (e.g. a read only directory) only means the next launch compiles again
+    std::string cachepath = getCachePath(key);
+    QDir().mkpath(QFileInfo(QString::fromStdString(cachepath)).path());
+    QSaveFile file(QString::fromStdString(cachepath));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()){
+        std::cerr << "could not write program cache " << cachepath << std::endl;
+    }
+}
+
+void ProgramCache::recordProgram(bool cached, double milliseconds){
+    if (cached){
+        m_cachedPrograms++;
+        m_cachedMilliseconds += milliseconds;
+    } else {
+        m_compiledPrograms++;
+        m_compiledMilliseconds += milliseconds;
+    }
+}
+
+/**
+ * @brief Prints the time spent creating programs. Programs compiled on a cold start are loaded from
+ *        the cache on the next (warm) start, so the two lines compare cold and warm startup
+ */
+void ProgramCache::printStats(){
+    if (m_compiledPrograms > 0){
+        std::cout << "Compiled " << m_compiledPrograms << " shader programs from source in "
+                  << m_compiledMilliseconds << " ms (" << m_compiledMilliseconds / m_compiledPrograms << " ms each)" << std::endl;
+    }
+    if (m_cachedPrograms > 0){
+        std::cout << "Loaded " << m_cachedPrograms << " shader programs from the binary cache in "
+                  << m_cachedMilliseconds << " ms (" << m_cachedMilliseconds / m_cachedPrograms << " ms each)" << std::endl;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked shader programs in the driver's binary format (glGetProgramBinary), so only
+// the first launch compiles GLSL. Entries are keyed by a hash of every stage's final source and the
+// driver's vendor, renderer and version; a binary the driver rejects anyway is simply compiled again.
+class ProgramCache {
+public:
+    // Identifies the program linked from sources (one per stage, in attach order) on the current driver
+    static std::string getKey(const std::vector<std::string> &sources);
+
+    // Creates the program cached under key, or returns 0 if there is no usable binary
+    static GLuint load(const std::string &key);
+
+    // Saves a linked program under key. The program must have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static void save(const std::string &key, GLuint program);
+
+    // Whether the driver supports any program binary format, needs the GL context
+    static bool isSupported();
+
+    // Records the time ShaderLoader spent creating a program, from the cache or from source
+    static void recordProgram(bool cached, double milliseconds);
+    static void printStats();
+
+    static std::string getCachePath(const std::string &key);
+
+private:
+    // Start of a cache file, followed by binaryLength bytes of program binary
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+        uint32_t padding;
+    };
+
+    // stats
+    static inline int m_cachedPrograms = 0;
+    static inline int m_compiledPrograms = 0;
+    static inline double m_cachedMilliseconds = 0.0;
+    static inline double m_compiledMilliseconds = 0.0;
+};
@@ -0,0 +1,99 @@
+#include "scenediff.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+bool sameGlobalData(const SceneGlobalData &a, const SceneGlobalData &b){
+    return a.ka == b.ka && a.kd == b.kd && a.ks == b.ks && a.kt == b.kt;
+}
+
+bool sameCamera(const SceneCameraData &a, const SceneCameraData &b){
+    return a.pos == b.pos && a.look == b.look && a.up == b.up && a.heightAngle == b.heightAngle
+        && a.aperture == b.aperture && a.focalLength == b.focalLength;
+}
+
+bool sameLight(const SceneLightData &a, const SceneLightData &b){
+    return a.id == b.id && a.type == b.type && a.color == b.color && a.function == b.function
+        && a.pos == b.pos && a.dir == b.dir && a.penumbra == b.penumbra && a.angle == b.angle
+        && a.width == b.width && a.height == b.height;
+}
+
+}
+
+/**
+ * @brief Patches renderData's global data, camera, scene lights and shapes to update
+ */
+SceneChanges SceneDiff::apply(SceneUpdate &update, RenderData &renderData, int sceneLightCount, std::vector<SceneSubtree> &subtrees){
+    SceneChanges changes;
+
+    if (!sameGlobalData(update.header.globalData, renderData.globalData)){
+        renderData.globalData = update.header.globalData;
+        changes.globalData = true;
+    }
+
+    if (!sameCamera(update.header.cameraData, renderData.cameraData)){
+        renderData.cameraData = update.header.cameraData;
+        changes.camera = true;
+    }
+
+    const std::vector<SceneLightData> &lights = update.header.lights;
+    changes.lights = lights.size() != sceneLightCount
+                     || !std::equal(lights.begin(), lights.end(), renderData.lights.begin(), sameLight);
+    if (changes.lights){
+        renderData.lights = lights;
+    }
+
+    // the update's table extends renderData's, so it only differs by the materials added
+    if (update.header.materials.size() != renderData.materials.size()){
+        renderData.materials = std::move(update.header.materials);
+        changes.materials = true;
+    }
+
+    // where each previous subtree's shapes start
+    std::vector<size_t> offsets(subtrees.size() + 1, 0);
+    for (int i = 0; i < subtrees.size(); i++){
+        offsets[i + 1] = offsets[i] + subtrees[i].shapeCount;
+    }
+
+    bool sameLayout = update.subtrees.size() == subtrees.size();
+    for (int i = 0; sameLayout && i < update.subtrees.size(); i++){
+        sameLayout = update.reused[i] == i
+                     || (update.reused[i] < 0 && update.subtrees[i].shapeCount == subtrees[i].shapeCount);
+    }
+
+    for (int i = 0; i < update.subtrees.size(); i++){
+        if (update.reused[i] < 0){
+            changes.shapesChanged += update.subtrees[i].shapeCount;
+            changes.changedSubtrees.push_back(update.subtrees[i].name);
+        }
+    }
+
+    if (sameLayout){
+        for (int i = 0; i < update.subtrees.size(); i++){
+            if (update.reused[i] < 0){
+                std::move(update.shapes[i].begin(), update.shapes[i].end(), renderData.shapes.begin() + offsets[i]);
+            }
+        }
+    } else {
+        changes.shapesMoved = true;
+
+        std::vector<RenderShapeData> shapes;
+        shapes.reserve(offsets.back() + changes.shapesChanged);
+        for (int i = 0; i < update.subtrees.size(); i++){
+            int previous = update.reused[i];
+            if (previous >= 0){
+                shapes.insert(shapes.end(), std::make_move_iterator(renderData.shapes.begin() + offsets[previous]),
+                              std::make_move_iterator(renderData.shapes.begin() + offsets[previous + 1]));
+            } else {
+                shapes.insert(shapes.end(), std::make_move_iterator(update.shapes[i].begin()),
+                              std::make_move_iterator(update.shapes[i].end()));
+            }
+        }
+        renderData.shapes = std::move(shapes);
+    }
+
+    subtrees = update.subtrees;
+    return changes;
+}
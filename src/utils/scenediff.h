@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sceneparser.h"
+
+#include <string>
+#include <vector>
+
+// What SceneDiff::apply() changed, so the renderer only redoes the work that depends on it
+struct SceneChanges {
+    bool globalData = false;
+    bool camera = false;
+    bool lights = false;
+    bool materials = false;                     // materials were added to renderData.materials
+    size_t shapesChanged = 0;                   // shapes written from re-flattened subtrees
+    bool shapesMoved = false;                   // the subtree layout changed, so renderData.shapes was rebuilt
+    std::vector<std::string> changedSubtrees;   // names of the re-flattened subtrees
+
+    bool any() const { return globalData || camera || lights || materials || shapesChanged > 0 || shapesMoved; }
+};
+
+class SceneDiff {
+public:
+    // Patches renderData to the scene in update, touching only what differs.
+    // When every subtree keeps its place and size, the shapes of changed subtrees are overwritten in
+    // place and the rest are left alone. Otherwise renderData.shapes is rebuilt, moving unchanged
+    // subtrees' shapes over from their old place.
+    // @param update            A parse of the edited scene against subtrees, its shapes are moved from.
+    // @param renderData        The scene to patch. Its lights past sceneLightCount aren't the scene's own
+    //                          and are only dropped if the scene's lights changed.
+    // @param sceneLightCount   Number of renderData.lights from the scene file.
+    // @param subtrees          The subtrees renderData.shapes holds, updated to the new scene's.
+    static SceneChanges apply(SceneUpdate &update, RenderData &renderData, int sceneLightCount, std::vector<SceneSubtree> &subtrees);
+};
@@ -73,6 +73,10 @@ std::vector<SceneLightData> ScenefileReader::getLights() const {
    return ret;
 }
 
+const std::map<std::string, SceneNode*> &ScenefileReader::getObjects() const {
+   return m_objects;
+}
+
 SceneNode* ScenefileReader::getRootNode() const {
    std::map<std::string, SceneNode*>::iterator node = m_objects.find("root");
    if (node == m_objects.end())
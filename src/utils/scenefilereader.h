@@ -27,6 +27,9 @@ public:
 
     SceneNode* getRootNode() const;
 
+    // Every named <object>, including "root"
+    const std::map<std::string, SceneNode*> &getObjects() const;
+
 private:
     // The filename should be contained within this parser implementation.
     // If you want to parse a new file, instantiate a different parser.
@@ -2,21 +2,16 @@
 #include "scenefilereader.h"
 #include "glm/gtx/transform.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <iostream>
 
 /**
- * @brief DFS of scene nodes inside scenefile. Does two things:
- *  1) populates renderData.primitives with ctm and inverse ctm
- *  2) populates renderData.textureMap with each new unique filename and associated data encountered.
- * @param Qstring file --> texture relative filepath converted to Qstring
- * @param std::map<QString, TextureData> &textureMap --> reference to field stored inside RenderData.textureMap
+ * @brief Combines node's transformations, in order, into one matrix
  */
-void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vector<glm::mat4> ctm){
-
-    // add to transformations to ctm
-    std::vector<SceneTransformation*> transforms = currentNode.transformations;
+glm::mat4 SceneParser::getTransform(const SceneNode &node){
+    std::vector<SceneTransformation*> transforms = node.transformations;
 
     // initialize totals in case there are multiple of the same transform type
     glm::mat4 t_total(1.0f);
@@ -52,6 +47,21 @@ void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vecto
         }
     }
 
+    return t_total;
+}
+
+/**
+ * @brief DFS of scene nodes inside scenefile. Does two things:
+ *  1) populates renderData.primitives with ctm and inverse ctm
+ *  2) populates renderData.textureMap with each new unique filename and associated data encountered.
+ * @param Qstring file --> texture relative filepath converted to Qstring
+ * @param std::map<QString, TextureData> &textureMap --> reference to field stored inside RenderData.textureMap
+ */
+void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vector<glm::mat4> ctm, ShapeStream *stream){
+
+    // add to transformations to ctm
+    glm::mat4 t_total = getTransform(currentNode);
+
     // add final matrix to ctm for ancestry line
     ctm.push_back(t_total);
 
@@ -72,9 +82,11 @@ void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vecto
         // enter data for each primitive
         for (int i = 0; i < primitives.size(); i++){
 
-            // create new renderShape obj
+            // create new renderShape obj, its material is stored once per scene
             RenderShapeData newPrimitive;
-            newPrimitive.primitive = *primitives[i];
+            newPrimitive.type = primitives[i]->type;
+            newPrimitive.meshfile = primitives[i]->meshfile;
+            newPrimitive.materialIndex = renderData.materials.intern(primitives[i]->material);
 
             // stores ctms for each shape so they don't need to be calculated again later on
             newPrimitive.ctm = m_total;
@@ -82,8 +94,8 @@ void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vecto
             newPrimitive.inverse_transpose_ctm = glm::transpose(glm::inverse(glm::mat3(m_total)));
 ;
             // add primitive's material/texture to textureMap if it has texture
-            if (newPrimitive.primitive.material.textureMap.isUsed){
-                QString filename = QString::fromStdString(newPrimitive.primitive.material.textureMap.filename);
+            if (primitives[i]->material.textureMap.isUsed){
+                QString filename = QString::fromStdString(primitives[i]->material.textureMap.filename);
                 // check if renderData already does not have filename already
 //                if (renderData.textureMap.count(filename) == 0){
 //                    loadImageFromFile(filename, renderData.textureMap);
@@ -92,13 +104,21 @@ void SceneParser::DFS(SceneNode& currentNode, RenderData &renderData, std::vecto
 
             //append to renderData
             renderData.shapes.push_back(newPrimitive);
+
+            // when streaming, full chunks are handed out right away
+            if (stream && renderData.shapes.size() >= stream->chunkSize && !flush(renderData, *stream)){
+                return;
+            }
         }
     }
 
 
     // recurse for all node's children
     for (int i = 0; i < currentNode.children.size(); i++){
-        DFS(*currentNode.children[i], renderData, ctm);
+        DFS(*currentNode.children[i], renderData, ctm, stream);
+        if (stream && stream->stopped){
+            return;
+        }
     }
 
 }
@@ -127,6 +147,7 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
 
     //clear renderData.shapes
     renderData.shapes.clear();
+    renderData.materials = MaterialTable();
     //renderData.textureMap.clear();
     std::vector<glm::mat4> ctm;
 
@@ -135,3 +156,229 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
 
     return true;
 }
+
+/**
+ * @brief Counts the primitives under node, each becomes one shape
+ */
+size_t SceneParser::countPrimitives(const SceneNode &node){
+    size_t count = node.primitives.size();
+    for (const SceneNode *child : node.children){
+        count += countPrimitives(*child);
+    }
+    return count;
+}
+
+/**
+ * @brief Hands the shapes collected in renderData to the stream's callback and empties them
+ * @return False if the callback stopped the parse
+ */
+bool SceneParser::flush(RenderData &renderData, ShapeStream &stream){
+    stream.done += renderData.shapes.size();
+    float progress = stream.total == 0 ? 1.f : float(stream.done) / stream.total;
+    stream.stopped = !(*stream.onChunk)(renderData.shapes, progress);
+    renderData.shapes.clear();
+    return !stream.stopped;
+}
+
+/**
+ * @brief Parses scenefile data into renderData, streaming the shapes to onChunk
+ */
+bool SceneParser::parse(std::string filepath, RenderData &renderData, size_t chunkSize, const ShapeChunkCallback &onChunk,
+                        std::vector<SceneSubtree> *subtrees) {
+    ScenefileReader fileReader = ScenefileReader(filepath);
+    bool success = fileReader.readXML();
+    if (!success) {
+        return false;
+    }
+
+    renderData.globalData = fileReader.getGlobalData();
+    renderData.cameraData = fileReader.getCameraData();
+    renderData.lights = fileReader.getLights();
+    renderData.shapes.clear();
+    renderData.materials = MaterialTable();
+
+    SceneNode* root = fileReader.getRootNode();
+    ShapeStream stream{std::max<size_t>(chunkSize, 1), countPrimitives(*root), 0, &onChunk};
+
+    // the scene's metadata can be used before any shape is flattened
+    if (!flush(renderData, stream)){
+        return false;
+    }
+
+    // flattens the root's subtrees one by one, the same order DFS(*root) would
+    std::vector<RootUnit> units = getRootUnits(*root, fileReader.getObjects());
+    for (RootUnit &unit : units){
+        size_t before = stream.done + renderData.shapes.size();
+        DFS(unit.node, renderData, unit.ctm, &stream);
+        if (stream.stopped){
+            return false;
+        }
+        unit.subtree.shapeCount = stream.done + renderData.shapes.size() - before;
+        if (subtrees){
+            subtrees->push_back(unit.subtree);
+        }
+    }
+
+    // the last, partial chunk
+    return renderData.shapes.empty() || flush(renderData, stream);
+}
+
+/**
+ * @brief Hashes everything the shapes under node depend on: its transformations, its primitives'
+ *        types, materials and mesh files, and its children. Shared nodes are hashed once
+ */
+uint64_t SceneParser::hashNode(const SceneNode &node, std::unordered_map<const SceneNode*, uint64_t> &hashes){
+    auto known = hashes.find(&node);
+    if (known != hashes.end()){
+        return known->second;
+    }
+
+    // FNV-1a, every field is initialized by the reader so the bytes are deterministic
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void *data, size_t size){
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++){
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    auto addString = [&add](const std::string &string){
+        size_t size = string.size();
+        add(&size, sizeof(size));
+        add(string.data(), size);
+    };
+    auto addMap = [&](const SceneFileMap &map){
+        add(&map.isUsed, sizeof(map.isUsed));
+        addString(map.filename);
+        add(&map.repeatU, sizeof(map.repeatU));
+        add(&map.repeatV, sizeof(map.repeatV));
+    };
+
+    for (const SceneTransformation *transform : node.transformations){
+        add(&transform->type, sizeof(transform->type));
+        add(&transform->translate, sizeof(transform->translate));
+        add(&transform->scale, sizeof(transform->scale));
+        add(&transform->rotate, sizeof(transform->rotate));
+        add(&transform->angle, sizeof(transform->angle));
+        add(&transform->matrix, sizeof(transform->matrix));
+    }
+
+    for (const ScenePrimitive *primitive : node.primitives){
+        const SceneMaterial &material = primitive->material;
+        add(&primitive->type, sizeof(primitive->type));
+        addString(primitive->meshfile);
+        add(&material.cAmbient, sizeof(material.cAmbient));
+        add(&material.cDiffuse, sizeof(material.cDiffuse));
+        add(&material.cSpecular, sizeof(material.cSpecular));
+        add(&material.shininess, sizeof(material.shininess));
+        add(&material.cReflective, sizeof(material.cReflective));
+        add(&material.cTransparent, sizeof(material.cTransparent));
+        add(&material.ior, sizeof(material.ior));
+        addMap(material.textureMap);
+        add(&material.blend, sizeof(material.blend));
+        add(&material.cEmissive, sizeof(material.cEmissive));
+        addMap(material.bumpMap);
+    }
+
+    // children are hashed in order, so moving a subtree within its parent changes the parent's hash
+    size_t childCount = node.children.size();
+    add(&childCount, sizeof(childCount));
+    for (const SceneNode *child : node.children){
+        uint64_t childHash = hashNode(*child, hashes);
+        add(&childHash, sizeof(childHash));
+    }
+
+    hashes[&node] = hash;
+    return hash;
+}
+
+/**
+ * @brief Splits the root into the subtrees reloads compare: its own primitives, then each child
+ *        under the root's transformations, in the order DFS visits them
+ */
+std::vector<SceneParser::RootUnit> SceneParser::getRootUnits(const SceneNode &root, const std::map<std::string, SceneNode*> &objects){
+    std::unordered_map<const SceneNode*, std::string> names;
+    for (const auto &[name, node] : objects){
+        names[node] = name;
+    }
+    std::unordered_map<const SceneNode*, uint64_t> hashes;
+
+    std::vector<RootUnit> units;
+    if (!root.primitives.empty()){
+        RootUnit &unit = units.emplace_back();
+        unit.node.transformations = root.transformations;
+        unit.node.primitives = root.primitives;
+        unit.subtree.name = "root";
+        unit.subtree.hash = hashNode(unit.node, hashes);
+    }
+
+    // every child depends on the root's transformations too
+    SceneNode rootTransform;
+    rootTransform.transformations = root.transformations;
+    uint64_t rootHash = hashNode(rootTransform, hashes);
+    glm::mat4 rootMatrix = getTransform(root);
+
+    for (int i = 0; i < root.children.size(); i++){
+        const SceneNode *child = root.children[i];
+        RootUnit &unit = units.emplace_back();
+        unit.node = *child;
+        unit.ctm = {rootMatrix};
+        unit.subtree.hash = hashNode(*child, hashes) ^ (rootHash * 1099511628211ull);
+
+        // a transblock is usually anonymous, its first child names it if that is a master reference
+        auto name = names.find(child);
+        if (name == names.end() && !child->children.empty()){
+            name = names.find(child->children[0]);
+        }
+        unit.subtree.name = name != names.end() ? name->second : "transblock " + std::to_string(i);
+    }
+    return units;
+}
+
+/**
+ * @brief Parses an edited scene file, reusing the previous parse's shapes for unchanged subtrees
+ */
+bool SceneParser::parseChanges(std::string filepath, const std::vector<SceneSubtree> &previous, const MaterialTable &materials,
+                               SceneUpdate &update) {
+    ScenefileReader fileReader = ScenefileReader(filepath);
+    bool success = fileReader.readXML();
+    if (!success) {
+        return false;
+    }
+
+    update.header.globalData = fileReader.getGlobalData();
+    update.header.cameraData = fileReader.getCameraData();
+    update.header.lights = fileReader.getLights();
+
+    // new materials are added after the previous ones, whose indices the reused shapes hold
+    update.header.materials = materials;
+
+    // previous subtrees by hash, each can be reused once
+    std::unordered_map<uint64_t, std::vector<int>> unused;
+    for (int i = int(previous.size()) - 1; i >= 0; i--){
+        unused[previous[i].hash].push_back(i);
+    }
+
+    std::vector<RootUnit> units = getRootUnits(*fileReader.getRootNode(), fileReader.getObjects());
+    update.subtrees.clear();
+    update.reused.assign(units.size(), -1);
+    update.shapes.assign(units.size(), {});
+    for (int i = 0; i < units.size(); i++){
+        RootUnit &unit = units[i];
+        auto match = unused.find(unit.subtree.hash);
+        if (match != unused.end() && !match->second.empty()){
+            update.reused[i] = match->second.back();
+            match->second.pop_back();
+            unit.subtree.shapeCount = previous[update.reused[i]].shapeCount;
+        } else {
+            RenderData flattened;
+            flattened.materials = std::move(update.header.materials);
+            DFS(unit.node, flattened, unit.ctm);
+            unit.subtree.shapeCount = flattened.shapes.size();
+            update.shapes[i] = std::move(flattened.shapes);
+            update.header.materials = std::move(flattened.materials);
+        }
+        update.subtrees.push_back(unit.subtree);
+    }
+
+    return true;
+}
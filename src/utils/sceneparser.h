@@ -1,12 +1,19 @@
 #pragma once
 
 #include "scenedata.h"
+#include "materialtable.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
 // Struct which contains data for a single primitive, to be used for rendering
 struct RenderShapeData {
-    ScenePrimitive primitive;
+    PrimitiveType type;
+    std::string meshfile;   // Used for triangle meshes
+    uint32_t materialIndex; // into RenderData.materials, shared by every shape with an equal material
     glm::mat4 ctm; // the cumulative transformation matrix
     glm::mat4 inverse_ctm;
     glm::mat3 inverse_transpose_ctm;
@@ -19,8 +26,29 @@ struct RenderData {
 
     std::vector<SceneLightData> lights;
     std::vector<RenderShapeData> shapes;
+    MaterialTable materials;
 };
 
+// A subtree directly under the scene's root, the unit a reload compares and re-flattens. The root's own
+// primitives, if any, are a subtree of their own. renderData.shapes holds each subtree's shapes in order
+struct SceneSubtree {
+    std::string name;           // the named object the subtree instances, for reporting what changed
+    uint64_t hash = 0;          // of everything its shapes depend on, including the root's transformations
+    size_t shapeCount = 0;
+};
+
+// A reparse of a scene that only flattened the subtrees not found unchanged in the previous parse
+struct SceneUpdate {
+    RenderData header;                                  // global data, camera, lights and materials, no shapes
+    std::vector<SceneSubtree> subtrees;                 // of the new scene, in order
+    std::vector<int> reused;                            // per subtree, the identical previous subtree or -1
+    std::vector<std::vector<RenderShapeData>> shapes;   // per subtree, its shapes if it isn't reused
+};
+
+// Receives the flattened shapes of a scene a chunk at a time, in scene order, with the fraction of shapes
+// handed out so far. The chunk may be moved from. Returning false stops the parse
+using ShapeChunkCallback = std::function<bool(std::vector<RenderShapeData> &chunk, float progress)>;
+
 class SceneParser {
 public:
     // Parse the scene and store the results in renderData.
@@ -29,7 +57,50 @@ public:
     // @return            A boolean value indicating whether the parse was successful.
     static bool parse(std::string filepath, RenderData &renderData);
 
+    // Parses the scene like above, but hands the shapes to onChunk as they are flattened instead of
+    // keeping them, so a large scene can be shown while the rest is still being flattened.
+    // onChunk is first called with no shapes once renderData's global data, camera and lights are set.
+    // @param filepath    The path of the scene file to load.
+    // @param renderData  On return, this will contain the metadata of the loaded scene, with no shapes.
+    // @param chunkSize   Number of shapes in every chunk but the last.
+    // @param onChunk     Called on the parsing thread for every chunk.
+    // @param subtrees    If given, on return this will contain the scene's subtrees for parseChanges().
+    // @return            False if the parse failed or onChunk stopped it.
+    static bool parse(std::string filepath, RenderData &renderData, size_t chunkSize, const ShapeChunkCallback &onChunk,
+                      std::vector<SceneSubtree> *subtrees = nullptr);
+
+    // Parses the scene again after it was edited, flattening only the subtrees whose hash isn't among
+    // the previous parse's. Subtrees are matched by hash alone, so moved and reordered ones are reused too.
+    // @param filepath    The path of the scene file to load.
+    // @param previous    The subtrees of the scene as last parsed.
+    // @param materials   The material table the previous shapes index, extended into update's.
+    // @param update      On return, this will contain the new scene, see SceneUpdate.
+    // @return            A boolean value indicating whether the parse was successful.
+    static bool parseChanges(std::string filepath, const std::vector<SceneSubtree> &previous, const MaterialTable &materials,
+                             SceneUpdate &update);
+
 private:
-    static void DFS(SceneNode& currentNode, RenderData &renderData, std::vector<glm::mat4> ctm);
+    // Where DFS hands its shapes when streaming
+    struct ShapeStream {
+        size_t chunkSize;
+        size_t total;                       // primitives in the whole scene
+        size_t done = 0;
+        const ShapeChunkCallback *onChunk;
+        bool stopped = false;
+    };
+
+    // A subtree of the root, with what DFS needs to flatten it on its own
+    struct RootUnit {
+        SceneNode node;
+        std::vector<glm::mat4> ctm;
+        SceneSubtree subtree;
+    };
+
+    static void DFS(SceneNode& currentNode, RenderData &renderData, std::vector<glm::mat4> ctm, ShapeStream *stream = nullptr);
+    static glm::mat4 getTransform(const SceneNode &node);
+    static std::vector<RootUnit> getRootUnits(const SceneNode &root, const std::map<std::string, SceneNode*> &objects);
+    static uint64_t hashNode(const SceneNode &node, std::unordered_map<const SceneNode*, uint64_t> &hashes);
+    static size_t countPrimitives(const SceneNode &node);
+    static bool flush(RenderData &renderData, ShapeStream &stream);
 };
 
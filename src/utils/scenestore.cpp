@@ -0,0 +1,110 @@
+#include "scenestore.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <iostream>
+
+void SceneStore::clear(){
+    types.clear();
+    ctms.clear();
+    normalMatrices.clear();
+    materialIndices.clear();
+    meshIndices.clear();
+    materials.clear();
+    meshfiles.clear();
+    m_meshIndex.clear();
+}
+
+void SceneStore::build(const RenderData &renderData){
+    clear();
+    updateMaterials(renderData.materials);
+    append(renderData.shapes.data(), renderData.shapes.size());
+}
+
+/**
+ * @brief Tables only grow while a scene is loaded, a smaller one belongs to another scene
+ */
+void SceneStore::updateMaterials(const MaterialTable &table){
+    if (table.size() < materials.size()){
+        materials.clear();
+    }
+
+    for (size_t i = materials.size(); i < table.size(); i++){
+        const SceneMaterial &material = table[i];
+        materials.push_back({material.cAmbient, material.cDiffuse, material.cSpecular, material.shininess});
+    }
+}
+
+/**
+ * @brief Appends shapes, interning their mesh files
+ */
+void SceneStore::append(const RenderShapeData *shapes, size_t count){
+    size_t total = size() + count;
+    types.reserve(total);
+    ctms.reserve(total);
+    normalMatrices.reserve(total);
+    materialIndices.reserve(total);
+    meshIndices.reserve(total);
+
+    for (size_t i = 0; i < count; i++){
+        const RenderShapeData &shape = shapes[i];
+        types.push_back(shape.type);
+        ctms.push_back(shape.ctm);
+        normalMatrices.push_back(shape.inverse_transpose_ctm);
+        materialIndices.push_back(shape.materialIndex);
+
+        uint32_t meshIndex = 0;
+        if (shape.type == PrimitiveType::PRIMITIVE_MESH){
+            auto [mesh, newMesh] = m_meshIndex.try_emplace(shape.meshfile, uint32_t(meshfiles.size()));
+            if (newMesh){
+                meshfiles.push_back(shape.meshfile);
+            }
+            meshIndex = mesh->second;
+        }
+        meshIndices.push_back(meshIndex);
+    }
+}
+
+/**
+ * @brief Compares iterating RenderData.shapes with iterating the store, each pass reading the type,
+ *        mesh, material, ctm and normal matrix of every shape into a checksum the way drawShapes() does
+ */
+void SceneStore::benchmarkIteration(const RenderData &renderData, const SceneStore &store){
+    const std::vector<RenderShapeData> &shapes = renderData.shapes;
+    if (shapes.empty()){
+        return;
+    }
+
+    // enough passes for about a million shapes, so small scenes don't time the timer
+    int passes = std::max<int>(1, 1000000 / shapes.size());
+    float checksum = 0.f;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int pass = 0; pass < passes; pass++){
+        for (const RenderShapeData &shape : shapes){
+            const SceneMaterial &material = renderData.materials[shape.materialIndex];
+            checksum += float(shape.type) + float(shape.meshfile.size());
+            checksum += material.cAmbient.x + material.cDiffuse.y + material.cSpecular.z + material.shininess;
+            checksum += shape.ctm[3].x + shape.inverse_transpose_ctm[2].z;
+        }
+    }
+    qint64 aosNsecs = timer.nsecsElapsed();
+
+    timer.start();
+    for (int pass = 0; pass < passes; pass++){
+        for (size_t i = 0; i < store.size(); i++){
+            const ShapeMaterial &material = store.materials[store.materialIndices[i]];
+            checksum += float(store.types[i]) + float(store.meshIndices[i]);
+            checksum += material.ambient.x + material.diffuse.y + material.specular.z + material.shininess;
+            checksum += store.ctms[i][3].x + store.normalMatrices[i][2].z;
+        }
+    }
+    qint64 soaNsecs = timer.nsecsElapsed();
+
+    double shapeCount = double(shapes.size()) * passes;
+    std::cout << "Shape iteration over " << shapes.size() << " shapes (" << store.materials.size() << " materials): "
+              << aosNsecs / shapeCount << " ns/shape as RenderShapeData, "
+              << soaNsecs / shapeCount << " ns/shape as SceneStore"
+              << " (checksum " << checksum << ")" << std::endl;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "sceneparser.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+// The part of a SceneMaterial the shaders read
+struct ShapeMaterial {
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    float shininess;
+};
+
+// Structure-of-arrays copy of RenderData.shapes for the per-frame loops. Shape i is at index i of every
+// array, so a loop streams only the arrays it reads instead of whole RenderShapeData entries with their
+// mesh file strings and inverse ctm. Materials and mesh files are stored once and referenced by index
+class SceneStore {
+public:
+    // Appends shapes to the end of every array
+    void append(const RenderShapeData *shapes, size_t count);
+
+    // Brings materials up to date with the table the shapes index, converting the materials added since
+    void updateMaterials(const MaterialTable &table);
+
+    // Replaces the store's content with renderData's shapes and materials
+    void build(const RenderData &renderData);
+
+    void clear();
+
+    size_t size() const { return types.size(); }
+
+    std::vector<PrimitiveType> types;
+    std::vector<glm::mat4> ctms;
+    std::vector<glm::mat3> normalMatrices;      // inverse transpose of each ctm's upper 3x3
+    std::vector<uint32_t> materialIndices;      // into materials, the same as into RenderData.materials
+    std::vector<uint32_t> meshIndices;          // into meshfiles for PRIMITIVE_MESH shapes, 0 otherwise
+
+    std::vector<ShapeMaterial> materials;       // of every RenderData.materials entry
+    std::vector<std::string> meshfiles;         // distinct mesh files
+
+    // Times one pass over renderData's shapes and over store reading what drawShapes() reads per shape,
+    // and prints the cost per shape of each. Both must hold the same scene
+    static void benchmarkIteration(const RenderData &renderData, const SceneStore &store);
+
+private:
+    std::unordered_map<std::string, uint32_t> m_meshIndex;
+};
@@ -5,80 +5,215 @@
 #define GL_SILENCE_DEPRECATION
 #endif
 #include <GL/glew.h>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QTextStream>
+#include <initializer_list>
 #include <iostream>
+#include <string>
+#include <vector>
+#include "programcache.h"
+
+// A program submitted by ShaderLoader::beginShaderProgram() that may still be compiling
+struct PendingProgram {
+    GLuint program = 0;
+    std::vector<GLuint> shaders;                        // detached and deleted once linked
+    std::string key;                                    // ProgramCache key, saved under once linked
+    bool cached = false;                                // loaded from ProgramCache, so already linked
+    QElapsedTimer timer;
+};
 
 class ShaderLoader{
 public:
     static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path){
-        // Create and compile the shaders.
-        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
-        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+        return createShaderProgram(vertex_file_path, {fragment_file_path});
+    }
+
+    // Fragment stages may be split over several files, e.g. a main() and the functions it shares with other programs.
+    // defines holds #define lines inserted after every stage's #version line, see ShaderVariants
+    static GLuint createShaderProgram(const char * vertex_file_path, std::initializer_list<const char *> fragment_file_paths,
+                                      const std::string &defines = ""){
+        return createShaderProgram(vertex_file_path, std::vector<const char *>(fragment_file_paths), defines);
+    }
+
+    // Programs are loaded from ProgramCache when a binary of the same sources was cached by the same driver,
+    // and compiled and cached otherwise
+    static GLuint createShaderProgram(const char * vertex_file_path, const std::vector<const char *> &fragment_file_paths,
+                                      const std::string &defines){
+        PendingProgram pending = beginShaderProgram(vertex_file_path, fragment_file_paths, defines);
+        return finishShaderProgram(pending);
+    }
+
+    // Reads resource shaders (":/resources/shaders/...") from directory instead, e.g. the source tree so edited
+    // shaders can be reloaded without rebuilding the resources. An empty directory reads the resources again
+    static void setSourceDirectory(const std::string &directory){
+        m_sourceDirectory = directory;
+    }
+
+    // The file a shader path is read from
+    static std::string getFilePath(const std::string &filepath){
+        if (!m_sourceDirectory.empty() && filepath.rfind(":/", 0) == 0){
+            return m_sourceDirectory + filepath.substr(1);
+        }
+        return filepath;
+    }
+
+    // Lets the driver compile on as many threads as it likes, if it supports KHR/ARB_parallel_shader_compile.
+    // Called once after GLEW is initialized
+    static void enableParallelCompile(){
+        if (GLEW_KHR_parallel_shader_compile){
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        } else if (GLEW_ARB_parallel_shader_compile){
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+    }
+
+    // Submits a program's compile and link without waiting for either. With parallel shader compile, the driver
+    // works on every submitted program at once and isProgramReady() tells when one is done; without it,
+    // finishing a program waits for it like createShaderProgram()
+    static PendingProgram beginShaderProgram(const char * vertex_file_path, const std::vector<const char *> &fragment_file_paths,
+                                             const std::string &defines){
+        PendingProgram pending;
+        pending.timer.start();
+
+        // Read every stage, the cache key covers their final sources
+        std::vector<GLenum> types = {GL_VERTEX_SHADER};
+        std::vector<std::string> sources = {readShader(vertex_file_path, defines)};
+        for (const char *fragment_file_path : fragment_file_paths){
+            types.push_back(GL_FRAGMENT_SHADER);
+            sources.push_back(readShader(fragment_file_path, defines));
+        }
+
+        pending.key = ProgramCache::getKey(sources);
+        pending.program = ProgramCache::load(pending.key);
+        if (pending.program != 0){
+            pending.cached = true;
+            return pending;
+        }
+
+        // Create and compile the shaders, their status is checked once linked
+        for (size_t i = 0; i < sources.size(); i++){
+            pending.shaders.push_back(createShader(types[i], sources[i]));
+        }
 
         // Link the shader program.
-        GLuint programID = glCreateProgram();
-        glAttachShader(programID, vertexShaderID);
-        glAttachShader(programID, fragmentShaderID);
-        glLinkProgram(programID);
+        pending.program = glCreateProgram();
+        for (GLuint shaderID : pending.shaders){
+            glAttachShader(pending.program, shaderID);
+        }
+        glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(pending.program);
+
+        return pending;
+    }
+
+    // Whether finishShaderProgram() would return without waiting on the driver
+    static bool isProgramReady(const PendingProgram &pending){
+        if (pending.cached || !(GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)){
+            return true;
+        }
+        GLint done = GL_FALSE;
+        glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // Returns the linked program, waiting for it if it isn't ready. Throws with the info log if it failed
+    static GLuint finishShaderProgram(PendingProgram &pending){
+        GLuint programID = pending.program;
+        if (pending.cached){
+            ProgramCache::recordProgram(true, pending.timer.nsecsElapsed() / 1e6);
+            return programID;
+        }
 
         // Print the info log if error
         GLint status;
         glGetProgramiv(programID, GL_LINK_STATUS, &status);
 
         if (status == GL_FALSE) {
+            // a stage that failed to compile explains more than the link error
+            std::string log;
+            for (GLuint shaderID : pending.shaders){
+                log += getShaderLog(shaderID);
+            }
+
             GLint length;
             glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+            std::string programLog(length, '\0');
+            glGetProgramInfoLog(programID, length, nullptr, &programLog[0]);
+            log += programLog;
 
-            std::string log(length, '\0');
-            glGetProgramInfoLog(programID, length, nullptr, &log[0]);
-
+            for (GLuint shaderID : pending.shaders){
+                glDeleteShader(shaderID);
+            }
             glDeleteProgram(programID);
             throw std::runtime_error(log);
         }
 
         // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        for (GLuint shaderID : pending.shaders){
+            glDetachShader(programID, shaderID);
+            glDeleteShader(shaderID);
+        }
+        pending.shaders.clear();
+
+        ProgramCache::save(pending.key, programID);
+        ProgramCache::recordProgram(false, pending.timer.nsecsElapsed() / 1e6);
 
         return programID;
     }
 
 private:
-    static GLuint createShader(GLenum shaderType, const char *filepath){
-        GLuint shaderID = glCreateShader(shaderType);
-
+    static std::string readShader(const char *filepath, const std::string &defines){
         // Read shader file.
         std::string code;
-        QString filepathStr = QString(filepath);
+        QString filepathStr = QString::fromStdString(getFilePath(filepath));
         QFile file(filepathStr);
         if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
             QTextStream stream(&file);
             code = stream.readAll().toStdString();
         }else{
-            throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
+            throw std::runtime_error(std::string("Failed to open shader: ")+getFilePath(filepath));
+        }
+
+        // defines must follow #version, and #line keeps error messages pointing at the file's own lines
+        if (!defines.empty()){
+            size_t version = code.find("#version");
+            size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+            if (lineEnd != std::string::npos){
+                code.insert(lineEnd + 1, defines + "#line 2\n");
+            }
         }
 
-        // Compile shader code.
+        return code;
+    }
+
+    static GLuint createShader(GLenum shaderType, const std::string &code){
+        GLuint shaderID = glCreateShader(shaderType);
+
+        // Compile shader code. The compile status is only checked once the program is linked,
+        // so parallel compiles aren't waited for one by one
         const char *codePtr = code.c_str();
         glShaderSource(shaderID, 1, &codePtr, nullptr); // Assumes code is null terminated
         glCompileShader(shaderID);
 
-        // Print info log if shader fails to compile.
-        GLint status;
-        glGetShaderiv(shaderID, GL_COMPILE_STATUS, &status);
-
-        if (status == GL_FALSE) {
-            GLint length;
-            glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &length);
+        return shaderID;
+    }
 
-            std::string log(length, '\0');
-            glGetShaderInfoLog(shaderID, length, nullptr, &log[0]);
+    static inline std::string m_sourceDirectory;
 
-            glDeleteShader(shaderID);
-            throw std::runtime_error(log);
+    // The info log of a shader that failed to compile, empty if it compiled
+    static std::string getShaderLog(GLuint shaderID){
+        GLint status;
+        glGetShaderiv(shaderID, GL_COMPILE_STATUS, &status);
+        if (status == GL_TRUE) {
+            return "";
         }
 
-        return shaderID;
+        GLint length;
+        glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &length);
+
+        std::string log(length, '\0');
+        glGetShaderInfoLog(shaderID, length, nullptr, &log[0]);
+        return log;
     }
 };
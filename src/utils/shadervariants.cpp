@@ -0,0 +1,218 @@
+#include "shadervariants.h"
+
+#include <iostream>
+
+ShaderVariants::ShaderVariants(const char *vertex_file_path, std::initializer_list<const char *> fragment_file_paths)
+    : m_vertexPath(vertex_file_path)
+{
+    for (const char *fragment_file_path : fragment_file_paths){
+        m_fragmentPaths.push_back(fragment_file_path);
+    }
+}
+
+std::string ShaderVariants::getKey(const ShaderDefines &defines){
+    std::string key;
+    for (const auto &[name, value] : defines){
+        if (!key.empty()){
+            key += ';';
+        }
+        key += name + '=' + std::to_string(value);
+    }
+    return key;
+}
+
+/**
+ * @brief Starts compiling the permutation with key into pending
+ */
+void ShaderVariants::submit(const std::string &key, std::unordered_map<std::string, PendingProgram> &pending){
+    std::vector<const char *> fragmentPaths;
+    for (const std::string &path : m_fragmentPaths){
+        fragmentPaths.push_back(path.c_str());
+    }
+
+    pending[key] = ShaderLoader::beginShaderProgram(m_vertexPath.c_str(), fragmentPaths, m_defineSources[key]);
+}
+
+/**
+ * @brief Deletes a program that is no longer needed while it may still be compiling
+ */
+void ShaderVariants::discard(PendingProgram &pending){
+    for (GLuint shader : pending.shaders){
+        glDeleteShader(shader);
+    }
+    glDeleteProgram(pending.program);
+}
+
+void ShaderVariants::request(const ShaderDefines &defines){
+    std::string key = getKey(defines);
+    if (m_programs.count(key) || m_pending.count(key) || m_failed.count(key)){
+        return;
+    }
+
+    std::string source;
+    for (const auto &[name, value] : defines){
+        source += "#define " + name + " " + std::to_string(value) + "\n";
+    }
+    m_defineSources[key] = source;
+
+    // a source file can be missing for a moment while hot reload's editor replaces it
+    try {
+        submit(key, m_pending);
+    } catch (const std::runtime_error &error) {
+        std::cerr << "Compiling " << m_fragmentPaths.front() << " [" << key << "] failed:\n" << error.what() << std::endl;
+        m_failed.insert(key);
+    }
+}
+
+/**
+ * @brief Moves a requested permutation into m_programs, waiting for the driver if it isn't done.
+ *        A permutation that fails to compile is reported and remembered as failed
+ * @return The program, 0 if it failed or was never requested
+ */
+GLuint ShaderVariants::finish(const std::string &key){
+    auto pending = m_pending.find(key);
+    if (pending == m_pending.end()){
+        return 0;
+    }
+
+    qint64 nsecs = pending->second.timer.nsecsElapsed();
+    GLuint program;
+    try {
+        program = ShaderLoader::finishShaderProgram(pending->second);
+    } catch (const std::runtime_error &error) {
+        std::cerr << "Compiling " << m_fragmentPaths.front() << " [" << key << "] failed:\n" << error.what() << std::endl;
+        m_pending.erase(pending);
+        m_failed.insert(key);
+        return 0;
+    }
+    m_pending.erase(pending);
+
+    std::cout << "Created " << m_fragmentPaths.front() << " [" << key << "] in " << nsecs / 1e6 << " ms" << std::endl;
+    m_programs[key] = program;
+    return program;
+}
+
+/**
+ * @brief Swaps in a reloaded permutation once it is ready, or right away when wait is set.
+ *        A permutation that fails to compile is reported and the old program stays
+ * @return The permutation's current program
+ */
+GLuint ShaderVariants::checkReload(const std::string &key, bool wait){
+    GLuint &program = m_programs[key];
+    auto reloading = m_reloading.find(key);
+    if (reloading == m_reloading.end() || (!wait && !ShaderLoader::isProgramReady(reloading->second))){
+        return program;
+    }
+
+    try {
+        GLuint reloaded = ShaderLoader::finishShaderProgram(reloading->second);
+        glDeleteProgram(program);
+        program = reloaded;
+        std::cout << "Reloaded " << m_fragmentPaths.front() << " [" << key << "]" << std::endl;
+    } catch (const std::runtime_error &error) {
+        std::cerr << "Reloading " << m_fragmentPaths.front() << " [" << key << "] failed, keeping the old program:\n"
+                  << error.what() << std::endl;
+    }
+    m_reloading.erase(reloading);
+    return program;
+}
+
+GLuint ShaderVariants::get(const ShaderDefines &defines){
+    std::string key = getKey(defines);
+    if (m_programs.count(key)){
+        return checkReload(key, false);
+    }
+
+    request(defines);
+    return finish(key);
+}
+
+GLuint ShaderVariants::poll(const ShaderDefines &defines){
+    std::string key = getKey(defines);
+    if (m_programs.count(key)){
+        return checkReload(key, false);
+    }
+
+    request(defines);
+    auto pending = m_pending.find(key);
+    if (pending == m_pending.end() || !ShaderLoader::isProgramReady(pending->second)){
+        return 0;
+    }
+    return finish(key);
+}
+
+bool ShaderVariants::hasFailed(const ShaderDefines &defines) const {
+    return m_failed.count(getKey(defines)) > 0;
+}
+
+bool ShaderVariants::reload(const std::string &filepath){
+    bool used = ShaderLoader::getFilePath(m_vertexPath) == filepath;
+    for (const std::string &path : m_fragmentPaths){
+        used |= ShaderLoader::getFilePath(path) == filepath;
+    }
+    if (!used){
+        return false;
+    }
+
+    // reloads, requests still compiling and requests that failed on the previous version of the file start over
+    std::vector<std::string> keys;
+    for (auto &[key, program] : m_programs){
+        keys.push_back(key);
+    }
+    for (auto &[key, pending] : m_pending){
+        discard(pending);
+    }
+    for (auto &[key, pending] : m_reloading){
+        discard(pending);
+    }
+    std::vector<std::string> pendingKeys(m_failed.begin(), m_failed.end());
+    for (auto &[key, pending] : m_pending){
+        pendingKeys.push_back(key);
+    }
+    m_pending.clear();
+    m_reloading.clear();
+    m_failed.clear();
+
+    try {
+        for (const std::string &key : keys){
+            submit(key, m_reloading);
+        }
+        for (const std::string &key : pendingKeys){
+            submit(key, m_pending);
+        }
+    } catch (const std::runtime_error &error) {
+        // the file may be missing for a moment while an editor replaces it. Requests left out are made
+        // again by the next get() or poll(), and the watcher reloads once the file is back
+        std::cerr << error.what() << std::endl;
+    }
+    return true;
+}
+
+bool ShaderVariants::swapReloaded(){
+    std::vector<std::string> keys;
+    for (auto &[key, pending] : m_reloading){
+        keys.push_back(key);
+    }
+    for (const std::string &key : keys){
+        checkReload(key, false);
+    }
+    return !m_reloading.empty();
+}
+
+void ShaderVariants::destroy(){
+    for (auto &[key, program] : m_programs){
+        glDeleteProgram(program);
+    }
+    m_programs.clear();
+
+    for (auto &[key, pending] : m_pending){
+        discard(pending);
+    }
+    m_pending.clear();
+
+    for (auto &[key, reloading] : m_reloading){
+        discard(reloading);
+    }
+    m_reloading.clear();
+    m_failed.clear();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include "shaderloader.h"
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Compile time constants of a shader variant, each becoming a #define NAME VALUE
+using ShaderDefines = std::map<std::string, int>;
+
+// Permutations of one shader program, specialized with #defines instead of branching on uniforms.
+// Each permutation is compiled the first time it is asked for and kept until destroy(). Permutations
+// can be requested ahead of time and polled, so drawing never has to wait on the compiler.
+// A permutation that fails to compile is reported once and not tried again until its sources are reloaded
+class ShaderVariants {
+public:
+    ShaderVariants(const char *vertex_file_path, std::initializer_list<const char *> fragment_file_paths);
+
+    // Returns the program built with defines, compiling it if no earlier call asked for the same ones.
+    // 0 if it failed to compile
+    GLuint get(const ShaderDefines &defines);
+
+    // Starts compiling the permutation in the background, unless it is compiled, compiling or failed already
+    void request(const ShaderDefines &defines);
+
+    // Returns the permutation if it is ready to draw with, or 0 while it is still compiling or if it failed.
+    // Requests it if needed
+    GLuint poll(const ShaderDefines &defines);
+
+    // Whether the permutation failed to compile from the current sources, so polling it again won't help
+    bool hasFailed(const ShaderDefines &defines) const;
+
+    // Recompiles every compiled permutation that reads filepath (as ShaderLoader::getFilePath() names it)
+    // in the background. Each keeps drawing with its old program until its new one is ready, and keeps
+    // the old one if the new one fails. Permutations that failed before are compiled again too.
+    // Returns whether any permutation reads the file
+    bool reload(const std::string &filepath);
+
+    // Swaps in the reloaded permutations that are ready. Returns whether any are still compiling
+    bool swapReloaded();
+
+    // Deletes every compiled permutation, needs the GL context
+    void destroy();
+
+    // Identifies a permutation, e.g. "FILTER_MODE=1;SAMPLES=4", the same for equal defines
+    static std::string getKey(const ShaderDefines &defines);
+
+private:
+    std::string m_vertexPath;
+    std::vector<std::string> m_fragmentPaths;
+    GLuint finish(const std::string &key);
+    void submit(const std::string &key, std::unordered_map<std::string, PendingProgram> &pending);
+    static void discard(PendingProgram &pending);
+    GLuint checkReload(const std::string &key, bool wait);
+
+    std::unordered_map<std::string, std::string> m_defineSources;   // #define lines of each permutation
+    std::unordered_map<std::string, GLuint> m_programs;
+    std::unordered_map<std::string, PendingProgram> m_pending;
+    std::unordered_map<std::string, PendingProgram> m_reloading;    // replacements of programs in m_programs
+    std::unordered_set<std::string> m_failed;                       // failed to compile from the current sources
+};
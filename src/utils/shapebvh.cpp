@@ -0,0 +1,326 @@
+#include "shapebvh.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <iostream>
+#include <QElapsedTimer>
+
+namespace {
+
+constexpr int SAH_BINS = 16;
+constexpr size_t MAX_LEAF_SHAPES = 4;
+constexpr int MAX_DEPTH = 64;               // the traversal stack holds one entry per level
+
+// Relative cost of testing a shape against traversing a node, for the SAH
+constexpr float SHAPE_COST = 2.f;
+constexpr float NODE_COST = 1.f;
+
+float getArea(const glm::vec3 &min, const glm::vec3 &max) {
+    glm::vec3 extent = glm::max(max - min, glm::vec3(0.f));
+    return 2.f * (extent.x*extent.y + extent.y*extent.z + extent.z*extent.x);
+}
+
+// Entry t of the ray into [min, max] clipped to (tMin, tMax), false if it misses
+bool intersectBounds(const glm::vec3 &min, const glm::vec3 &max, const Ray &ray, const glm::vec3 &inverseDirection,
+                     float tMin, float tMax, float &tEntry) {
+    glm::vec3 t0 = (min - ray.origin) * inverseDirection;
+    glm::vec3 t1 = (max - ray.origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+    float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return tEntry <= tExit;
+}
+
+}
+
+/**
+ * @brief Computes every shape's world bounds from its object bounds, then builds the hierarchy top down
+ */
+void ShapeBVH::build(const std::vector<RenderShapeData> &shapes, const std::unordered_map<std::string, MeshBounds> &meshBounds){
+    m_nodes.clear();
+    m_shapes.clear();
+
+    std::vector<Shape> unordered;
+    unordered.reserve(shapes.size());
+    for (uint32_t i = 0; i < shapes.size(); i++){
+        const RenderShapeData &shape = shapes[i];
+        Shape entry{shape.inverse_ctm, glm::vec3(-0.5f), glm::vec3(0.5f), shape.type, i};
+        if (shape.type == PrimitiveType::PRIMITIVE_MESH){
+            auto bounds = meshBounds.find(shape.meshfile);
+            if (bounds == meshBounds.end()){
+                continue;
+            }
+            entry.meshMin = bounds->second.min;
+            entry.meshMax = bounds->second.max;
+        }
+        unordered.push_back(entry);
+    }
+    if (unordered.empty()){
+        return;
+    }
+
+    // world bounds of the transformed object bounds, from their center and the ctm's absolute 3x3
+    constexpr int CHUNK_SIZE = 4096;
+    std::vector<BuildShape> buildShapes(unordered.size());
+    Parallel::forEach((unordered.size() + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](int chunk){
+        size_t end = std::min(unordered.size(), size_t(chunk + 1) * CHUNK_SIZE);
+        for (size_t i = size_t(chunk) * CHUNK_SIZE; i < end; i++){
+            const Shape &shape = unordered[i];
+            const glm::mat4 &ctm = shapes[shape.index].ctm;
+            glm::vec3 center = glm::vec3(ctm * glm::vec4(0.5f*(shape.meshMin + shape.meshMax), 1.f));
+            glm::mat3 absolute = glm::mat3(glm::abs(ctm[0]), glm::abs(ctm[1]), glm::abs(ctm[2]));
+            glm::vec3 extent = absolute * (0.5f*(shape.meshMax - shape.meshMin));
+            buildShapes[i] = {center - extent, center + extent, center, uint32_t(i)};
+        }
+    });
+
+    m_nodes.reserve(2 * buildShapes.size() / MAX_LEAF_SHAPES + 1);
+    m_shapes.reserve(unordered.size());
+    buildNode(buildShapes, 0, buildShapes.size(), 0);
+
+    // leaves reference shapes by their position in unordered so far
+    for (Shape &shape : m_shapes){
+        shape = unordered[shape.index];
+    }
+}
+
+/**
+ * @brief Builds the subtree over shapes[begin, end) depth first, so a node's first child follows it.
+ *        Splits at the cheapest of SAH_BINS planes along the widest axis of the centroids
+ * @return the subtree's root index in m_nodes
+ */
+uint32_t ShapeBVH::buildNode(std::vector<BuildShape> &shapes, size_t begin, size_t end, int depth){
+    uint32_t nodeIndex = m_nodes.size();
+    m_nodes.emplace_back();
+
+    glm::vec3 min(INFINITY), max(-INFINITY), centroidMin(INFINITY), centroidMax(-INFINITY);
+    for (size_t i = begin; i < end; i++){
+        min = glm::min(min, shapes[i].min);
+        max = glm::max(max, shapes[i].max);
+        centroidMin = glm::min(centroidMin, shapes[i].centroid);
+        centroidMax = glm::max(centroidMax, shapes[i].centroid);
+    }
+    m_nodes[nodeIndex].min = min;
+    m_nodes[nodeIndex].max = max;
+
+    auto makeLeaf = [&](){
+        m_nodes[nodeIndex].offset = m_shapes.size();
+        m_nodes[nodeIndex].count = end - begin;
+        for (size_t i = begin; i < end; i++){
+            m_shapes.push_back({glm::mat4(1.f), glm::vec3(0.f), glm::vec3(0.f), PrimitiveType::PRIMITIVE_CUBE, shapes[i].index});
+        }
+        return nodeIndex;
+    };
+
+    size_t count = end - begin;
+    if (count <= MAX_LEAF_SHAPES || depth >= MAX_DEPTH - 1){
+        return makeLeaf();
+    }
+
+    glm::vec3 centroidExtent = centroidMax - centroidMin;
+    int axis = centroidExtent.x > centroidExtent.y ? (centroidExtent.x > centroidExtent.z ? 0 : 2)
+                                                   : (centroidExtent.y > centroidExtent.z ? 1 : 2);
+
+    size_t mid;
+    if (centroidExtent[axis] <= 0.f){
+        // coincident centroids, halved so the tree stays balanced
+        mid = begin + count/2;
+    } else {
+        struct Bin {
+            glm::vec3 min = glm::vec3(INFINITY);
+            glm::vec3 max = glm::vec3(-INFINITY);
+            size_t count = 0;
+        };
+        Bin bins[SAH_BINS];
+        float binScale = SAH_BINS / centroidExtent[axis];
+        auto getBin = [&](const BuildShape &shape){
+            return std::min(SAH_BINS - 1, int((shape.centroid[axis] - centroidMin[axis]) * binScale));
+        };
+        for (size_t i = begin; i < end; i++){
+            Bin &bin = bins[getBin(shapes[i])];
+            bin.min = glm::min(bin.min, shapes[i].min);
+            bin.max = glm::max(bin.max, shapes[i].max);
+            bin.count++;
+        }
+
+        // sweeps from the right to get the area of everything right of each plane, then from the left
+        float rightArea[SAH_BINS];
+        size_t rightCount[SAH_BINS];
+        Bin sweep;
+        for (int b = SAH_BINS - 1; b > 0; b--){
+            sweep.min = glm::min(sweep.min, bins[b].min);
+            sweep.max = glm::max(sweep.max, bins[b].max);
+            sweep.count += bins[b].count;
+            rightArea[b] = getArea(sweep.min, sweep.max);
+            rightCount[b] = sweep.count;
+        }
+
+        int bestPlane = -1;
+        float bestCost = INFINITY;
+        sweep = Bin();
+        for (int b = 1; b < SAH_BINS; b++){
+            sweep.min = glm::min(sweep.min, bins[b - 1].min);
+            sweep.max = glm::max(sweep.max, bins[b - 1].max);
+            sweep.count += bins[b - 1].count;
+            if (sweep.count == 0 || rightCount[b] == 0){
+                continue;
+            }
+            float cost = getArea(sweep.min, sweep.max) * sweep.count + rightArea[b] * rightCount[b];
+            if (cost < bestCost){
+                bestCost = cost;
+                bestPlane = b;
+            }
+        }
+
+        float leafCost = SHAPE_COST * count;
+        float splitCost = NODE_COST + SHAPE_COST * bestCost / getArea(min, max);
+        if (bestPlane < 0 || (splitCost >= leafCost && count <= 4*MAX_LEAF_SHAPES)){
+            return makeLeaf();
+        }
+
+        auto split = std::partition(shapes.begin() + begin, shapes.begin() + end,
+                                    [&](const BuildShape &shape){ return getBin(shape) < bestPlane; });
+        mid = split - shapes.begin();
+    }
+
+    buildNode(shapes, begin, mid, depth + 1);
+    uint32_t second = buildNode(shapes, mid, end, depth + 1);
+    m_nodes[nodeIndex].offset = second;
+    m_nodes[nodeIndex].count = 0;
+    return nodeIndex;
+}
+
+/**
+ * @brief Tests one shape in its object space, updating hit if it is nearer than hit.t
+ */
+bool ShapeBVH::intersectShape(const Shape &shape, const Ray &ray, float tMin, Hit &hit) const {
+    Ray objectRay{glm::vec3(shape.inverseCtm * glm::vec4(ray.origin, 1.f)),
+                  glm::vec3(shape.inverseCtm * glm::vec4(ray.direction, 0.f))};
+    ShapeHit shapeHit;
+    if (!ShapeIntersect::intersect(shape.type, objectRay, tMin, hit.t, shapeHit, shape.meshMin, shape.meshMax)){
+        return false;
+    }
+
+    // normals transform by the inverse transpose of the ctm
+    hit.shape = shape.index;
+    hit.t = shapeHit.t;
+    hit.normal = glm::normalize(glm::transpose(glm::mat3(shape.inverseCtm)) * shapeHit.normal);
+    return true;
+}
+
+/**
+ * @brief Walks the hierarchy nearest child first, skipping nodes that start beyond the nearest hit so far.
+ *        With AnyHit, returns at the first hit instead of looking for a nearer one
+ */
+template <bool AnyHit>
+bool ShapeBVH::traverse(const Ray &ray, Hit &hit, float tMin, float tMax) const {
+    hit = Hit();
+    hit.t = tMax;
+
+    float tEntry;
+    glm::vec3 inverseDirection = 1.f / ray.direction;
+    if (m_nodes.empty() || !intersectBounds(m_nodes[0].min, m_nodes[0].max, ray, inverseDirection, tMin, hit.t, tEntry)){
+        return false;
+    }
+
+    struct Entry {
+        uint32_t node;
+        float tEntry;
+    };
+    Entry stack[MAX_DEPTH];
+    int top = 0;
+    stack[top++] = {0, tEntry};
+
+    while (top > 0){
+        Entry entry = stack[--top];
+        if (entry.tEntry >= hit.t){
+            continue;
+        }
+
+        const Node *node = &m_nodes[entry.node];
+        while (node->count == 0){
+            uint32_t first = entry.node + 1, second = node->offset;
+            float tFirst, tSecond;
+            bool hitFirst = intersectBounds(m_nodes[first].min, m_nodes[first].max, ray, inverseDirection, tMin, hit.t, tFirst);
+            bool hitSecond = intersectBounds(m_nodes[second].min, m_nodes[second].max, ray, inverseDirection, tMin, hit.t, tSecond);
+
+            if (hitFirst && hitSecond){
+                if (tSecond < tFirst){
+                    std::swap(first, second);
+                    std::swap(tFirst, tSecond);
+                }
+                stack[top++] = {second, tSecond};
+                entry = {first, tFirst};
+            } else if (hitFirst){
+                entry = {first, tFirst};
+            } else if (hitSecond){
+                entry = {second, tSecond};
+            } else {
+                break;
+            }
+            node = &m_nodes[entry.node];
+        }
+
+        for (uint32_t i = 0; i < node->count; i++){
+            if (intersectShape(m_shapes[node->offset + i], ray, tMin, hit) && AnyHit){
+                return true;
+            }
+        }
+    }
+    return hit.shape >= 0;
+}
+
+bool ShapeBVH::intersect(const Ray &ray, Hit &hit, float tMin, float tMax) const {
+    return traverse<false>(ray, hit, tMin, tMax);
+}
+
+bool ShapeBVH::occluded(const Ray &ray, float tMin, float tMax) const {
+    Hit hit;
+    return traverse<true>(ray, hit, tMin, tMax);
+}
+
+bool ShapeBVH::intersectBruteForce(const Ray &ray, Hit &hit, float tMin, float tMax) const {
+    hit = Hit();
+    hit.t = tMax;
+    for (const Shape &shape : m_shapes){
+        intersectShape(shape, ray, tMin, hit);
+    }
+    return hit.shape >= 0;
+}
+
+/**
+ * @brief Times every ray through the hierarchy, and as many rays testing every shape as take about
+ *        as long as 20M shape tests
+ */
+void ShapeBVH::benchmark(const std::vector<Ray> &rays) const {
+    if (m_shapes.empty() || rays.empty()){
+        return;
+    }
+
+    Hit hit;
+    int hits = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const Ray &ray : rays){
+        hits += intersect(ray, hit);
+    }
+    qint64 bvhNsecs = std::max<qint64>(1, timer.nsecsElapsed());
+
+    size_t bruteRays = std::clamp<size_t>(20000000 / m_shapes.size(), 1, rays.size());
+    int bruteHits = 0, bvhBruteHits = 0;
+    timer.start();
+    for (size_t i = 0; i < bruteRays; i++){
+        bruteHits += intersectBruteForce(rays[i], hit);
+    }
+    qint64 bruteNsecs = std::max<qint64>(1, timer.nsecsElapsed());
+    for (size_t i = 0; i < bruteRays; i++){
+        bvhBruteHits += intersect(rays[i], hit);
+    }
+
+    std::cout << "Picking over " << m_shapes.size() << " shapes (" << m_nodes.size() << " BVH nodes): "
+              << rays.size() * 1e9 / bvhNsecs << " picks/s with the BVH, "
+              << bruteRays * 1e9 / bruteNsecs << " picks/s testing every shape"
+              << " (" << hits << "/" << rays.size() << " rays hit"
+              << (bruteHits == bvhBruteHits ? "" : ", BVH and brute force disagree") << ")" << std::endl;
+}
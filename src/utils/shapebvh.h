@@ -0,0 +1,94 @@
+#pragma once
+
+#include "sceneparser.h"
+#include "shapeintersect.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Object space bounds of a mesh file's vertices
+struct MeshBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Bounding volume hierarchy over a scene's shapes for ray queries on the CPU. Leaves hold shapes, each
+// tested analytically in its object space through its inverse ctm, so no tesselation is involved
+class ShapeBVH {
+public:
+    // Nearest shape along a ray
+    struct Hit {
+        int shape = -1;         // index into the shapes the BVH was built from, -1 if nothing was hit
+        float t = INFINITY;     // ray parameter, the distance for a normalized direction
+        glm::vec3 normal;       // world space, normalized
+    };
+
+    // Rebuilds the hierarchy over shapes with binned SAH splits. Meshes are tested against the bounds
+    // meshBounds has for their file, meshes missing from it are left out
+    void build(const std::vector<RenderShapeData> &shapes, const std::unordered_map<std::string, MeshBounds> &meshBounds = {});
+
+    // Finds the nearest shape hit with t in (tMin, tMax)
+    bool intersect(const Ray &ray, Hit &hit, float tMin = 0.f, float tMax = INFINITY) const;
+
+    // Whether any shape is hit with t in (tMin, tMax), stopping at the first one found. For shadow rays
+    bool occluded(const Ray &ray, float tMin, float tMax) const;
+
+    // Rays intersectPacket() traces together, one per AVX2 lane
+    static constexpr int PACKET_SIZE = 8;
+
+    // Finds the nearest hit of each of count <= PACKET_SIZE rays like intersect(), walking the hierarchy
+    // once for all of them: a node is visited if any ray reaches it, and the slab tests and the sphere,
+    // cube, cylinder and cone tests run on all rays at once with AVX2. Pays off for coherent rays such as
+    // neighbouring pixels' primary rays. Without AVX2 this calls intersect() per ray
+    void intersectPacket(const Ray *rays, int count, Hit *hits, float tMin = 0.f) const;
+
+    // Whether intersectPacket() runs the AVX2 kernel on this build and CPU
+    static bool hasPacketSIMD();
+
+    // Tests every shape in turn, for comparison with intersect()
+    bool intersectBruteForce(const Ray &ray, Hit &hit, float tMin = 0.f, float tMax = INFINITY) const;
+
+    size_t size() const { return m_shapes.size(); }
+    bool empty() const { return m_shapes.empty(); }
+
+    // Times intersect() and intersectBruteForce() on rays and prints picks per second of each
+    void benchmark(const std::vector<Ray> &rays) const;
+
+private:
+    // 32 bytes, two to a cache line. The first child of an interior node directly follows it
+    struct Node {
+        glm::vec3 min;
+        uint32_t offset;        // first entry of m_shapes for a leaf, second child for an interior node
+        glm::vec3 max;
+        uint32_t count;         // shapes in a leaf, 0 for an interior node
+    };
+
+    // What a leaf test needs of a shape, in leaf order
+    struct Shape {
+        glm::mat4 inverseCtm;
+        glm::vec3 meshMin;      // object space bounds, only used by meshes
+        glm::vec3 meshMax;
+        PrimitiveType type;
+        uint32_t index;         // into the shapes the BVH was built from
+    };
+
+    // Construction input: world bounds and centroid of each shape
+    struct BuildShape {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::vec3 centroid;
+        uint32_t index;
+    };
+
+    uint32_t buildNode(std::vector<BuildShape> &shapes, size_t begin, size_t end, int depth);
+    template <bool AnyHit>
+    bool traverse(const Ray &ray, Hit &hit, float tMin, float tMax) const;
+    bool intersectShape(const Shape &shape, const Ray &ray, float tMin, Hit &hit) const;
+    void traversePacket(const Ray *rays, int count, Hit *hits, float tMin) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Shape> m_shapes;
+};
@@ -0,0 +1,363 @@
+#include "shapebvh.h"
+
+#include <algorithm>
+
+// The AVX2 kernel is compiled for x86-64 only, through target attributes rather than build flags, so the
+// rest of the program still runs on CPUs without AVX2 and hasPacketSIMD() picks the kernel at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define SHAPEBVH_PACKET_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#else
+#define SHAPEBVH_PACKET_SIMD 0
+#endif
+
+#if SHAPEBVH_PACKET_SIMD
+namespace {
+
+constexpr int MAX_DEPTH = 64;
+
+// PACKET_SIZE rays, one per lane
+struct PacketRays {
+    __m256 ox, oy, oz;
+    __m256 dx, dy, dz;
+};
+
+// Candidate t of every lane where valid, kept where it is in (tMin, tNearest) as the nearest so far
+AVX2_TARGET inline void keepNearest(__m256 t, __m256 valid, __m256 tMin, __m256 &tNearest, __m256 &found) {
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, tMin, _CMP_GT_OQ), _mm256_cmp_ps(t, tNearest, _CMP_LT_OQ)));
+    tNearest = _mm256_blendv_ps(tNearest, t, valid);
+    found = _mm256_or_ps(found, valid);
+}
+
+// Lanes whose ray enters [min, max] before tExit, with their entry t
+AVX2_TARGET inline __m256 intersectBounds(const glm::vec3 &min, const glm::vec3 &max, const PacketRays &rays,
+                                          const PacketRays &inverse, __m256 tMin, __m256 tExit, __m256 &tEntry) {
+    __m256 x0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(min.x), rays.ox), inverse.dx);
+    __m256 x1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(max.x), rays.ox), inverse.dx);
+    __m256 y0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(min.y), rays.oy), inverse.dy);
+    __m256 y1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(max.y), rays.oy), inverse.dy);
+    __m256 z0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(min.z), rays.oz), inverse.dz);
+    __m256 z1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(max.z), rays.oz), inverse.dz);
+
+    tEntry = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(x0, x1), _mm256_min_ps(y0, y1)),
+                           _mm256_max_ps(_mm256_min_ps(z0, z1), tMin));
+    tExit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(y0, y1)),
+                          _mm256_min_ps(_mm256_max_ps(z0, z1), tExit));
+    return _mm256_cmp_ps(tEntry, tExit, _CMP_LE_OQ);
+}
+
+// Both roots of a*t^2 + 2*halfB*t + c given the discriminant halfB^2 - a*c, lower first, and the lanes
+// that have real ones. Solved like ShapeIntersect::solveQuadratic() so both agree on grazing rays
+AVX2_TARGET inline __m256 solveQuadratic(__m256 a, __m256 halfB, __m256 c, __m256 discriminant, __m256 &t0, __m256 &t1) {
+    __m256 valid = _mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GE_OQ);
+    __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, _mm256_setzero_ps()));
+    __m256 sign = _mm256_and_ps(halfB, _mm256_set1_ps(-0.f));
+    __m256 q = _mm256_xor_ps(_mm256_add_ps(halfB, _mm256_or_ps(root, sign)), _mm256_set1_ps(-0.f));
+    __m256 r0 = _mm256_div_ps(q, a);
+    __m256 r1 = _mm256_div_ps(c, q);
+    t0 = _mm256_min_ps(r0, r1);
+    t1 = _mm256_max_ps(r0, r1);
+    return valid;
+}
+
+// halfB^2 - a*c against a circle of radius 0.5 around the origin in the plane of the given axes,
+// see ShapeIntersect::getDiscriminant()
+AVX2_TARGET inline __m256 getDiscriminant(__m256 ox, __m256 oy, __m256 oz, __m256 dx, __m256 dy, __m256 dz,
+                                          __m256 a, __m256 halfB) {
+    __m256 scale = _mm256_div_ps(halfB, a);
+    __m256 x = _mm256_fnmadd_ps(scale, dx, ox);
+    __m256 y = _mm256_fnmadd_ps(scale, dy, oy);
+    __m256 z = _mm256_fnmadd_ps(scale, dz, oz);
+    __m256 distance2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+    return _mm256_mul_ps(a, _mm256_sub_ps(_mm256_set1_ps(0.25f), distance2));
+}
+
+AVX2_TARGET inline __m256 absolute(__m256 x) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.f), x);
+}
+
+// Lanes where the point at t along the ray has |y| <= 0.5
+AVX2_TARGET inline __m256 withinHeight(const PacketRays &rays, __m256 t) {
+    __m256 y = _mm256_fmadd_ps(t, rays.dy, rays.oy);
+    return _mm256_cmp_ps(absolute(y), _mm256_set1_ps(0.5f), _CMP_LE_OQ);
+}
+
+// Lanes where the point at t along the ray lies within radius 0.5 of the y axis, for the caps
+AVX2_TARGET inline __m256 withinCap(const PacketRays &rays, __m256 t) {
+    __m256 x = _mm256_fmadd_ps(t, rays.dx, rays.ox);
+    __m256 z = _mm256_fmadd_ps(t, rays.dz, rays.oz);
+    __m256 r2 = _mm256_fmadd_ps(x, x, _mm256_mul_ps(z, z));
+    return _mm256_cmp_ps(r2, _mm256_set1_ps(0.25f), _CMP_LE_OQ);
+}
+
+// The packet versions of ShapeIntersect's tests, object space rays in, nearest t so far updated
+
+AVX2_TARGET inline void intersectSphere(const PacketRays &rays, __m256 tMin, __m256 &t, __m256 &found) {
+    __m256 a = _mm256_fmadd_ps(rays.dx, rays.dx, _mm256_fmadd_ps(rays.dy, rays.dy, _mm256_mul_ps(rays.dz, rays.dz)));
+    __m256 halfB = _mm256_fmadd_ps(rays.ox, rays.dx, _mm256_fmadd_ps(rays.oy, rays.dy, _mm256_mul_ps(rays.oz, rays.dz)));
+    __m256 c = _mm256_fmadd_ps(rays.ox, rays.ox, _mm256_fmadd_ps(rays.oy, rays.oy, _mm256_mul_ps(rays.oz, rays.oz)));
+    c = _mm256_sub_ps(c, _mm256_set1_ps(0.25f));
+    __m256 discriminant = getDiscriminant(rays.ox, rays.oy, rays.oz, rays.dx, rays.dy, rays.dz, a, halfB);
+
+    __m256 t0, t1;
+    __m256 valid = solveQuadratic(a, halfB, c, discriminant, t0, t1);
+    keepNearest(t1, valid, tMin, t, found);
+    keepNearest(t0, valid, tMin, t, found);
+}
+
+AVX2_TARGET inline void intersectCube(const PacketRays &rays, const PacketRays &inverse, __m256 tMin, __m256 &t, __m256 &found) {
+    __m256 tEntry;
+    __m256 hit = intersectBounds(glm::vec3(-0.5f), glm::vec3(0.5f), rays, inverse, _mm256_set1_ps(-INFINITY), t, tEntry);
+
+    // a ray starting inside leaves through the far side
+    __m256 x0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(-0.5f), rays.ox), inverse.dx);
+    __m256 x1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), rays.ox), inverse.dx);
+    __m256 y0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(-0.5f), rays.oy), inverse.dy);
+    __m256 y1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), rays.oy), inverse.dy);
+    __m256 z0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(-0.5f), rays.oz), inverse.dz);
+    __m256 z1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), rays.oz), inverse.dz);
+    __m256 tExit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(y0, y1)), _mm256_max_ps(z0, z1));
+
+    keepNearest(tExit, hit, tMin, t, found);
+    keepNearest(tEntry, hit, tMin, t, found);
+}
+
+AVX2_TARGET inline void intersectCylinder(const PacketRays &rays, __m256 tMin, __m256 &t, __m256 &found) {
+    __m256 a = _mm256_fmadd_ps(rays.dx, rays.dx, _mm256_mul_ps(rays.dz, rays.dz));
+    __m256 halfB = _mm256_fmadd_ps(rays.ox, rays.dx, _mm256_mul_ps(rays.oz, rays.dz));
+    __m256 c = _mm256_sub_ps(_mm256_fmadd_ps(rays.ox, rays.ox, _mm256_mul_ps(rays.oz, rays.oz)), _mm256_set1_ps(0.25f));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 discriminant = getDiscriminant(rays.ox, zero, rays.oz, rays.dx, zero, rays.dz, a, halfB);
+
+    // rays along the axis never meet the side
+    __m256 t0, t1;
+    __m256 valid = _mm256_and_ps(solveQuadratic(a, halfB, c, discriminant, t0, t1), _mm256_cmp_ps(a, zero, _CMP_GT_OQ));
+    keepNearest(t1, _mm256_and_ps(valid, withinHeight(rays, t1)), tMin, t, found);
+    keepNearest(t0, _mm256_and_ps(valid, withinHeight(rays, t0)), tMin, t, found);
+
+    __m256 inverseDy = _mm256_div_ps(_mm256_set1_ps(1.f), rays.dy);
+    __m256 bottom = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(-0.5f), rays.oy), inverseDy);
+    __m256 top = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), rays.oy), inverseDy);
+    keepNearest(bottom, withinCap(rays, bottom), tMin, t, found);
+    keepNearest(top, withinCap(rays, top), tMin, t, found);
+}
+
+AVX2_TARGET inline void intersectCone(const PacketRays &rays, __m256 tMin, __m256 &t, __m256 &found) {
+    // solved from the point of each ray nearest the cone's center like ShapeIntersect::cone()
+    __m256 dd = _mm256_fmadd_ps(rays.dx, rays.dx, _mm256_fmadd_ps(rays.dy, rays.dy, _mm256_mul_ps(rays.dz, rays.dz)));
+    __m256 od = _mm256_fmadd_ps(rays.ox, rays.dx, _mm256_fmadd_ps(rays.oy, rays.dy, _mm256_mul_ps(rays.oz, rays.dz)));
+    __m256 shift = _mm256_xor_ps(_mm256_div_ps(od, dd), _mm256_set1_ps(-0.f));
+    __m256 nx = _mm256_fmadd_ps(shift, rays.dx, rays.ox);
+    __m256 ny = _mm256_fmadd_ps(shift, rays.dy, rays.oy);
+    __m256 nz = _mm256_fmadd_ps(shift, rays.dz, rays.oz);
+
+    __m256 quarter = _mm256_set1_ps(0.25f);
+    __m256 h = _mm256_sub_ps(_mm256_set1_ps(0.5f), ny);
+    __m256 a = _mm256_fnmadd_ps(_mm256_mul_ps(quarter, rays.dy), rays.dy,
+                                _mm256_fmadd_ps(rays.dx, rays.dx, _mm256_mul_ps(rays.dz, rays.dz)));
+    __m256 halfB = _mm256_fmadd_ps(_mm256_mul_ps(quarter, h), rays.dy,
+                                   _mm256_fmadd_ps(nx, rays.dx, _mm256_mul_ps(nz, rays.dz)));
+    __m256 c = _mm256_fnmadd_ps(_mm256_mul_ps(quarter, h), h, _mm256_fmadd_ps(nx, nx, _mm256_mul_ps(nz, nz)));
+    __m256 discriminant = _mm256_fmsub_ps(halfB, halfB, _mm256_mul_ps(a, c));
+
+    __m256 t0, t1;
+    __m256 valid = solveQuadratic(a, halfB, c, discriminant, t0, t1);
+    t0 = _mm256_add_ps(t0, shift);
+    t1 = _mm256_add_ps(t1, shift);
+    keepNearest(t1, _mm256_and_ps(valid, withinHeight(rays, t1)), tMin, t, found);
+    keepNearest(t0, _mm256_and_ps(valid, withinHeight(rays, t0)), tMin, t, found);
+
+    __m256 bottom = _mm256_div_ps(_mm256_sub_ps(_mm256_set1_ps(-0.5f), rays.oy), rays.dy);
+    keepNearest(bottom, withinCap(rays, bottom), tMin, t, found);
+}
+
+// Row of m times (x, y, z, w) in every lane
+AVX2_TARGET inline __m256 transform(const glm::mat4 &m, int row, __m256 x, __m256 y, __m256 z, float w) {
+    return _mm256_fmadd_ps(_mm256_set1_ps(m[0][row]), x,
+           _mm256_fmadd_ps(_mm256_set1_ps(m[1][row]), y,
+           _mm256_fmadd_ps(_mm256_set1_ps(m[2][row]), z, _mm256_set1_ps(m[3][row] * w))));
+}
+
+// Minimum of the lanes in mask, INFINITY if there are none
+AVX2_TARGET inline float getMinimum(__m256 values, __m256 mask) {
+    values = _mm256_blendv_ps(_mm256_set1_ps(INFINITY), values, mask);
+    values = _mm256_min_ps(values, _mm256_permute2f128_ps(values, values, 1));
+    values = _mm256_min_ps(values, _mm256_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    values = _mm256_min_ps(values, _mm256_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm256_cvtss_f32(values);
+}
+
+}
+
+/**
+ * @brief Walks the hierarchy once for the whole packet, visiting the child that the packet's rays enter
+ *        first first, and keeps per lane the nearest t and the m_shapes entry it belongs to. The normals
+ *        come from one scalar test per hit ray against its shape at the end
+ */
+AVX2_TARGET void ShapeBVH::traversePacket(const Ray *rays, int count, Hit *hits, float tMin) const {
+    alignas(32) float lanes[6][PACKET_SIZE];
+    alignas(32) float tLimit[PACKET_SIZE];
+    for (int lane = 0; lane < PACKET_SIZE; lane++){
+        // lanes past count repeat the first ray with nothing to find, so they never enter a node
+        const Ray &ray = rays[lane < count ? lane : 0];
+        lanes[0][lane] = ray.origin.x;
+        lanes[1][lane] = ray.origin.y;
+        lanes[2][lane] = ray.origin.z;
+        lanes[3][lane] = ray.direction.x;
+        lanes[4][lane] = ray.direction.y;
+        lanes[5][lane] = ray.direction.z;
+        tLimit[lane] = lane < count ? INFINITY : -INFINITY;
+    }
+
+    PacketRays packet{_mm256_load_ps(lanes[0]), _mm256_load_ps(lanes[1]), _mm256_load_ps(lanes[2]),
+                      _mm256_load_ps(lanes[3]), _mm256_load_ps(lanes[4]), _mm256_load_ps(lanes[5])};
+    __m256 one = _mm256_set1_ps(1.f);
+    PacketRays inverse{_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(),
+                       _mm256_div_ps(one, packet.dx), _mm256_div_ps(one, packet.dy), _mm256_div_ps(one, packet.dz)};
+    __m256 tMinimum = _mm256_set1_ps(tMin);
+    __m256 tNearest = _mm256_load_ps(tLimit);
+    __m256 nearestShape = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    __m256 tEntry;
+    uint32_t stack[MAX_DEPTH];
+    int top = 0;
+    if (!m_nodes.empty() && _mm256_movemask_ps(intersectBounds(m_nodes[0].min, m_nodes[0].max, packet, inverse,
+                                                               tMinimum, tNearest, tEntry))){
+        stack[top++] = 0;
+    }
+
+    while (top > 0){
+        uint32_t nodeIndex = stack[--top];
+        const Node *node = &m_nodes[nodeIndex];
+
+        while (node->count == 0){
+            uint32_t first = nodeIndex + 1, second = node->offset;
+            __m256 tFirst, tSecond;
+            __m256 hitFirst = intersectBounds(m_nodes[first].min, m_nodes[first].max, packet, inverse, tMinimum, tNearest, tFirst);
+            __m256 hitSecond = intersectBounds(m_nodes[second].min, m_nodes[second].max, packet, inverse, tMinimum, tNearest, tSecond);
+            bool anyFirst = _mm256_movemask_ps(hitFirst) != 0;
+            bool anySecond = _mm256_movemask_ps(hitSecond) != 0;
+
+            if (anyFirst && anySecond){
+                if (getMinimum(tSecond, hitSecond) < getMinimum(tFirst, hitFirst)){
+                    std::swap(first, second);
+                }
+                stack[top++] = second;
+                nodeIndex = first;
+            } else if (anyFirst){
+                nodeIndex = first;
+            } else if (anySecond){
+                nodeIndex = second;
+            } else {
+                break;
+            }
+            node = &m_nodes[nodeIndex];
+        }
+        if (node->count == 0){
+            continue;
+        }
+
+        for (uint32_t i = 0; i < node->count; i++){
+            uint32_t slot = node->offset + i;
+            const Shape &shape = m_shapes[slot];
+
+            // the packet in the shape's object space, the ctm's inverse broadcast to every lane
+            const glm::mat4 &m = shape.inverseCtm;
+            PacketRays object{transform(m, 0, packet.ox, packet.oy, packet.oz, 1.f),
+                              transform(m, 1, packet.ox, packet.oy, packet.oz, 1.f),
+                              transform(m, 2, packet.ox, packet.oy, packet.oz, 1.f),
+                              transform(m, 0, packet.dx, packet.dy, packet.dz, 0.f),
+                              transform(m, 1, packet.dx, packet.dy, packet.dz, 0.f),
+                              transform(m, 2, packet.dx, packet.dy, packet.dz, 0.f)};
+
+            __m256 found = _mm256_setzero_ps();
+            switch (shape.type){
+            case PrimitiveType::PRIMITIVE_SPHERE:
+                intersectSphere(object, tMinimum, tNearest, found);
+                break;
+            case PrimitiveType::PRIMITIVE_CUBE: {
+                PacketRays objectInverse{_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(),
+                                         _mm256_div_ps(one, object.dx), _mm256_div_ps(one, object.dy), _mm256_div_ps(one, object.dz)};
+                intersectCube(object, objectInverse, tMinimum, tNearest, found);
+                break;
+            }
+            case PrimitiveType::PRIMITIVE_CYLINDER:
+                intersectCylinder(object, tMinimum, tNearest, found);
+                break;
+            case PrimitiveType::PRIMITIVE_CONE:
+                intersectCone(object, tMinimum, tNearest, found);
+                break;
+            default: {
+                // the torus is sphere traced and meshes are rare, both are tested a lane at a time
+                alignas(32) float objectLanes[6][PACKET_SIZE], t[PACKET_SIZE];
+                alignas(32) int hit[PACKET_SIZE];
+                _mm256_store_ps(objectLanes[0], object.ox);
+                _mm256_store_ps(objectLanes[1], object.oy);
+                _mm256_store_ps(objectLanes[2], object.oz);
+                _mm256_store_ps(objectLanes[3], object.dx);
+                _mm256_store_ps(objectLanes[4], object.dy);
+                _mm256_store_ps(objectLanes[5], object.dz);
+                _mm256_store_ps(t, tNearest);
+                for (int lane = 0; lane < PACKET_SIZE; lane++){
+                    Ray objectRay{glm::vec3(objectLanes[0][lane], objectLanes[1][lane], objectLanes[2][lane]),
+                                  glm::vec3(objectLanes[3][lane], objectLanes[4][lane], objectLanes[5][lane])};
+                    ShapeHit shapeHit;
+                    hit[lane] = t[lane] > tMin && ShapeIntersect::intersect(shape.type, objectRay, tMin, t[lane], shapeHit,
+                                                                            shape.meshMin, shape.meshMax) ? -1 : 0;
+                    if (hit[lane]){
+                        t[lane] = shapeHit.t;
+                    }
+                }
+                tNearest = _mm256_load_ps(t);
+                found = _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i *>(hit)));
+                break;
+            }
+            }
+            nearestShape = _mm256_blendv_ps(nearestShape, _mm256_castsi256_ps(_mm256_set1_epi32(int(slot))), found);
+        }
+    }
+
+    alignas(32) int slots[PACKET_SIZE];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(slots), _mm256_castps_si256(nearestShape));
+    for (int lane = 0; lane < count; lane++){
+        hits[lane] = Hit();
+        if (slots[lane] >= 0){
+            intersectShape(m_shapes[slots[lane]], rays[lane], tMin, hits[lane]);
+        }
+    }
+}
+#endif
+
+void ShapeBVH::intersectPacket(const Ray *rays, int count, Hit *hits, float tMin) const {
+#if SHAPEBVH_PACKET_SIMD
+    if (hasPacketSIMD()){
+        traversePacket(rays, std::min(count, PACKET_SIZE), hits, tMin);
+        return;
+    }
+#endif
+    for (int i = 0; i < count; i++){
+        intersect(rays[i], hits[i], tMin);
+    }
+}
+
+bool ShapeBVH::hasPacketSIMD(){
+#if SHAPEBVH_PACKET_SIMD && defined(_MSC_VER) && !defined(__clang__)
+    static const bool supported = [](){
+        int registers[4];
+        __cpuidex(registers, 7, 0);
+        return (registers[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#elif SHAPEBVH_PACKET_SIMD
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "scenedata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// A ray, origin + t * direction. Direction need not be normalized: transformed into a shape's object
+// space it keeps the same t, so hits in different spaces compare directly
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Nearest intersection of a ray with a shape in its object space
+struct ShapeHit {
+    float t;
+    glm::vec3 normal;   // object space, not normalized
+};
+
+// Analytic ray intersections with the implicit primitives the shapes/ generators tesselate, in object
+// space where each fits the unit cube around the origin. Each returns the nearest hit with t in
+// (tMin, tMax), which is the exit point for a ray starting inside the shape
+namespace ShapeIntersect
+{
+    // Nearest root of a*t^2 + 2*halfB*t + c in (tMin, tMax) for which accept(t) holds, given the
+    // discriminant halfB^2 - a*c
+    template <typename Accept>
+    inline bool solveQuadratic(float a, float halfB, float c, float discriminant, float tMin, float tMax, float &t,
+                               Accept &&accept) {
+        if (std::abs(a) < 1e-12f) {
+            if (std::abs(halfB) < 1e-12f) {
+                return false;
+            }
+            t = -c / (2.f*halfB);
+            return t > tMin && t < tMax && accept(t);
+        }
+
+        if (discriminant < 0.f) {
+            return false;
+        }
+
+        // avoids the cancellation of -halfB + sqrt(discriminant) when halfB^2 dwarfs ac
+        float q = -(halfB + std::copysign(std::sqrt(discriminant), halfB));
+        float t0 = q / a;
+        float t1 = q != 0.f ? c / q : t0;
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+
+        if (t0 > tMin && t0 < tMax && accept(t0)) {
+            t = t0;
+            return true;
+        }
+        if (t1 > tMin && t1 < tMax && accept(t1)) {
+            t = t1;
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Accept>
+    inline bool solveQuadratic(float a, float halfB, float c, float tMin, float tMax, float &t, Accept &&accept) {
+        return solveQuadratic(a, halfB, c, halfB*halfB - a*c, tMin, tMax, t, accept);
+    }
+
+    // halfB^2 - a*c of a ray against a sphere or circle of radius^2 radius2 around the origin, as
+    // a * (radius2 - squared distance of the line to the origin). Unlike the textbook form, it doesn't
+    // cancel out to noise when the ray starts far from the shape (Haines et al., Ray Tracing Gems ch. 7)
+    template <typename Vector>
+    inline float getDiscriminant(const Vector &origin, const Vector &direction, float a, float halfB, float radius2) {
+        Vector closest = origin - (halfB / a) * direction;
+        return a * (radius2 - glm::dot(closest, closest));
+    }
+
+    // Axis aligned box [boxMin, boxMax], which meshes are approximated by
+    inline bool box(const Ray &ray, const glm::vec3 &boxMin, const glm::vec3 &boxMax, float tMin, float tMax, ShapeHit &hit) {
+        float tNear = -INFINITY, tFar = INFINITY;
+        int nearAxis = 0, farAxis = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            float inverse = 1.f / ray.direction[axis];
+            float t0 = (boxMin[axis] - ray.origin[axis]) * inverse;
+            float t1 = (boxMax[axis] - ray.origin[axis]) * inverse;
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            if (t0 > tNear) {
+                tNear = t0;
+                nearAxis = axis;
+            }
+            if (t1 < tFar) {
+                tFar = t1;
+                farAxis = axis;
+            }
+        }
+        if (tNear > tFar) {
+            return false;
+        }
+
+        // the normal faces against the ray on entry and along it on exit
+        if (tNear > tMin && tNear < tMax) {
+            hit.t = tNear;
+            hit.normal = glm::vec3(0.f);
+            hit.normal[nearAxis] = ray.direction[nearAxis] > 0.f ? -1.f : 1.f;
+            return true;
+        }
+        if (tFar > tMin && tFar < tMax) {
+            hit.t = tFar;
+            hit.normal = glm::vec3(0.f);
+            hit.normal[farAxis] = ray.direction[farAxis] > 0.f ? 1.f : -1.f;
+            return true;
+        }
+        return false;
+    }
+
+    inline bool cube(const Ray &ray, float tMin, float tMax, ShapeHit &hit) {
+        return box(ray, glm::vec3(-0.5f), glm::vec3(0.5f), tMin, tMax, hit);
+    }
+
+    // Radius 0.5
+    inline bool sphere(const Ray &ray, float tMin, float tMax, ShapeHit &hit) {
+        const glm::vec3 &o = ray.origin, &d = ray.direction;
+        float a = glm::dot(d, d), halfB = glm::dot(o, d);
+        if (!solveQuadratic(a, halfB, glm::dot(o, o) - 0.25f, getDiscriminant(o, d, a, halfB, 0.25f), tMin, tMax, hit.t,
+                            [](float){ return true; })) {
+            return false;
+        }
+        hit.normal = o + hit.t*d;
+        return true;
+    }
+
+    // Radius 0.5 around the y axis, capped at y = -0.5 and y = 0.5
+    inline bool cylinder(const Ray &ray, float tMin, float tMax, ShapeHit &hit) {
+        const glm::vec3 &o = ray.origin, &d = ray.direction;
+        bool found = false;
+
+        float t;
+        auto onSide = [&](float t){ return std::abs(o.y + t*d.y) <= 0.5f; };
+        glm::vec2 oxz(o.x, o.z), dxz(d.x, d.z);
+        float a = glm::dot(dxz, dxz), halfB = glm::dot(oxz, dxz);
+        if (a > 0.f && solveQuadratic(a, halfB, glm::dot(oxz, oxz) - 0.25f, getDiscriminant(oxz, dxz, a, halfB, 0.25f),
+                                      tMin, tMax, t, onSide)) {
+            glm::vec3 p = o + t*d;
+            hit = {t, glm::vec3(p.x, 0.f, p.z)};
+            tMax = t;
+            found = true;
+        }
+
+        if (d.y != 0.f) {
+            for (float capY : {-0.5f, 0.5f}) {
+                float t = (capY - o.y) / d.y;
+                glm::vec3 p = o + t*d;
+                if (t > tMin && t < tMax && p.x*p.x + p.z*p.z <= 0.25f) {
+                    hit = {t, glm::vec3(0.f, capY, 0.f)};
+                    tMax = t;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+
+    // Apex at y = 0.5, base of radius 0.5 at y = -0.5, so x^2 + z^2 = ((0.5 - y) / 2)^2 on the side
+    inline bool cone(const Ray &ray, float tMin, float tMax, ShapeHit &hit) {
+        const glm::vec3 &o = ray.origin, &d = ray.direction;
+        bool found = false;
+
+        // solved from the point of the ray nearest the cone's center, t shifted back after, so a ray
+        // starting far away doesn't lose the quadratic's terms to cancellation
+        float shift = -glm::dot(o, d) / glm::dot(d, d);
+        glm::vec3 near = o + shift*d;
+
+        float t;
+        float h = 0.5f - near.y;
+        auto onSide = [&](float t){ return std::abs(near.y + t*d.y) <= 0.5f; };
+        if (solveQuadratic(d.x*d.x + d.z*d.z - 0.25f*d.y*d.y, near.x*d.x + near.z*d.z + 0.25f*h*d.y,
+                           near.x*near.x + near.z*near.z - 0.25f*h*h, tMin - shift, tMax - shift, t, onSide)) {
+            t += shift;
+            glm::vec3 p = o + t*d;
+            hit = {t, glm::vec3(2.f*p.x, 0.25f - 0.5f*p.y, 2.f*p.z)};
+            tMax = t;
+            found = true;
+        }
+
+        if (d.y != 0.f) {
+            float t = (-0.5f - o.y) / d.y;
+            glm::vec3 p = o + t*d;
+            if (t > tMin && t < tMax && p.x*p.x + p.z*p.z <= 0.25f) {
+                hit = {t, glm::vec3(0.f, -1.f, 0.f)};
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Ring of radius 0.35 around the y axis with a tube of radius 0.15, see Torus. Sphere traces the
+    // torus' distance field between the ray's entry and exit of its bounds instead of solving the quartic
+    inline bool torus(const Ray &ray, float tMin, float tMax, ShapeHit &hit) {
+        constexpr float majorRadius = 0.35f, minorRadius = 0.15f, epsilon = 1e-4f;
+        glm::vec3 extent(majorRadius + minorRadius, minorRadius, majorRadius + minorRadius);
+        float entry = tMin, exit = tMax;
+        for (int axis = 0; axis < 3; axis++) {
+            float inverse = 1.f / ray.direction[axis];
+            float t0 = (-extent[axis] - ray.origin[axis]) * inverse;
+            float t1 = (extent[axis] - ray.origin[axis]) * inverse;
+            entry = std::max(entry, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+        }
+        if (entry > exit) {
+            return false;
+        }
+
+        auto distance = [&](const glm::vec3 &p){
+            return glm::length(glm::vec2(glm::length(glm::vec2(p.x, p.z)) - majorRadius, p.y)) - minorRadius;
+        };
+
+        // a ray starting inside the tube marches the negated field to find the exit
+        float length = glm::length(ray.direction);
+        float t = entry + epsilon / length;
+        float sign = distance(ray.origin + t*ray.direction) < 0.f ? -1.f : 1.f;
+        for (int step = 0; step < 128 && t < exit + epsilon / length; step++) {
+            glm::vec3 p = ray.origin + t*ray.direction;
+            float d = sign * distance(p);
+            if (d < epsilon) {
+                glm::vec2 ring = glm::length(glm::vec2(p.x, p.z)) > 0.f ? glm::normalize(glm::vec2(p.x, p.z)) : glm::vec2(1.f, 0.f);
+                hit = {t, p - majorRadius*glm::vec3(ring.x, 0.f, ring.y)};
+                return true;
+            }
+            t += d / length;
+        }
+        return false;
+    }
+
+    // Dispatches on type. Meshes are tested against their object space bounds [meshMin, meshMax]
+    inline bool intersect(PrimitiveType type, const Ray &ray, float tMin, float tMax, ShapeHit &hit,
+                          const glm::vec3 &meshMin = glm::vec3(-0.5f), const glm::vec3 &meshMax = glm::vec3(0.5f)) {
+        switch (type) {
+        case PrimitiveType::PRIMITIVE_CUBE:
+            return cube(ray, tMin, tMax, hit);
+        case PrimitiveType::PRIMITIVE_CONE:
+            return cone(ray, tMin, tMax, hit);
+        case PrimitiveType::PRIMITIVE_CYLINDER:
+            return cylinder(ray, tMin, tMax, hit);
+        case PrimitiveType::PRIMITIVE_TORUS:
+            return torus(ray, tMin, tMax, hit);
+        case PrimitiveType::PRIMITIVE_SPHERE:
+            return sphere(ray, tMin, tMax, hit);
+        case PrimitiveType::PRIMITIVE_MESH:
+            return box(ray, meshMin, meshMax, tMin, tMax, hit);
+        }
+        return false;
+    }
+}
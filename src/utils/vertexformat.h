@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Vertex of a primitive in the packed format, half the size of the 6 float vertices. Every primitive fits
+// in the unit cube around the origin, so the position is quantized to 16 bits per axis within it, and the
+// normal is stored as GL_INT_2_10_10_10_REV
+struct PackedShapeVertex {
+    uint16_t position[3];       // position = quantized position / 65535 - 0.5
+    uint16_t padding;           // keeps the normal 4 byte aligned
+    uint32_t normal;
+};
+
+namespace VertexFormat
+{
+    // Packs a normal's components into the low 30 bits as signed normalized 10 bit values, x lowest
+    inline uint32_t packNormal(float x, float y, float z) {
+        auto snorm10 = [](float value){
+            return uint32_t(int32_t(std::round(std::clamp(value, -1.f, 1.f) * 511.f))) & 0x3FF;
+        };
+        return snorm10(x) | (snorm10(y) << 10) | (snorm10(z) << 20);
+    }
+
+    // Packs interleaved position/normal vertices (6 floats each) into packed
+    inline void packShapeVertices(std::span<const float> vertices, std::vector<PackedShapeVertex> &packed) {
+        packed.resize(vertices.size() / 6);
+        for (size_t v = 0; v < packed.size(); v++) {
+            const float *vertex = &vertices[v*6];
+            for (int axis = 0; axis < 3; axis++) {
+                float t = std::clamp(vertex[axis] + 0.5f, 0.f, 1.f);
+                packed[v].position[axis] = uint16_t(std::round(t * 65535.f));
+            }
+            packed[v].padding = 0;
+            packed[v].normal = packNormal(vertex[3], vertex[4], vertex[5]);
+        }
+    }
+}
@@ -0,0 +1,190 @@
+#include "camera.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "glm/glm.hpp"
+#include "glm/ext.hpp"
+
+// Checks Camera's cached, closed-form matrices against the R*T view, glm::inverse and three matrix
+// projection it calculated from scratch on every update before matrices were cached
+namespace {
+
+struct Pose {
+    glm::vec4 pos, look, up;
+};
+
+int failures = 0;
+
+/**
+ * @brief The view matrix as rotationMatrix * translationMatrix(-pos)
+ */
+glm::mat4 referenceView(const Pose &pose) {
+    glm::vec4 w = -glm::normalize(pose.look);
+    glm::vec4 v = glm::normalize(pose.up - (glm::dot(pose.up, w))*w);
+    glm::vec3 u = glm::cross(glm::vec3(v), glm::vec3(w));
+
+    glm::mat4 rotation;
+    rotation[0] = glm::vec4(u[0], v[0], w[0], 0.f);
+    rotation[1] = glm::vec4(u[1], v[1], w[1], 0.f);
+    rotation[2] = glm::vec4(u[2], v[2], w[2], 0.f);
+    rotation[3] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+
+    glm::mat4 translation(1.f);
+    translation[3] = glm::vec4(-glm::vec3(pose.pos), 1.f);
+    return rotation*translation;
+}
+
+/**
+ * @brief The projection as remap * parallel plane * scaling
+ */
+glm::mat4 referenceProjection(float near, float far, int width, int height, float heightAngle) {
+    float aspect = static_cast<float>(width)/static_cast<float>(height);
+    float widthAngle = 2.0*glm::atan(glm::tan(aspect*heightAngle/2.0));
+
+    glm::mat4 scaling(0.f);
+    scaling[0][0] = 1.f/(far*glm::tan(widthAngle/2.0));
+    scaling[1][1] = 1.f/(far*glm::tan(heightAngle/2.0));
+    scaling[2][2] = 1.f/far;
+    scaling[3][3] = 1.f;
+
+    float c = -near/far;
+    glm::mat4 parallel(0.f);
+    parallel[0][0] = 1.f;
+    parallel[1][1] = 1.f;
+    parallel[2][2] = 1.f/(1.f + c);
+    parallel[3][2] = -c/(1.f + c);
+    parallel[2][3] = -1.f;
+
+    glm::mat4 remap(0.f);
+    remap[0][0] = 1.f;
+    remap[1][1] = 1.f;
+    remap[2][2] = -2.f;
+    remap[3][3] = 1.f;
+    remap[3][2] = -1.f;
+
+    return remap*parallel*scaling;
+}
+
+/**
+ * @brief Compares two matrices entry by entry, relative to the larger entries' magnitude
+ */
+void expectNear(const std::string &what, const glm::mat4 &actual, const glm::mat4 &expected) {
+    float error = 0.f;
+    float scale = 1.f;
+    for (int column = 0; column < 4; column++){
+        for (int row = 0; row < 4; row++){
+            error = std::max(error, std::abs(actual[column][row] - expected[column][row]));
+            scale = std::max(scale, std::abs(expected[column][row]));
+        }
+    }
+
+    if (!(error <= 1e-5f*scale)){
+        std::cerr << "FAIL " << what << ": max error " << error << std::endl;
+        failures++;
+    }
+}
+
+void expectCamera(const std::string &what, Camera &camera, const Pose &pose,
+                  float near, float far, int width, int height, float heightAngle) {
+    glm::mat4 view = referenceView(pose);
+    expectNear(what + " view", camera.getViewMatrix(), view);
+    expectNear(what + " inverse view", camera.getInverseViewMatrix(), glm::inverse(view));
+    expectNear(what + " projection", camera.getPerspectiveMatrix(), referenceProjection(near, far, width, height, heightAngle));
+    expectNear(what + " position", glm::mat4(camera.getWorldSpaceCameraPos(), glm::vec4(0.f), glm::vec4(0.f), glm::vec4(0.f)),
+               glm::mat4(glm::inverse(view)*glm::vec4(0.f, 0.f, 0.f, 1.f), glm::vec4(0.f), glm::vec4(0.f), glm::vec4(0.f)));
+}
+
+}
+
+/**
+ * @brief Random poses, each put through the updates that dirty the view or the projection
+ */
+int main() {
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> coordinate(-100.f, 100.f);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::uniform_real_distribution<float> alpha(0.f, 1.f);
+    std::uniform_real_distribution<float> angle(glm::radians(20.f), glm::radians(90.f));
+    std::uniform_int_distribution<int> size(1, 2000);
+
+    for (int i = 0; i < 1000; i++){
+        Pose pose;
+        pose.pos = glm::vec4(coordinate(random), coordinate(random), coordinate(random), 1.f);
+        pose.look = glm::vec4(unit(random), unit(random), unit(random), 0.f);
+        pose.up = glm::vec4(0.f, 1.f, 0.f, 0.f);
+        if (glm::length(glm::cross(glm::vec3(pose.look), glm::vec3(pose.up))) < 1e-2f){
+            continue;
+        }
+
+        RenderData renderData;
+        renderData.cameraData.pos = pose.pos;
+        renderData.cameraData.look = pose.look;
+        renderData.cameraData.up = pose.up;
+        renderData.cameraData.heightAngle = angle(random);
+        float heightAngle = renderData.cameraData.heightAngle;
+
+        float near = 0.1f, far = 100.f;
+        int width = size(random), height = size(random);
+
+        Camera camera;
+        camera.initializeCamera(renderData);
+        camera.updateCamera(near, far, width, height, renderData);
+        expectCamera("initial", camera, pose, near, far, width, height, heightAngle);
+
+        // projection inputs
+        width = size(random);
+        height = size(random);
+        camera.updateCamera(near, far, width, height, renderData);
+        expectCamera("resized", camera, pose, near, far, width, height, heightAngle);
+
+        near = 0.5f;
+        far = 50.f;
+        camera.updateCamera(near, far, width, height, renderData);
+        expectCamera("near far", camera, pose, near, far, width, height, heightAngle);
+
+        // a tick moving forwards, rendered part way between the two positions
+        float deltaTime = 0.1f;
+        std::unordered_map<Qt::Key, bool> keyMap{{Qt::Key_W, true}};
+        camera.translateCamera(keyMap, deltaTime);
+        glm::vec4 previous = pose.pos;
+        glm::vec4 next = pose.pos + deltaTime*pose.look;
+        float a = alpha(random);
+        camera.setInterpolationAlpha(a);
+        camera.updateCamera(near, far, width, height, renderData);
+        pose.pos = glm::mix(previous, next, a);
+        expectCamera("interpolated", camera, pose, near, far, width, height, heightAngle);
+
+        // the next frame of the same tick only moves the blend
+        a = alpha(random);
+        camera.setInterpolationAlpha(a);
+        camera.updateCamera(near, far, width, height, renderData);
+        pose.pos = glm::mix(previous, next, a);
+        expectCamera("next frame", camera, pose, near, far, width, height, heightAngle);
+
+        // rotation about the world y axis, then about the look x up axis
+        float deltaX = unit(random), deltaY = 0.5f*unit(random);
+        glm::vec3 perp = glm::normalize(glm::cross(glm::vec3(pose.look), glm::vec3(pose.up)));
+        pose.look = glm::rotate(glm::mat4(1.f), deltaX, glm::vec3(0.f, 1.f, 0.f))
+                    * glm::rotate(glm::mat4(1.f), deltaY, perp) * pose.look;
+        camera.rotateCamera(deltaX, deltaY);
+        camera.updateCamera(near, far, width, height, renderData);
+        expectCamera("rotated", camera, pose, near, far, width, height, heightAngle);
+
+        // the next tick doesn't move, so the rendered position settles on the latest one
+        keyMap[Qt::Key_W] = false;
+        camera.translateCamera(keyMap, deltaTime);
+        camera.updateCamera(near, far, width, height, renderData);
+        pose.pos = next;
+        expectCamera("settled", camera, pose, near, far, width, height, heightAngle);
+    }
+
+    if (failures > 0){
+        std::cerr << failures << " camera checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Camera matrices match" << std::endl;
+    return 0;
+}
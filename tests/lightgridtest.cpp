@@ -0,0 +1,217 @@
+#include "lightgrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/ext.hpp"
+
+// Checks LightGrid's binning against testing every light against every cluster, and against the
+// cluster the shader looks up for points inside each light
+namespace {
+
+constexpr uint32_t FIRST_LIGHT = 3;
+
+int failures = 0;
+
+void fail(const std::string &what) {
+    if (failures < 20){
+        std::cerr << "FAIL " << what << std::endl;
+    }
+    failures++;
+}
+
+struct Frustum {
+    glm::mat4 view, proj;
+    float near, far;
+    float xScale, yScale;
+};
+
+/**
+ * @brief The bounds LightGrid tests cluster (x, y, slice) against, a view space box around its frustum
+ */
+void getClusterBox(const Frustum &frustum, int x, int y, int slice, glm::vec3 &lower, glm::vec3 &upper) {
+    auto depth = [&](int s){ return frustum.near * std::pow(frustum.far/frustum.near, float(s)/LightGrid::SLICES); };
+    float sliceNear = depth(slice), sliceFar = depth(slice + 1);
+    float xLow = (2.f*x/LightGrid::TILES_X - 1.f)/frustum.xScale, xHigh = (2.f*(x + 1)/LightGrid::TILES_X - 1.f)/frustum.xScale;
+    float yLow = (2.f*y/LightGrid::TILES_Y - 1.f)/frustum.yScale, yHigh = (2.f*(y + 1)/LightGrid::TILES_Y - 1.f)/frustum.yScale;
+    lower = glm::vec3(std::min(xLow*sliceNear, xLow*sliceFar), std::min(yLow*sliceNear, yLow*sliceFar), -sliceFar);
+    upper = glm::vec3(std::max(xHigh*sliceNear, xHigh*sliceFar), std::max(yHigh*sliceNear, yHigh*sliceFar), -sliceNear);
+}
+
+/**
+ * @brief The lights of every cluster, found by testing each light's sphere against each cluster's box
+ */
+std::vector<std::vector<uint32_t>> bruteForce(const Frustum &frustum, const std::vector<LightBounds> &lights) {
+    std::vector<std::vector<uint32_t>> clusters(LightGrid::CLUSTER_COUNT);
+    for (int slice = 0; slice < LightGrid::SLICES; slice++){
+        for (int y = 0; y < LightGrid::TILES_Y; y++){
+            for (int x = 0; x < LightGrid::TILES_X; x++){
+                glm::vec3 lower, upper;
+                getClusterBox(frustum, x, y, slice, lower, upper);
+                for (size_t i = 0; i < lights.size(); i++){
+                    glm::vec3 center = glm::vec3(frustum.view*glm::vec4(lights[i].center, 1.f));
+                    glm::vec3 d = glm::max(glm::max(lower - center, center - upper), glm::vec3(0.f));
+                    if (glm::dot(d, d) <= lights[i].radius*lights[i].radius){
+                        clusters[(slice*LightGrid::TILES_Y + y)*LightGrid::TILES_X + x].push_back(FIRST_LIGHT + uint32_t(i));
+                    }
+                }
+            }
+        }
+    }
+    return clusters;
+}
+
+/**
+ * @brief The cluster default.frag looks up for a view space point, -1 if the point is off screen
+ */
+int getCluster(const LightGrid &grid, const Frustum &frustum, glm::vec3 p) {
+    float depth = -p.z;
+    glm::vec2 ndc(frustum.xScale*p.x/depth, frustum.yScale*p.y/depth);
+    if (depth < frustum.near || depth > frustum.far || std::abs(ndc.x) > 1.f || std::abs(ndc.y) > 1.f){
+        return -1;
+    }
+
+    int x = std::min(int((ndc.x*0.5f + 0.5f)*LightGrid::TILES_X), LightGrid::TILES_X - 1);
+    int y = std::min(int((ndc.y*0.5f + 0.5f)*LightGrid::TILES_Y), LightGrid::TILES_Y - 1);
+    glm::vec2 sliceParams = grid.getSliceParams();
+    int slice = std::clamp(int(std::log(depth)*sliceParams.x + sliceParams.y), 0, LightGrid::SLICES - 1);
+    return (slice*LightGrid::TILES_Y + y)*LightGrid::TILES_X + x;
+}
+
+/**
+ * @brief A point in world space at view depth and on screen at ndc, which is off screen outside [-1, 1]
+ */
+glm::vec3 unproject(const Frustum &frustum, glm::vec2 ndc, float depth) {
+    glm::vec4 view(ndc.x*depth/frustum.xScale, ndc.y*depth/frustum.yScale, -depth, 1.f);
+    return glm::vec3(glm::inverse(frustum.view)*view);
+}
+
+/**
+ * @brief Random lights around and inside the frustum, plus lights centred on tile edges, straddling
+ *        the near plane, behind the camera and beyond the far plane
+ */
+std::vector<LightBounds> makeLights(const Frustum &frustum, std::mt19937 &random) {
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::uniform_real_distribution<float> ndc(-1.5f, 1.5f);
+    auto depth = [&](){ return frustum.near * std::pow(frustum.far*1.2f/frustum.near, unit(random)); };
+    auto radius = [&](float depth){ return depth * (0.005f + 0.3f*unit(random)*unit(random)); };
+
+    std::vector<LightBounds> lights;
+    for (int i = 0; i < 300; i++){
+        float d = depth();
+        lights.push_back({unproject(frustum, glm::vec2(ndc(random), ndc(random)), d), radius(d)});
+    }
+
+    // centres exactly on the lines between tiles, and on the screen's edges
+    for (int x = 0; x <= LightGrid::TILES_X; x++){
+        float d = depth();
+        lights.push_back({unproject(frustum, glm::vec2(2.f*x/LightGrid::TILES_X - 1.f, 2.f*unit(random) - 1.f), d), radius(d)});
+    }
+    for (int y = 0; y <= LightGrid::TILES_Y; y++){
+        float d = depth();
+        lights.push_back({unproject(frustum, glm::vec2(2.f*unit(random) - 1.f, 2.f*y/LightGrid::TILES_Y - 1.f), d), radius(d)});
+    }
+
+    // off screen, only their edges reach in
+    for (int i = 0; i < 20; i++){
+        float d = depth();
+        float side = i % 2 ? 1.f : -1.f;
+        glm::vec2 offScreen = i % 4 < 2 ? glm::vec2(side*1.1f, ndc(random)) : glm::vec2(ndc(random), side*1.1f);
+        lights.push_back({unproject(frustum, offScreen, d), 0.2f*d});
+    }
+
+    // around the near plane, behind the camera and past the far plane
+    for (int i = 0; i < 10; i++){
+        lights.push_back({unproject(frustum, glm::vec2(ndc(random), ndc(random)), frustum.near*0.5f), frustum.near*(1.f + unit(random))});
+        lights.push_back({unproject(frustum, glm::vec2(ndc(random), ndc(random)), -1.f - unit(random)), 1.f + unit(random)});
+        lights.push_back({unproject(frustum, glm::vec2(ndc(random), ndc(random)), frustum.far*1.05f), frustum.far*0.1f*unit(random)});
+    }
+    return lights;
+}
+
+/**
+ * @brief Bins one set of lights for one camera and checks the grid's lists
+ */
+void checkGrid(const std::string &what, const Frustum &frustum, const std::vector<LightBounds> &lights, std::mt19937 &random) {
+    LightGrid grid;
+    grid.build(lights, FIRST_LIGHT, frustum.view, frustum.proj, frustum.near, frustum.far);
+    const std::vector<uint32_t> &clusters = grid.getClusters();
+    const std::vector<uint32_t> &indices = grid.getLightIndices();
+    if (clusters.size() != size_t(LightGrid::CLUSTER_COUNT)*2){
+        fail(what + ": " + std::to_string(clusters.size()/2) + " clusters");
+        return;
+    }
+
+    // each list holds the lights whose sphere reaches the cluster's box, in order. Tiles the sphere
+    // only reaches through the box's corners outside the frustum may be left out
+    std::vector<std::vector<uint32_t>> expected = bruteForce(frustum, lights);
+    std::vector<std::vector<uint32_t>> binned(LightGrid::CLUSTER_COUNT);
+    for (int c = 0; c < LightGrid::CLUSTER_COUNT; c++){
+        if (size_t(clusters[c*2]) + clusters[c*2 + 1] > indices.size()){
+            fail(what + ": cluster " + std::to_string(c) + " overruns the light indices");
+            return;
+        }
+        binned[c].assign(indices.begin() + clusters[c*2], indices.begin() + clusters[c*2] + clusters[c*2 + 1]);
+        if (!std::is_sorted(binned[c].begin(), binned[c].end()) ||
+            std::adjacent_find(binned[c].begin(), binned[c].end()) != binned[c].end() ||
+            !std::includes(expected[c].begin(), expected[c].end(), binned[c].begin(), binned[c].end())){
+            fail(what + ": cluster " + std::to_string(c) + " has lights the brute force doesn't");
+        }
+    }
+
+    // every on screen point inside a light must find the light in its cluster
+    std::normal_distribution<float> normal;
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    for (size_t i = 0; i < lights.size(); i++){
+        glm::vec3 center = glm::vec3(frustum.view*glm::vec4(lights[i].center, 1.f));
+        for (int sample = 0; sample < 200; sample++){
+            glm::vec3 direction = glm::normalize(glm::vec3(normal(random), normal(random), normal(random)) + glm::vec3(1e-6f));
+            float distance = sample == 0 ? 0.f : lights[i].radius*(sample % 4 == 0 ? 0.999f : std::cbrt(unit(random))*0.999f);
+            int cluster = getCluster(grid, frustum, center + distance*direction);
+            if (cluster >= 0 && !std::binary_search(binned[cluster].begin(), binned[cluster].end(), FIRST_LIGHT + uint32_t(i))){
+                fail(what + ": light " + std::to_string(i) + " missing from cluster " + std::to_string(cluster) +
+                     ", which it reaches");
+                break;
+            }
+        }
+    }
+}
+
+}
+
+/**
+ * @brief Random cameras, each with its own lights
+ */
+int main() {
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> coordinate(-20.f, 20.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    for (int camera = 0; camera < 20; camera++){
+        Frustum frustum;
+        glm::vec3 eye(coordinate(random), coordinate(random), coordinate(random));
+        glm::vec3 target = eye + glm::vec3(coordinate(random), coordinate(random), coordinate(random)) + glm::vec3(0.f, 0.f, 1e-3f);
+        frustum.view = glm::lookAt(eye, target, glm::vec3(0.f, 1.f, 0.f));
+        frustum.near = 0.05f + unit(random);
+        frustum.far = frustum.near * (20.f + 200.f*unit(random));
+        float aspect = 0.5f + 2.f*unit(random);
+        frustum.proj = glm::perspective(glm::radians(30.f + 60.f*unit(random)), aspect, frustum.near, frustum.far);
+        frustum.xScale = frustum.proj[0][0];
+        frustum.yScale = frustum.proj[1][1];
+
+        std::vector<LightBounds> lights = makeLights(frustum, random);
+        checkGrid("camera " + std::to_string(camera), frustum, lights, random);
+    }
+
+    if (failures > 0){
+        std::cerr << failures << " light grid checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Light grid matches the brute force binning" << std::endl;
+    return 0;
+}
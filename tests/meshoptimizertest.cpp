@@ -0,0 +1,121 @@
+#include "shapes/cone.h"
+#include "shapes/cube.h"
+#include "shapes/cylinder.h"
+#include "shapes/sphere.h"
+#include "shapes/torus.h"
+#include "utils/meshoptimizer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Checks MeshOptimizer::optimize() never leaves a built-in shape with a worse vertex cache order than
+// it was tesselated in, over the range of tesselation params the sliders reach and beyond
+namespace {
+
+int failures = 0;
+
+/**
+ * @brief Tesselates one primitive type into an indexed mesh, as Realtime::generateShapeData() does
+ */
+MeshData tesselate(int shape, int param1, int param2) {
+    MeshData mesh;
+    switch (shape){
+        case 0:
+            mesh.vertices.resize(Sphere::getVertexDataSize(param1, param2));
+            Sphere().writeVertexData(param1, param2, mesh.vertices);
+            break;
+        case 1:
+            mesh.vertices.resize(Cube::getVertexDataSize(param1));
+            Cube().writeVertexData(param1, mesh.vertices);
+            break;
+        case 2:
+            mesh.vertices.resize(Cylinder::getVertexDataSize(param1, param2));
+            Cylinder().writeVertexData(param1, param2, mesh.vertices);
+            break;
+        case 3:
+            mesh.vertices.resize(Cone::getVertexDataSize(param1, param2));
+            Cone().writeVertexData(param1, param2, mesh.vertices);
+            break;
+        case 4:
+            mesh.vertices.resize(Torus::getVertexDataSize(param1, param2));
+            mesh.indices.resize(Torus::getIndexCount(param1, param2));
+            Torus().writeVertexData(param1, param2, mesh.vertices, mesh.indices);
+            return mesh;
+    }
+
+    MeshOptimizer::generateIndexBuffer(mesh, 6);
+    return mesh;
+}
+
+/**
+ * @brief Every triangle of before appears in after, as the same three vertices in the same winding
+ */
+bool sameTriangles(const MeshData &before, const MeshData &after) {
+    auto triangles = [](const MeshData &mesh){
+        std::vector<std::vector<float>> result;
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3){
+            // rotated so the smallest vertex comes first, which keeps the winding
+            std::vector<std::vector<float>> corners;
+            for (int corner = 0; corner < 3; corner++){
+                const float *vertex = &mesh.vertices[size_t(mesh.indices[t + corner])*6];
+                corners.emplace_back(vertex, vertex + 6);
+            }
+            int first = 0;
+            for (int corner = 1; corner < 3; corner++){
+                if (corners[corner] < corners[first]){
+                    first = corner;
+                }
+            }
+            std::vector<float> triangle;
+            for (int corner = 0; corner < 3; corner++){
+                const std::vector<float> &vertex = corners[(first + corner) % 3];
+                triangle.insert(triangle.end(), vertex.begin(), vertex.end());
+            }
+            result.push_back(std::move(triangle));
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    return triangles(before) == triangles(after);
+}
+
+}
+
+int main() {
+    const char *names[] = {"sphere", "cube", "cylinder", "cone", "torus"};
+    std::vector<int> params = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 15, 20, 25, 35, 50};
+
+    for (int shape = 0; shape < 5; shape++){
+        for (int param1 : params){
+            for (int param2 : params){
+                MeshData mesh = tesselate(shape, param1, param2);
+                MeshData tesselated = mesh;
+                MeshOptimizeStats stats = MeshOptimizer::optimize(mesh, 6);
+
+                std::string what = std::string(names[shape]) + " " + std::to_string(param1) + "x" + std::to_string(param2);
+                if (stats.after.acmr > stats.before.acmr){
+                    std::cerr << "FAIL " << what << ": ACMR " << stats.before.acmr << " -> " << stats.after.acmr << std::endl;
+                    failures++;
+                }
+                if (stats.before.acmr != MeshOptimizer::analyzeVertexCache(tesselated.indices, tesselated.vertices.size() / 6).acmr ||
+                    stats.after.acmr != MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size() / 6).acmr){
+                    std::cerr << "FAIL " << what << ": reported ACMR doesn't match the index buffers" << std::endl;
+                    failures++;
+                }
+                if (!sameTriangles(tesselated, mesh)){
+                    std::cerr << "FAIL " << what << ": optimizing changed the triangles" << std::endl;
+                    failures++;
+                }
+            }
+        }
+    }
+
+    if (failures > 0){
+        std::cerr << failures << " mesh optimizer checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Optimized shapes never regress ACMR" << std::endl;
+    return 0;
+}
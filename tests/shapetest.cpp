@@ -0,0 +1,210 @@
+#include "shapes/cone.h"
+#include "shapes/cylinder.h"
+#include "shapes/sphere.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Checks the sin/cos lattice tesselation of sphere, cylinder and cone against the per tile trig and
+// normalize they calculated every corner with before, vertex for vertex
+namespace {
+
+int failures = 0;
+
+void insertVertex(std::vector<float> &data, glm::vec3 position, glm::vec3 normal) {
+    data.insert(data.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z});
+}
+
+// The 2 triangles of a tile, each corner with its own normal
+void insertTile(std::vector<float> &data, glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight,
+                glm::vec3 topLeftNormal, glm::vec3 topRightNormal, glm::vec3 bottomLeftNormal, glm::vec3 bottomRightNormal) {
+    insertVertex(data, topLeft, topLeftNormal);
+    insertVertex(data, bottomLeft, bottomLeftNormal);
+    insertVertex(data, bottomRight, bottomRightNormal);
+
+    insertVertex(data, topLeft, topLeftNormal);
+    insertVertex(data, bottomRight, bottomRightNormal);
+    insertVertex(data, topRight, topRightNormal);
+}
+
+/**
+ * @brief The sphere as it was tesselated tile by tile, normals normalized from the positions
+ */
+std::vector<float> referenceSphere(int param1, int param2) {
+    std::vector<float> data;
+    float thetaStep = glm::radians(360.f / param2);
+    for (int wedge = 0; wedge < param2; wedge++){
+        float currentTheta = wedge*thetaStep, nextTheta = (wedge + 1)*thetaStep;
+        float increment = glm::radians(180.0/param1);
+        float topPhi = 0.f, bottomPhi = increment;
+        float r = 0.5f;
+
+        for (int i = 0; i < param1; i++){
+            glm::vec3 topLeft(r*glm::sin(topPhi)*glm::sin(currentTheta), r*glm::cos(topPhi), r*glm::sin(topPhi)*glm::cos(currentTheta));
+            glm::vec3 topRight(r*glm::sin(topPhi)*glm::sin(nextTheta), r*glm::cos(topPhi), r*glm::sin(topPhi)*glm::cos(nextTheta));
+            glm::vec3 bottomLeft(r*glm::sin(bottomPhi)*glm::sin(currentTheta), r*glm::cos(bottomPhi), r*glm::sin(bottomPhi)*glm::cos(currentTheta));
+            glm::vec3 bottomRight(r*glm::sin(bottomPhi)*glm::sin(nextTheta), r*glm::cos(bottomPhi), r*glm::sin(bottomPhi)*glm::cos(nextTheta));
+            insertTile(data, topLeft, topRight, bottomLeft, bottomRight, glm::normalize(topLeft), glm::normalize(topRight),
+                       glm::normalize(bottomLeft), glm::normalize(bottomRight));
+
+            topPhi += increment;
+            bottomPhi += increment;
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief A cap tile of the cylinder or cone, at height y and facing normal
+ */
+void insertCapTile(std::vector<float> &data, float r, float y, float topPhi, float bottomPhi,
+                   float currentTheta, float nextTheta, glm::vec3 normal, bool flip) {
+    glm::vec3 topLeft(r*glm::sin(topPhi)*glm::cos(currentTheta), y, r*glm::sin(topPhi)*glm::sin(currentTheta));
+    glm::vec3 topRight(r*glm::sin(topPhi)*glm::cos(nextTheta), y, r*glm::sin(topPhi)*glm::sin(nextTheta));
+    glm::vec3 bottomLeft(r*glm::sin(bottomPhi)*glm::cos(currentTheta), y, r*glm::sin(bottomPhi)*glm::sin(currentTheta));
+    glm::vec3 bottomRight(r*glm::sin(bottomPhi)*glm::cos(nextTheta), y, r*glm::sin(bottomPhi)*glm::sin(nextTheta));
+    if (flip){
+        insertTile(data, topRight, topLeft, bottomRight, bottomLeft, normal, normal, normal, normal);
+    } else {
+        insertTile(data, topLeft, topRight, bottomLeft, bottomRight, normal, normal, normal, normal);
+    }
+}
+
+/**
+ * @brief The cylinder as it was tesselated tile by tile, side normals normalized from the positions
+ */
+std::vector<float> referenceCylinder(int param1, int param2) {
+    auto sideNormal = [](glm::vec3 position){ return glm::normalize(glm::vec3(2.f*position.x, 0.f, 2.f*position.z)); };
+
+    std::vector<float> data;
+    float thetaStep = glm::radians(360.f / param2);
+    for (int wedge = 0; wedge < param2; wedge++){
+        float currentTheta = wedge*thetaStep, nextTheta = (wedge + 1)*thetaStep;
+        float increment = glm::radians(90.0/param1);
+        float topPhi = 0.f, bottomPhi = increment;
+        float ystep = 1.f/param1;
+        float yTop = 0.5f;
+        float r = 0.5f;
+
+        for (int i = 0; i < param1; i++){
+            float yBottom = yTop - ystep;
+            glm::vec3 topLeft(r*glm::cos(currentTheta), yTop, r*glm::sin(currentTheta));
+            glm::vec3 topRight(r*glm::cos(nextTheta), yTop, r*glm::sin(nextTheta));
+            glm::vec3 bottomLeft(r*glm::cos(currentTheta), yBottom, r*glm::sin(currentTheta));
+            glm::vec3 bottomRight(r*glm::cos(nextTheta), yBottom, r*glm::sin(nextTheta));
+            insertTile(data, topRight, topLeft, bottomRight, bottomLeft, sideNormal(topRight), sideNormal(topLeft),
+                       sideNormal(bottomRight), sideNormal(bottomLeft));
+
+            insertCapTile(data, r, r, topPhi, bottomPhi, currentTheta, nextTheta, glm::vec3(0.f, 1.f, 0.f), true);
+            insertCapTile(data, r, -r, topPhi, bottomPhi, currentTheta, nextTheta, glm::vec3(0.f, -1.f, 0.f), false);
+
+            yTop = yTop - ystep;
+            topPhi += increment;
+            bottomPhi += increment;
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief The cone as it was tesselated tile by tile, side normals normalized from the implicit surface's gradient
+ */
+std::vector<float> referenceCone(int param1, int param2) {
+    auto sideNormal = [](glm::vec3 position){
+        return glm::normalize(glm::vec3(2.f*position.x, 0.25f - 0.5f*position.y, 2.f*position.z));
+    };
+
+    std::vector<float> data;
+    float thetaStep = glm::radians(360.f / param2);
+    for (int wedge = 0; wedge < param2; wedge++){
+        float currentTheta = wedge*thetaStep, nextTheta = (wedge + 1)*thetaStep;
+        float increment = glm::radians(90.0/param1);
+        float topPhi = 0.f, bottomPhi = increment;
+        float ystep = 1.f/param1;
+        float yTop = 0.5f;
+        float r = 0.5f;
+
+        for (int i = 0; i < param1; i++){
+            float yBottom = yTop - ystep;
+            float rTop = std::abs((yTop - 0.5f)/2.f);
+            float rBottom = std::abs((yBottom - 0.5f)/2.f);
+            glm::vec3 topLeft(rTop*glm::cos(currentTheta), yTop, rTop*glm::sin(currentTheta));
+            glm::vec3 topRight(rTop*glm::cos(nextTheta), yTop, rTop*glm::sin(nextTheta));
+            glm::vec3 bottomLeft(rBottom*glm::cos(currentTheta), yBottom, rBottom*glm::sin(currentTheta));
+            glm::vec3 bottomRight(rBottom*glm::cos(nextTheta), yBottom, rBottom*glm::sin(nextTheta));
+
+            // the tip's normal is perpendicular to the middle of the tile's bottom edge
+            glm::vec3 topLeftNormal = sideNormal(topRight), topRightNormal = sideNormal(topLeft);
+            if (rTop == 0){
+                glm::vec3 middle = bottomRight + (bottomLeft - bottomRight)/2.f;
+                topLeftNormal = topRightNormal = sideNormal(glm::vec3(middle.x, bottomRight.y, middle.z));
+            }
+            insertTile(data, topRight, topLeft, bottomRight, bottomLeft, topLeftNormal, topRightNormal,
+                       sideNormal(bottomRight), sideNormal(bottomLeft));
+
+            insertCapTile(data, r, -r, topPhi, bottomPhi, currentTheta, nextTheta, glm::vec3(0.f, -1.f, 0.f), false);
+
+            yTop = yTop - ystep;
+            topPhi += increment;
+            bottomPhi += increment;
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief Compares the shape's output with the reference float for float
+ */
+void expectNear(const std::string &what, const std::vector<float> &actual, const std::vector<float> &expected) {
+    if (actual.size() != expected.size()){
+        std::cerr << "FAIL " << what << ": " << actual.size() << " floats, expected " << expected.size() << std::endl;
+        failures++;
+        return;
+    }
+
+    float error = 0.f;
+    for (size_t i = 0; i < actual.size(); i++){
+        error = std::max(error, std::abs(actual[i] - expected[i]));
+    }
+    if (!(error <= 1e-5f)){
+        std::cerr << "FAIL " << what << ": max error " << error << std::endl;
+        failures++;
+    }
+}
+
+}
+
+/**
+ * @brief Every pair of params the sliders reach, clamped the way the shapes clamp them
+ */
+int main() {
+    for (int param1 = 1; param1 <= 25; param1++){
+        for (int param2 = 1; param2 <= 25; param2++){
+            std::string params = " " + std::to_string(param1) + "x" + std::to_string(param2);
+
+            std::vector<float> sphere(Sphere::getVertexDataSize(param1, param2));
+            Sphere().writeVertexData(param1, param2, sphere);
+            expectNear("sphere" + params, sphere, referenceSphere(std::max(param1, 2), std::max(param2, 3)));
+
+            std::vector<float> cylinder(Cylinder::getVertexDataSize(param1, param2));
+            Cylinder().writeVertexData(param1, param2, cylinder);
+            expectNear("cylinder" + params, cylinder, referenceCylinder(std::max(param1, 3), std::max(param2, 3)));
+
+            std::vector<float> cone(Cone::getVertexDataSize(param1, param2));
+            Cone().writeVertexData(param1, param2, cone);
+            expectNear("cone" + params, cone, referenceCone(std::max(param1, 3), std::max(param2, 3)));
+        }
+    }
+
+    if (failures > 0){
+        std::cerr << failures << " shape checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Shapes match their per tile tesselation" << std::endl;
+    return 0;
+}